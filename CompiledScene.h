@@ -0,0 +1,428 @@
+#ifndef COMPILED_SCENE_H
+#define COMPILED_SCENE_H
+
+#include "RayTracer.h"
+#include "./include/mapped_file.h"
+#include "./include/mesh_binary.h"
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <type_traits>
+
+// ############################################################################################
+// Compiled scene format: everything a scene file describes, in arrays that are mapped and
+// traced in place, so a scene that is rendered many times is parsed only once.
+//
+// Layout (little endian):
+//   CompiledSceneHeader (144 bytes)
+//   light block:     lightCount x CompiledLight
+//   material block:  materialCount x Material      (shared by all primitives)
+//   sphere block:    sphereCount x CompiledSphere
+//   box block:       boxCount x CompiledBox
+//   triangle block:  triangleCount x CompiledTriangle
+//   mesh block:      meshCount x CompiledMesh
+//   mesh images:     binary meshes (include/mesh_binary.h) with their BVHs, embedded whole
+// Every block and mesh image starts at a multiple of MESH_BLOCK_ALIGNMENT bytes.
+
+const uint32_t COMPILED_SCENE_VERSION = 1;
+
+enum CompiledSceneFlags {
+    SCENE_REFLECTIONS = 1
+};
+
+struct CompiledSceneHeader {
+    char magic[4];              // "RSCN"
+    uint32_t version;
+    uint32_t headerBytes;       // sizeof(CompiledSceneHeader), for later extensions
+    uint32_t flags;
+    float lookFrom[3];
+    float lookAt[3];
+    float up[3];
+    float fov;
+    float background[3];
+    int32_t maxReflectionDepth;
+    uint32_t lightCount;
+    uint32_t materialCount;
+    uint32_t sphereCount;
+    uint32_t boxCount;
+    uint32_t triangleCount;
+    uint32_t meshCount;
+    uint64_t lightOffset;       // Byte offsets of the blocks, 0 if empty
+    uint64_t materialOffset;
+    uint64_t sphereOffset;
+    uint64_t boxOffset;
+    uint64_t triangleOffset;
+    uint64_t meshOffset;
+};
+
+struct CompiledLight {
+    Vector3f position;
+    Vector3f color;
+    float intensity;
+};
+
+struct CompiledSphere {
+    Vector3f center;
+    float radius;
+    uint32_t material;          // Index into the material block
+};
+
+struct CompiledBox {
+    Vector3f boxMin;
+    Vector3f boxMax;
+    uint32_t material;
+};
+
+struct CompiledTriangle {
+    Vector3f v0, v1, v2;
+    uint32_t material;
+};
+
+struct CompiledMesh {
+    Vector3f position;
+    float scale;
+    uint32_t material;
+    uint32_t reserved;
+    uint64_t imageOffset;       // Embedded binary mesh
+    uint64_t imageBytes;
+};
+
+static_assert(sizeof(CompiledSceneHeader) == 144, "CompiledSceneHeader is part of the file format");
+static_assert(sizeof(Material) == 32 && std::is_standard_layout<Material>::value,
+              "Material is stored in compiled scenes and used in place");
+static_assert(sizeof(CompiledLight) == 28 && sizeof(CompiledSphere) == 20 && sizeof(CompiledBox) == 28 &&
+              sizeof(CompiledTriangle) == 40 && sizeof(CompiledMesh) == 40,
+              "Compiled scene records are part of the file format");
+
+// ############################################################################################
+// Primitives of one kind traced straight from the arrays of a compiled scene. Primitive IDs
+// are array indices; materials come from the scene's material table. The mapping stays
+// alive as long as a set references it.
+template <typename Record>
+class CompiledPrimitiveSet : public Hittable {
+public:
+    CompiledPrimitiveSet(std::shared_ptr<const MappedFile> mapping, const Record* recordArray, uint32_t count,
+                         const Material* materialTable)
+        : file(mapping), records(recordArray), recordCount(count), materials(materialTable) {}
+
+    virtual bool hit(const Ray& ray, float tMin, float tMax, HitRecord& rec) const override {
+        bool hitAnything = false;
+        for (uint32_t i = 0; i < recordCount; i++) {
+            if (intersect(ray, records[i], tMin, tMax, rec)) {
+                rec.primID = i;
+                tMax = rec.t;
+                hitAnything = true;
+            }
+        }
+        return hitAnything;
+    }
+
+    virtual void getSurface(const Ray& ray, const HitRecord& rec, SurfaceInteraction& surf) const override {
+        const Record& record = records[rec.primID];
+        surf.point = ray.origin + ray.direction * rec.t;
+        surf.setFaceNormal(ray, normal(record, surf.point, rec));
+        surf.material = &materials[record.material];
+    }
+
+    virtual unsigned int primitiveCount() const override { return recordCount; }
+
+    virtual size_t byteSize() const override { return sizeof(CompiledPrimitiveSet); }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    const Record* records;
+    uint32_t recordCount;
+    const Material* materials;
+
+    // The same intersection and normal code as Sphere, Box and Triangle
+    static bool intersect(const Ray& ray, const CompiledSphere& s, float tMin, float tMax, HitRecord& rec) {
+        return IntersectSphere(ray, s.center, s.radius, tMin, tMax, rec);
+    }
+
+    static bool intersect(const Ray& ray, const CompiledBox& b, float tMin, float tMax, HitRecord& rec) {
+        return IntersectBox(ray, b.boxMin, b.boxMax, tMin, tMax, rec);
+    }
+
+    static bool intersect(const Ray& ray, const CompiledTriangle& t, float tMin, float tMax, HitRecord& rec) {
+        return IntersectTriangle(ray, t.v0, t.v1, t.v2, tMin, tMax, rec);
+    }
+
+    static Vector3f normal(const CompiledSphere& s, const Vector3f& point, const HitRecord&) {
+        return (point - s.center) * (1.0f / s.radius);
+    }
+
+    static Vector3f normal(const CompiledBox&, const Vector3f&, const HitRecord& rec) {
+        return BoxNormal(rec);
+    }
+
+    static Vector3f normal(const CompiledTriangle& t, const Vector3f&, const HitRecord&) {
+        Vector3f edge1 = t.v1 - t.v0;
+        Vector3f edge2 = t.v2 - t.v0;
+        Vector3f n = edge1.Cross(edge2);
+        n.Normalize();
+        return n;
+    }
+};
+
+namespace compiled_scene_detail {
+
+inline void PutVector(float* out, const Vector3f& v) {
+    out[0] = v.x;
+    out[1] = v.y;
+    out[2] = v.z;
+}
+
+// ############################################################################################
+// Index of a material in the table, adding it if it is new
+inline uint32_t MaterialIndex(const Material& material, std::vector<Material>& table,
+                              std::map<std::string, uint32_t>& lookup) {
+    std::string key(reinterpret_cast<const char*>(&material), sizeof(Material));
+    std::map<std::string, uint32_t>::iterator it = lookup.find(key);
+    if (it != lookup.end()) return it->second;
+    uint32_t index = static_cast<uint32_t>(table.size());
+    table.push_back(material);
+    lookup[key] = index;
+    return index;
+}
+
+template <typename T>
+inline uint32_t CountOf(const std::vector<T>& v) {
+    return static_cast<uint32_t>(v.size());
+}
+
+template <typename T>
+inline const T* BlockAt(const MappedFile& file, uint64_t offset, uint32_t count, bool& ok) {
+    uint64_t bytes = static_cast<uint64_t>(count) * sizeof(T);
+    if (count == 0) return NULL;
+    if (offset % MESH_BLOCK_ALIGNMENT != 0 || offset > file.size() || bytes > file.size() - offset) {
+        ok = false;
+        return NULL;
+    }
+    return reinterpret_cast<const T*>(file.data() + offset);
+}
+
+} // namespace compiled_scene_detail
+
+// ############################################################################################
+// True if the file starts with the compiled scene magic
+inline bool IsCompiledSceneFile(const std::string& filename) {
+    char magic[4] = {};
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) return false;
+    bool match = fread(magic, 1, 4, file) == 4 && memcmp(magic, "RSCN", 4) == 0;
+    fclose(file);
+    return match;
+}
+
+// ############################################################################################
+// Write the scene loaded in 'rayTracer' in compiled form. Spheres, boxes and triangles
+// (including OFF models, which load as triangles) go into the primitive arrays; binary
+// meshes are embedded with their BVHs.
+inline bool WriteCompiledScene(const RayTracer& rayTracer, const std::string& filename) {
+    using namespace compiled_scene_detail;
+    using mesh_binary_detail::Align;
+    using mesh_binary_detail::WriteBlock;
+    if (!mesh_binary_detail::IsLittleEndian()) {
+        std::cerr << "Error: Compiled scenes can only be written on little-endian machines" << std::endl;
+        return false;
+    }
+
+    std::vector<CompiledLight> lights;
+    std::vector<Material> materials;
+    std::map<std::string, uint32_t> materialLookup;
+    std::vector<CompiledSphere> spheres;
+    std::vector<CompiledBox> boxes;
+    std::vector<CompiledTriangle> triangles;
+    std::vector<CompiledMesh> meshes;
+    std::vector<const MeshBinary*> meshData;
+
+    for (size_t i = 0; i < rayTracer.getLights().size(); i++) {
+        const Light& light = rayTracer.getLights()[i];
+        CompiledLight record = { light.position, light.color, light.intensity };
+        lights.push_back(record);
+    }
+    const std::vector<Hittable*>& objects = rayTracer.getWorld().objects;
+    for (size_t i = 0; i < objects.size(); i++) {
+        const Hittable* object = objects[i];
+        uint32_t material = MaterialIndex(object->material, materials, materialLookup);
+        if (const Sphere* sphere = dynamic_cast<const Sphere*>(object)) {
+            CompiledSphere record = { sphere->center, sphere->radius, material };
+            spheres.push_back(record);
+        } else if (const Box* box = dynamic_cast<const Box*>(object)) {
+            CompiledBox record = { box->boxMin, box->boxMax, material };
+            boxes.push_back(record);
+        } else if (const Triangle* triangle = dynamic_cast<const Triangle*>(object)) {
+            CompiledTriangle record = { triangle->v0, triangle->v1, triangle->v2, material };
+            triangles.push_back(record);
+        } else if (const TriangleMesh* mesh = dynamic_cast<const TriangleMesh*>(object)) {
+            CompiledMesh record = { mesh->getPosition(), mesh->getScale(), material, 0, 0, mesh->getMeshData()->fileBytes() };
+            meshes.push_back(record);
+            meshData.push_back(mesh->getMeshData().get());
+        } else {
+            std::cerr << "Error: Scene object " << i << " has a type compiled scenes cannot store" << std::endl;
+            return false;
+        }
+    }
+
+    CompiledSceneHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "RSCN", 4);
+    header.version = COMPILED_SCENE_VERSION;
+    header.headerBytes = sizeof(CompiledSceneHeader);
+    header.flags = rayTracer.getReflectionsEnabled() ? SCENE_REFLECTIONS : 0;
+    const Camera& camera = rayTracer.getCamera();
+    PutVector(header.lookFrom, camera.lookFrom);
+    PutVector(header.lookAt, camera.lookAt);
+    PutVector(header.up, camera.vup);
+    header.fov = camera.vfov;
+    PutVector(header.background, rayTracer.getBackgroundColor());
+    header.maxReflectionDepth = rayTracer.getMaxReflectionDepth();
+    header.lightCount = CountOf(lights);
+    header.materialCount = CountOf(materials);
+    header.sphereCount = CountOf(spheres);
+    header.boxCount = CountOf(boxes);
+    header.triangleCount = CountOf(triangles);
+    header.meshCount = CountOf(meshes);
+
+    // Place the blocks, then the mesh images
+    uint64_t offset = Align(sizeof(CompiledSceneHeader));
+    uint64_t* offsets[6] = { &header.lightOffset, &header.materialOffset, &header.sphereOffset,
+                             &header.boxOffset, &header.triangleOffset, &header.meshOffset };
+    const size_t bytes[6] = { lights.size() * sizeof(CompiledLight), materials.size() * sizeof(Material),
+                              spheres.size() * sizeof(CompiledSphere), boxes.size() * sizeof(CompiledBox),
+                              triangles.size() * sizeof(CompiledTriangle), meshes.size() * sizeof(CompiledMesh) };
+    const void* blocks[6] = { lights.data(), materials.data(), spheres.data(), boxes.data(), triangles.data(),
+                              meshes.data() };
+    for (int b = 0; b < 6; b++) {
+        if (bytes[b] == 0) continue;
+        *offsets[b] = offset;
+        offset = Align(offset + bytes[b]);
+    }
+    // Meshes shared by several objects (e.g. from the mesh cache) are stored once
+    std::map<const MeshBinary*, uint64_t> imageOffsets;
+    std::vector<bool> writeImage(meshes.size(), false);
+    for (size_t m = 0; m < meshes.size(); m++) {
+        std::map<const MeshBinary*, uint64_t>::const_iterator found = imageOffsets.find(meshData[m]);
+        if (found != imageOffsets.end()) {
+            meshes[m].imageOffset = found->second;
+            continue;
+        }
+        meshes[m].imageOffset = imageOffsets[meshData[m]] = offset;
+        writeImage[m] = true;
+        offset = Align(offset + meshes[m].imageBytes);
+    }
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+    uint64_t position = 0;
+    bool ok = WriteBlock(file, position, 0, &header, sizeof(header));
+    for (int b = 0; b < 6 && ok; b++) {
+        if (bytes[b] > 0) ok = WriteBlock(file, position, *offsets[b], blocks[b], bytes[b]);
+    }
+    for (size_t m = 0; m < meshes.size() && ok; m++) {
+        if (writeImage[m]) ok = WriteBlock(file, position, meshes[m].imageOffset, meshData[m]->image(), meshes[m].imageBytes);
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error: Failed to write compiled scene: " << filename << std::endl;
+    }
+    return ok;
+}
+
+// ############################################################################################
+// Load a compiled scene into the ray tracer, replacing its scene. The file is mapped and its
+// primitive arrays, materials and meshes are traced in place; only the camera, lights and
+// one object per primitive kind and mesh are created, whatever the scene size.
+inline bool LoadCompiledScene(RayTracer& rayTracer, const std::string& filename, SceneParseStats* stats) {
+    using namespace compiled_scene_detail;
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!mesh_binary_detail::IsLittleEndian()) {
+        std::cerr << "Error: Compiled scenes can only be used on little-endian machines" << std::endl;
+        return false;
+    }
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->openRead(filename)) return false;
+    const CompiledSceneHeader* h = reinterpret_cast<const CompiledSceneHeader*>(file->data());
+    if (file->size() < sizeof(CompiledSceneHeader) || memcmp(h->magic, "RSCN", 4) != 0) {
+        std::cerr << "Error: Not a compiled scene: " << filename << std::endl;
+        return false;
+    }
+    if (h->version != COMPILED_SCENE_VERSION || h->headerBytes < sizeof(CompiledSceneHeader)) {
+        std::cerr << "Error: Unsupported compiled scene version " << h->version << ": " << filename << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    const CompiledLight* lights = BlockAt<CompiledLight>(*file, h->lightOffset, h->lightCount, ok);
+    const Material* materials = BlockAt<Material>(*file, h->materialOffset, h->materialCount, ok);
+    const CompiledSphere* spheres = BlockAt<CompiledSphere>(*file, h->sphereOffset, h->sphereCount, ok);
+    const CompiledBox* boxes = BlockAt<CompiledBox>(*file, h->boxOffset, h->boxCount, ok);
+    const CompiledTriangle* triangles = BlockAt<CompiledTriangle>(*file, h->triangleOffset, h->triangleCount, ok);
+    const CompiledMesh* meshes = BlockAt<CompiledMesh>(*file, h->meshOffset, h->meshCount, ok);
+    for (uint32_t i = 0; ok && i < h->sphereCount; i++) ok = spheres[i].material < h->materialCount;
+    for (uint32_t i = 0; ok && i < h->boxCount; i++) ok = boxes[i].material < h->materialCount;
+    for (uint32_t i = 0; ok && i < h->triangleCount; i++) ok = triangles[i].material < h->materialCount;
+    for (uint32_t i = 0; ok && i < h->meshCount; i++) ok = meshes[i].material < h->materialCount;
+    if (!ok) {
+        std::cerr << "Error: Truncated or corrupt compiled scene: " << filename << std::endl;
+        return false;
+    }
+
+    // Open the embedded meshes before touching the ray tracer, so a bad file leaves it unchanged
+    std::vector<std::shared_ptr<MeshBinary> > meshData(h->meshCount);
+    std::map<uint64_t, uint32_t> firstUse;
+    for (uint32_t m = 0; m < h->meshCount; m++) {
+        std::map<uint64_t, uint32_t>::const_iterator shared = firstUse.find(meshes[m].imageOffset);
+        if (shared != firstUse.end() && meshes[shared->second].imageBytes == meshes[m].imageBytes) {
+            meshData[m] = meshData[shared->second];
+            continue;
+        }
+        firstUse[meshes[m].imageOffset] = m;
+        meshData[m] = std::make_shared<MeshBinary>();
+        if (!meshData[m]->openEmbedded(file, meshes[m].imageOffset, meshes[m].imageBytes, filename) ||
+            !meshData[m]->validate()) {
+            return false;
+        }
+    }
+
+    rayTracer.clearScene();
+    rayTracer.reserveScene(3 + h->meshCount, h->lightCount);
+    rayTracer.setCamera(Vector3f(h->lookFrom[0], h->lookFrom[1], h->lookFrom[2]),
+                        Vector3f(h->lookAt[0], h->lookAt[1], h->lookAt[2]),
+                        Vector3f(h->up[0], h->up[1], h->up[2]), h->fov);
+    rayTracer.setBackgroundColor(Vector3f(h->background[0], h->background[1], h->background[2]));
+    rayTracer.setReflectionsEnabled((h->flags & SCENE_REFLECTIONS) != 0);
+    rayTracer.setMaxReflectionDepth(h->maxReflectionDepth);
+    for (uint32_t i = 0; i < h->lightCount; i++) {
+        rayTracer.addLight(lights[i].position, lights[i].color, lights[i].intensity);
+    }
+    if (h->sphereCount) rayTracer.addHittable(new CompiledPrimitiveSet<CompiledSphere>(file, spheres, h->sphereCount, materials));
+    if (h->boxCount) rayTracer.addHittable(new CompiledPrimitiveSet<CompiledBox>(file, boxes, h->boxCount, materials));
+    if (h->triangleCount) {
+        rayTracer.addHittable(new CompiledPrimitiveSet<CompiledTriangle>(file, triangles, h->triangleCount, materials));
+    }
+    for (uint32_t m = 0; m < h->meshCount; m++) {
+        rayTracer.addTriangleMesh(meshData[m], meshes[m].position, meshes[m].scale, materials[meshes[m].material]);
+    }
+
+    if (stats) {
+        stats->fileBytes = file->size();
+        stats->lines = 0;
+        stats->objects = static_cast<size_t>(h->sphereCount) + h->boxCount + h->triangleCount + h->meshCount;
+        stats->lights = h->lightCount;
+        stats->skippedLines = 0;
+        stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    return true;
+}
+
+#endif // COMPILED_SCENE_H
@@ -2,9 +2,15 @@
 #define MESH_SLICER_H
 
 #include "./include/math_utils.h"
+#include "./include/mem_stats.h"
+#include "./include/mesh_normals.h"
+#include "./include/mesh_weld.h"
 #include <vector>
 #include <algorithm>
 #include <unordered_map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 // ##################################################################################
 // This class implements the mesh slicing algorithm
@@ -84,6 +90,11 @@ public:
 private:
     std::vector<Plane> planes;
     const float EPSILON = 1e-6f; // Epsilon for numerical stability
+    MemAccount outputMem{MEM_GEOMETRY}; // Size of the last sliced mesh handed to the caller
+    bool weldOutput = true;             // Weld the pieces' shared vertices after SliceMesh
+    float weldTolerance = 1e-6f;        // Weld distance relative to the sliced mesh's extent
+    WeldStats lastWeld;
+    int lastSliceThreads = 1;           // Threads the last AppendSlicedTriangles ran on
     
     // ############################################################################################
     // Edge-plane intersection calculation with improved numerical stability
@@ -156,6 +167,28 @@ public:
         return planes.size();
     }
 
+    // ############################################################################################
+    // Whether SliceMesh welds its output, and within which distance relative to the output's
+    // extent (0 welds exact duplicates only)
+    void SetWeld(bool enabled, float relativeTolerance = 1e-6f) {
+        weldOutput = enabled;
+        weldTolerance = std::max(0.0f, relativeTolerance);
+    }
+
+    bool GetWeldEnabled() const {
+        return weldOutput;
+    }
+
+    // Result of the last weld
+    const WeldStats& GetLastWeld() const {
+        return lastWeld;
+    }
+
+    // Threads the last slice ran on (1 when it took the serial path)
+    int GetLastSliceThreads() const {
+        return lastSliceThreads;
+    }
+
     // ############################################################################################
     // Get a plane by index
     Plane GetPlane(int index) const {
@@ -175,11 +208,13 @@ public:
         std::vector<Vector3f>& outNormals,
         std::vector<unsigned int>& outIndices
     ) {
+        lastWeld = WeldStats();
         if (planes.empty()) {
             // No planes, just copy the input mesh
             outVertices = inVertices;
             outNormals = inNormals;
             outIndices = inIndices;
+            outputMem.Set(VectorBytes(outVertices) + VectorBytes(outNormals) + VectorBytes(outIndices));
             return;
         }
 
@@ -193,17 +228,167 @@ public:
         outNormals.reserve(estimatedVertexCount);
         outIndices.reserve(estimatedVertexCount);
 
+        AppendSlicedTriangles(inVertices.data(), inNormals.empty() ? NULL : inNormals.data(), inIndices.data(), inIndices.size() / 3,
+                              outVertices, outNormals, outIndices);
+        if (weldOutput) {
+            WeldSlicedMesh(outVertices, outNormals, outIndices);
+            // Face normals (the input had none) are smoothed over the welded vertices
+            if (inNormals.empty()) {
+                ComputeVertexNormals(outVertices.data(), outVertices.size(), outIndices.data(), outIndices.size() / 3,
+                                     outNormals);
+                outputMem.Set(VectorBytes(outVertices) + VectorBytes(outNormals) + VectorBytes(outIndices));
+            }
+        }
+    }
+
+    // ############################################################################################
+    // Weld the sliced mesh: every clipped polygon gets its own copies of its corners, so
+    // without this no two output triangles share a vertex. Cut edges are interpolated from
+    // either side, so the positions are merged within the weld tolerance rather than exactly.
+    // Normals (if there is one per vertex) follow the first vertex of each welded group.
+    WeldStats WeldSlicedMesh(std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals,
+                             std::vector<unsigned int>& indices) {
+        Vector3f low(0.0f, 0.0f, 0.0f), high(0.0f, 0.0f, 0.0f);
+        if (!vertices.empty()) low = high = vertices[0];
+        for (size_t i = 1; i < vertices.size(); i++) {
+            low = Vector3f(std::min(low.x, vertices[i].x), std::min(low.y, vertices[i].y), std::min(low.z, vertices[i].z));
+            high = Vector3f(std::max(high.x, vertices[i].x), std::max(high.y, vertices[i].y), std::max(high.z, vertices[i].z));
+        }
+        Vector3f size = high - low;
+        float extent = std::max(size.x, std::max(size.y, size.z));
+
+        std::vector<uint32_t> remap;
+        lastWeld = WeldVertices(vertices, indices, weldTolerance * extent, &remap);
+        if (normals.size() == lastWeld.inputVertices) WeldAttribute(normals, remap, lastWeld.outputVertices);
+        outputMem.Set(VectorBytes(vertices) + VectorBytes(normals) + VectorBytes(indices));
+        return lastWeld;
+    }
+
+    // ############################################################################################
+    // Slice a batch of triangles and append the result to the output mesh. Meshes that are
+    // streamed in batches can be sliced piece by piece this way; only the vertex array has to
+    // be complete. Without normals (NULL), the pieces get their triangle's face normal.
+    //
+    // Large batches are sliced on all threads: fixed chunks of triangles are sliced into
+    // their own buffers, a prefix sum over the chunks' vertex and index counts gives every
+    // chunk its place in the output, and the chunks are copied there in parallel with their
+    // indices rebased. Chunks do not depend on the thread count and are merged in order, so
+    // the output is identical to slicing the triangles one after another.
+    void AppendSlicedTriangles(
+        const Vector3f* inVertices,
+        const Vector3f* inNormals,
+        const unsigned int* inIndices,
+        size_t triangleCount,
+        std::vector<Vector3f>& outVertices,
+        std::vector<Vector3f>& outNormals,
+        std::vector<unsigned int>& outIndices
+    ) {
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        size_t chunkCount = (triangleCount + SLICE_CHUNK_TRIANGLES - 1) / SLICE_CHUNK_TRIANGLES;
+        lastSliceThreads = chunkCount <= 1 ? 1 : threads;
+        if (threads == 1 || chunkCount <= 1) {
+            SliceTriangleRange(inVertices, inNormals, inIndices, 0, triangleCount, outVertices, outNormals, outIndices);
+            outputMem.Set(VectorBytes(outVertices) + VectorBytes(outNormals) + VectorBytes(outIndices));
+            return;
+        }
+
+        std::vector<SlicedChunk> chunks(chunkCount);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (long long c = 0; c < static_cast<long long>(chunkCount); c++) {
+            size_t first = static_cast<size_t>(c) * SLICE_CHUNK_TRIANGLES;
+            SlicedChunk& chunk = chunks[c];
+            SliceTriangleRange(inVertices, inNormals, inIndices, first, std::min(triangleCount, first + SLICE_CHUNK_TRIANGLES),
+                               chunk.vertices, chunk.normals, chunk.indices);
+        }
+
+        // Every chunk's first vertex and index in the output (one key, a slot per chunk)
+        std::vector<size_t> vertexStart(chunkCount), indexStart(chunkCount);
+        size_t scratchBytes = 0;
+        for (size_t c = 0; c < chunkCount; c++) {
+            vertexStart[c] = chunks[c].vertices.size();
+            indexStart[c] = chunks[c].indices.size();
+            scratchBytes += VectorBytes(chunks[c].vertices) + VectorBytes(chunks[c].normals) + VectorBytes(chunks[c].indices);
+        }
+        MemAccount scratchMem(MEM_TEMPORARY);
+        scratchMem.Set(scratchBytes);
+        size_t vertexEnd = ChunkSlotOffsets(vertexStart.data(), 1, chunkCount, outVertices.size());
+        size_t indexEnd = ChunkSlotOffsets(indexStart.data(), 1, chunkCount, outIndices.size());
+        outVertices.resize(vertexEnd);
+        outNormals.resize(vertexEnd);
+        outIndices.resize(indexEnd);
+
+        Vector3f* vertexOut = outVertices.data();
+        Vector3f* normalOut = outNormals.data();
+        unsigned int* indexOut = outIndices.data();
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (long long c = 0; c < static_cast<long long>(chunkCount); c++) {
+            SlicedChunk& chunk = chunks[c];
+            std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertexOut + vertexStart[c]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normalOut + vertexStart[c]);
+            unsigned int base = static_cast<unsigned int>(vertexStart[c]);
+            unsigned int* index = indexOut + indexStart[c];
+            for (size_t k = 0; k < chunk.indices.size(); k++) index[k] = chunk.indices[k] + base;
+            chunk = SlicedChunk();
+        }
+        outputMem.Set(VectorBytes(outVertices) + VectorBytes(outNormals) + VectorBytes(outIndices));
+    }
+
+private:
+    // Triangles per chunk of the parallel slicer
+    static const size_t SLICE_CHUNK_TRIANGLES = 16384;
+
+    // Most vertices a clipped polygon can have. A plane adds at most one vertex to a convex
+    // polygon, so a triangle cut by 4 planes has at most 7; rounding can leave a nearly
+    // degenerate polygon slightly non-convex, and a plane then grows it by half at most,
+    // so 16 (3, 4, 6, 9, 13) can never overflow.
+    static const int MAX_CLIP_VERTICES = 16;
+
+    // A polygon being clipped, kept on the stack
+    struct ClipPolygon {
+        Vector3f vertices[MAX_CLIP_VERTICES];
+        Vector3f normals[MAX_CLIP_VERTICES];
+        int size;
+    };
+
+    // One chunk's sliced polygons, indexed from 0
+    struct SlicedChunk {
+        std::vector<Vector3f> vertices;
+        std::vector<Vector3f> normals;
+        std::vector<unsigned int> indices;
+    };
+
+    // ############################################################################################
+    // Slice the triangles [first, last) and append the pieces to the output, one triangle
+    // after another
+    void SliceTriangleRange(
+        const Vector3f* inVertices,
+        const Vector3f* inNormals,
+        const unsigned int* inIndices,
+        size_t first,
+        size_t last,
+        std::vector<Vector3f>& outVertices,
+        std::vector<Vector3f>& outNormals,
+        std::vector<unsigned int>& outIndices
+    ) {
         // Process each triangle
-        for (size_t i = 0; i < inIndices.size(); i += 3) {
+        for (size_t i = first * 3; i < last * 3; i += 3) {
             // Get the three vertices of the triangle
             Vector3f v0 = inVertices[inIndices[i]];
             Vector3f v1 = inVertices[inIndices[i + 1]];
             Vector3f v2 = inVertices[inIndices[i + 2]];
 
             // Get the three normals of the triangle
-            Vector3f n0 = inNormals[inIndices[i]];
-            Vector3f n1 = inNormals[inIndices[i + 1]];
-            Vector3f n2 = inNormals[inIndices[i + 2]];
+            Vector3f n0, n1, n2;
+            if (inNormals) {
+                n0 = inNormals[inIndices[i]];
+                n1 = inNormals[inIndices[i + 1]];
+                n2 = inNormals[inIndices[i + 2]];
+            } else {
+                n0 = n1 = n2 = FaceNormal(v0, v1, v2);
+            }
 
             // Skip triangles where all vertices are outside any plane
             bool anyInside = false;
@@ -226,28 +411,33 @@ public:
             
             if (allOutside) continue; // Skip this triangle
             
-            // Process the triangle against all planes
-            std::vector<Vector3f> triangleVertices = { v0, v1, v2 };
-            std::vector<Vector3f> triangleNormals = { n0, n1, n2 };
-
-            // Apply each plane to the triangle
+            // Clip the triangle by every plane, ping-ponging between two polygons on the stack
+            ClipPolygon buffers[2];
+            ClipPolygon* polygon = &buffers[0];
+            ClipPolygon* clipped = &buffers[1];
+            polygon->size = 3;
+            polygon->vertices[0] = v0;
+            polygon->vertices[1] = v1;
+            polygon->vertices[2] = v2;
+            polygon->normals[0] = n0;
+            polygon->normals[1] = n1;
+            polygon->normals[2] = n2;
             for (const auto& plane : planes) {
-                SliceTriangleWithPlane(triangleVertices, triangleNormals, plane);
+                ClipPolygonByPlane(*polygon, plane, *clipped);
+                std::swap(polygon, clipped);
             }
 
             // Add the resulting polygon to the output mesh
-            if (triangleVertices.size() >= 3) {
+            if (polygon->size >= 3) {
                 // Triangulate the polygon (simple fan triangulation)
                 unsigned int baseIndex = outVertices.size();
                 
                 // Add all vertices and normals
-                for (size_t j = 0; j < triangleVertices.size(); j++) {
-                    outVertices.push_back(triangleVertices[j]);
-                    outNormals.push_back(triangleNormals[j]);
-                }
+                outVertices.insert(outVertices.end(), polygon->vertices, polygon->vertices + polygon->size);
+                outNormals.insert(outNormals.end(), polygon->normals, polygon->normals + polygon->size);
                 
                 // Create triangles - fan triangulation
-                for (size_t j = 1; j < triangleVertices.size() - 1; j++) {
+                for (int j = 1; j < polygon->size - 1; j++) {
                     outIndices.push_back(baseIndex);
                     outIndices.push_back(baseIndex + j);
                     outIndices.push_back(baseIndex + j + 1);
@@ -256,50 +446,44 @@ public:
         }
     }
 
-private:
     // ############################################################################################
-    // Slice a polygon with a plane
-    void SliceTriangleWithPlane(
-        std::vector<Vector3f>& vertices,
-        std::vector<Vector3f>& normals,
-        const Plane& plane
+    // Clip a polygon with a plane, keeping the inside part, into 'result' (never the input)
+    void ClipPolygonByPlane(
+        const ClipPolygon& polygon,
+        const Plane& plane,
+        ClipPolygon& result
     ) {
-        if (vertices.empty() || vertices.size() != normals.size()) return;
-        
-        std::vector<Vector3f> resultVertices;
-        std::vector<Vector3f> resultNormals;
+        result.size = 0;
         
         // Classify all vertices (inside/outside/on the plane)
-        std::vector<int> classification;
-        classification.reserve(vertices.size());
-        
-        for (size_t i = 0; i < vertices.size(); i++) {
-            float dist = plane.SignedDistance(vertices[i]);
+        int classification[MAX_CLIP_VERTICES];
+        for (int i = 0; i < polygon.size; i++) {
+            float dist = plane.SignedDistance(polygon.vertices[i]);
             if (std::abs(dist) < EPSILON) {
-                classification.push_back(0);  // On the plane
+                classification[i] = 0;  // On the plane
             } else if (dist < 0) {
-                classification.push_back(-1); // Inside
+                classification[i] = -1; // Inside
             } else {
-                classification.push_back(1);  // Outside
+                classification[i] = 1;  // Outside
             }
         }
         
         // Process each edge
-        for (size_t i = 0; i < vertices.size(); i++) {
-            size_t j = (i + 1) % vertices.size();
+        for (int i = 0; i < polygon.size; i++) {
+            int j = (i + 1) % polygon.size;
             
-            Vector3f currentVertex = vertices[i];
-            Vector3f nextVertex = vertices[j];
-            Vector3f currentNormal = normals[i];
-            Vector3f nextNormal = normals[j];
+            const Vector3f& currentVertex = polygon.vertices[i];
+            const Vector3f& nextVertex = polygon.vertices[j];
+            const Vector3f& currentNormal = polygon.normals[i];
+            const Vector3f& nextNormal = polygon.normals[j];
             
             int currentClass = classification[i];
             int nextClass = classification[j];
             
             // Current vertex processing
             if (currentClass <= 0) { // Inside or on the plane
-                resultVertices.push_back(currentVertex);
-                resultNormals.push_back(currentNormal);
+                result.vertices[result.size] = currentVertex;
+                result.normals[result.size++] = currentNormal;
             }
             
             // Intersection calculation if vertices are on opposite sides
@@ -312,14 +496,10 @@ private:
                     currentNormal, nextNormal, currentVertex, nextVertex, intersection);
                 interpolatedNormal.Normalize();
                 
-                resultVertices.push_back(intersection);
-                resultNormals.push_back(interpolatedNormal);
+                result.vertices[result.size] = intersection;
+                result.normals[result.size++] = interpolatedNormal;
             }
         }
-        
-        // Update the input vectors with the result
-        vertices = resultVertices;
-        normals = resultNormals;
     }
 
     // ############################################################################################
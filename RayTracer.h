@@ -2,6 +2,17 @@
 #define RAY_TRACER_H
 
 #include "./include/math_utils.h"
+#include "./include/mem_stats.h"
+#include "./include/alloc_policy.h"
+#include "./include/tone_map.h"
+#include "./include/png_io.h"
+#include "./include/stream_writer.h"
+#include "./include/ppm_text.h"
+#include "./include/hdr_io.h"
+#include "./include/mapped_file.h"
+#include "./include/resample.h"
+#include "./include/mesh_binary.h"
+#include "./include/mesh_normals.h"
 #include <vector>
 #include <cmath>
 #include <algorithm>
@@ -11,6 +22,7 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <atomic>
 
 // ############################################################################################
 // Ray structure for ray tracing
@@ -56,19 +68,48 @@ public:
           reflectivity(reflect) {}
 };
 
-// Forward declaration
+// Pixel storage allocated with the configured allocation policy
+typedef std::vector<unsigned char, PolicyAllocator<unsigned char> > PixelBuffer;
+typedef std::vector<float, PolicyAllocator<float> > HdrBuffer;
+
+// Forward declaration; returns false if the mesh could not be loaded
 class RayTracer;
-void addMeshFromFile(RayTracer& rayTracer, const std::string& filename, const Vector3f& position, 
+bool addMeshFromFile(RayTracer& rayTracer, const std::string& filename, const Vector3f& position, 
                      float scale, const Material& material);
 
 // ############################################################################################
-// Hit record to store intersection information
+// Size and timing of a scene file load
+struct SceneParseStats {
+    size_t fileBytes = 0;
+    size_t lines = 0;
+    size_t objects = 0;         // Spheres, boxes, triangles and OFF models
+    size_t lights = 0;
+    size_t skippedLines = 0;    // Lines with a keyword but too few values
+    double seconds = 0.0;
+
+    double megabytesPerSecond() const {
+        return seconds > 0.0 ? fileBytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+// ############################################################################################
+// Hit record filled during traversal - only what is needed to find the closest hit.
+// Shading data (point, normal, material) is fetched once for the final hit via getSurface().
 struct HitRecord {
-    float t;             // Distance along the ray
-    Vector3f point;      // Intersection point
-    Vector3f normal;     // Surface normal at intersection
-    bool frontFace;      // Whether the ray hit the front face
-    Material material;   // Material of the hit object
+    float t;                // Distance along the ray
+    unsigned int primID;    // Primitive that was hit (local to the object, global after HittableList)
+    float u, v;             // Barycentric coordinates, or primitive-specific hit data
+};
+
+static_assert(sizeof(HitRecord) == 16, "HitRecord should stay 16 bytes");
+
+// ############################################################################################
+// Shading information for the closest hit
+struct SurfaceInteraction {
+    Vector3f point;             // Intersection point
+    Vector3f normal;            // Surface normal at intersection
+    bool frontFace;             // Whether the ray hit the front face
+    const Material* material;   // Material of the hit object
     
     // ############################################################################################
     // Set the normal and determine front face
@@ -87,10 +128,53 @@ public:
     Hittable() : material() {}
     Hittable(const Material& mat) : material(mat) {}
     
+    // Scene objects live in the SceneArena so they follow the configured allocation policy
+    static void* operator new(size_t size) { return SceneArena::Instance().Allocate(size); }
+    static void operator delete(void* ptr) { SceneArena::Instance().Deallocate(ptr); }
+    
     virtual bool hit(const Ray& ray, float tMin, float tMax, HitRecord& rec) const = 0;
+    
+    // Compute point, normal and material for a hit previously returned by hit()
+    virtual void getSurface(const Ray& ray, const HitRecord& rec, SurfaceInteraction& surf) const = 0;
+    
+    // Number of primitive IDs this object uses
+    virtual unsigned int primitiveCount() const { return 1; }
+    
+    // Size of the concrete object, used for memory accounting
+    virtual size_t byteSize() const = 0;
     virtual ~Hittable() {}
 };
 
+// ############################################################################################
+// Ray-sphere intersection; fills t of the record with the nearest root in [tMin, tMax]
+inline bool IntersectSphere(const Ray& ray, const Vector3f& center, float radius, float tMin, float tMax,
+                            HitRecord& rec) {
+    Vector3f oc = ray.origin - center;
+    float a = ray.direction.Dot(ray.direction);
+    float half_b = oc.Dot(ray.direction);
+    float c = oc.Dot(oc) - radius * radius;
+    
+    float discriminant = half_b * half_b - a * c;
+    if (discriminant < 0) {
+        return false;
+    }
+    
+    float sqrtd = sqrt(discriminant);
+    
+    // Find the nearest root that lies in the acceptable range
+    float root = (-half_b - sqrtd) / a;
+    if (root < tMin || root > tMax) {
+        root = (-half_b + sqrtd) / a;
+        if (root < tMin || root > tMax) {
+            return false;
+        }
+    }
+    
+    rec.t = root;
+    rec.u = rec.v = 0.0f;
+    return true;
+}
+
 // ############################################################################################
 // Sphere class - represents a sphere in 3D space
 class Sphere : public Hittable {
@@ -104,38 +188,97 @@ public:
     // ############################################################################################
     // Ray-sphere intersection test
     virtual bool hit(const Ray& ray, float tMin, float tMax, HitRecord& rec) const override {
-        Vector3f oc = ray.origin - center;
-        float a = ray.direction.Dot(ray.direction);
-        float half_b = oc.Dot(ray.direction);
-        float c = oc.Dot(oc) - radius * radius;
-        
-        float discriminant = half_b * half_b - a * c;
-        if (discriminant < 0) {
+        if (!IntersectSphere(ray, center, radius, tMin, tMax, rec)) {
             return false;
         }
-        
-        float sqrtd = sqrt(discriminant);
-        
-        // Find the nearest root that lies in the acceptable range
-        float root = (-half_b - sqrtd) / a;
-        if (root < tMin || root > tMax) {
-            root = (-half_b + sqrtd) / a;
-            if (root < tMin || root > tMax) {
+        rec.primID = 0;
+        return true;
+    }
+    
+    // ############################################################################################
+    // Shading data for a sphere hit
+    virtual void getSurface(const Ray& ray, const HitRecord& rec, SurfaceInteraction& surf) const override {
+        surf.point = ray.origin + ray.direction * rec.t;
+        Vector3f outwardNormal = (surf.point - center) * (1.0f / radius);
+        surf.setFaceNormal(ray, outwardNormal);
+        surf.material = &material;
+    }
+    
+    virtual size_t byteSize() const override { return sizeof(Sphere); }
+};
+
+// ############################################################################################
+// Ray-box intersection using the slab method. The slab that was hit is stored in the record
+// (u = axis, v = 1 for the min side) so the normal can be rebuilt by BoxNormal().
+inline bool IntersectBox(const Ray& ray, const Vector3f& boxMin, const Vector3f& boxMax, float tMin, float tMax,
+                         HitRecord& rec) {
+    float tNear = tMin;
+    float tFar = tMax;
+    int hitAxis = -1;
+    bool hitIsMin = false;
+    
+    // Check intersection with each pair of planes (slabs)
+    for (int i = 0; i < 3; i++) {
+        if (std::abs(ray.direction[i]) < 1e-8) {
+            // Ray is parallel to this axis
+            if (ray.origin[i] < boxMin[i] || ray.origin[i] > boxMax[i]) {
                 return false;
             }
+        } else {
+            // Calculate intersections with planes perpendicular to this axis
+            float invD = 1.0f / ray.direction[i];
+            float t0 = (boxMin[i] - ray.origin[i]) * invD;
+            float t1 = (boxMax[i] - ray.origin[i]) * invD;
+            
+            if (t0 > t1) std::swap(t0, t1);
+            
+            if (t0 > tNear) {
+                tNear = t0;
+                hitAxis = i;
+                hitIsMin = true;
+            }
+            if (t1 < tFar) {
+                tFar = t1;
+                if (t1 < t0) {
+                    hitAxis = i;
+                    hitIsMin = false;
+                }
+            }
+            
+            if (tNear > tFar) return false;
+            if (tFar < tMin) return false;
         }
-        
-        rec.t = root;
-        rec.point = ray.origin + ray.direction * rec.t;
-        Vector3f outwardNormal = (rec.point - center) * (1.0f / radius);
-        rec.setFaceNormal(ray, outwardNormal);
-        
-        // If hit, set the material
-        rec.material = material;
-        
-        return true;
     }
-};
+    
+    if (tNear > tMax) return false;
+    
+    rec.t = tNear;
+    rec.u = static_cast<float>(hitAxis);
+    rec.v = hitIsMin ? 1.0f : 0.0f;
+    return true;
+}
+
+// ############################################################################################
+// Outward normal of the box side recorded by IntersectBox()
+inline Vector3f BoxNormal(const HitRecord& rec) {
+    int hitAxis = static_cast<int>(rec.u);
+    bool hitIsMin = rec.v > 0.5f;
+    
+    // Calculate normal based on which face was hit
+    Vector3f outwardNormal;
+    outwardNormal.SetZero();
+    if (hitAxis >= 0) {
+        // Set the normal based on the hit axis
+        if (hitAxis == 0) {
+            outwardNormal.x = hitIsMin ? -1.0f : 1.0f;
+        } else if (hitAxis == 1) {
+            outwardNormal.y = hitIsMin ? -1.0f : 1.0f;
+        } else if (hitAxis == 2) {
+            outwardNormal.z = hitIsMin ? -1.0f : 1.0f;
+        }
+    }
+    return outwardNormal;
+}
 
 // ############################################################################################
 // Axis-aligned box class - represents a box with sides parallel to the axes
@@ -151,72 +294,69 @@ public:
     // ############################################################################################
     // Ray-box intersection test using slab method
     virtual bool hit(const Ray& ray, float tMin, float tMax, HitRecord& rec) const override {
-        float tNear = tMin;
-        float tFar = tMax;
-        int hitAxis = -1;
-        bool hitIsMin = false;
-        
-        // Check intersection with each pair of planes (slabs)
-        for (int i = 0; i < 3; i++) {
-            if (std::abs(ray.direction[i]) < 1e-8) {
-                // Ray is parallel to this axis
-                if (ray.origin[i] < boxMin[i] || ray.origin[i] > boxMax[i]) {
-                    return false;
-                }
-            } else {
-                // Calculate intersections with planes perpendicular to this axis
-                float invD = 1.0f / ray.direction[i];
-                float t0 = (boxMin[i] - ray.origin[i]) * invD;
-                float t1 = (boxMax[i] - ray.origin[i]) * invD;
-                
-                if (t0 > t1) std::swap(t0, t1);
-                
-                if (t0 > tNear) {
-                    tNear = t0;
-                    hitAxis = i;
-                    hitIsMin = true;
-                }
-                if (t1 < tFar) {
-                    tFar = t1;
-                    if (t1 < t0) {
-                        hitAxis = i;
-                        hitIsMin = false;
-                    }
-                }
-                
-                if (tNear > tFar) return false;
-                if (tFar < tMin) return false;
-            }
-        }
-        
-        if (tNear > tMax) return false;
-        
-        rec.t = tNear;
-        rec.point = ray.origin + ray.direction * rec.t;
-        
-        // Calculate normal based on which face was hit
-        Vector3f outwardNormal;
-        outwardNormal.SetZero();
-        if (hitAxis >= 0) {
-            // Set the normal based on the hit axis
-            if (hitAxis == 0) {
-                outwardNormal.x = hitIsMin ? -1.0f : 1.0f;
-            } else if (hitAxis == 1) {
-                outwardNormal.y = hitIsMin ? -1.0f : 1.0f;
-            } else if (hitAxis == 2) {
-                outwardNormal.z = hitIsMin ? -1.0f : 1.0f;
-            }
+        if (!IntersectBox(ray, boxMin, boxMax, tMin, tMax, rec)) {
+            return false;
         }
-        
-        rec.setFaceNormal(ray, outwardNormal);
-        
-        // If hit, set the material
-        rec.material = material;
-        
+        rec.primID = 0;
         return true;
     }
+    
+    // ############################################################################################
+    // Shading data for a box hit
+    virtual void getSurface(const Ray& ray, const HitRecord& rec, SurfaceInteraction& surf) const override {
+        surf.point = ray.origin + ray.direction * rec.t;
+        surf.setFaceNormal(ray, BoxNormal(rec));
+        surf.material = &material;
+    }
+    
+    virtual size_t byteSize() const override { return sizeof(Box); }
 };
 
+// ############################################################################################
+// Möller–Trumbore ray-triangle intersection; fills t, u and v of the record on a hit
+inline bool IntersectTriangle(const Ray& ray, const Vector3f& v0, const Vector3f& v1, const Vector3f& v2,
+                              float tMin, float tMax, HitRecord& rec) {
+    Vector3f edge1 = v1 - v0;
+    Vector3f edge2 = v2 - v0;
+    Vector3f h = ray.direction.Cross(edge2);
+    float a = edge1.Dot(h);
+    
+    // If determinant is near zero, ray lies in plane of triangle
+    if (std::abs(a) < 1e-8) {
+        return false;
+    }
+    
+    float f = 1.0f / a;
+    Vector3f s = ray.origin - v0;
+    float u = f * s.Dot(h);
+    
+    // If u is outside [0, 1], ray doesn't intersect triangle
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+    
+    Vector3f q = s.Cross(edge1);
+    float v = f * ray.direction.Dot(q);
+    
+    // If v is outside [0, 1] or u+v > 1, ray doesn't intersect triangle
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+    
+    // Calculate t, the distance along the ray to the intersection
+    float t = f * edge2.Dot(q);
+    
+    // Check if t is within the allowed range
+    if (t < tMin || t > tMax) {
+        return false;
+    }
+    
+    rec.t = t;
+    rec.u = u;
+    rec.v = v;
+    return true;
+}
+
 // ############################################################################################
 // Triangle class - represents a triangle in 3D space
 class Triangle : public Hittable {
@@ -228,69 +368,155 @@ public:
     // Constructor that calculates the face normal from vertices
     Triangle(const Vector3f& _v0, const Vector3f& _v1, const Vector3f& _v2)
         : v0(_v0), v1(_v1), v2(_v2) {
-        // Calculate face normal
-        Vector3f edge1 = v1 - v0;
-        Vector3f edge2 = v2 - v0;
-        normal = edge1.Cross(edge2);
-        normal.Normalize();
+        normal = FaceNormal(v0, v1, v2);
     }
     
     // ############################################################################################
     // Constructor with material
     Triangle(const Vector3f& _v0, const Vector3f& _v1, const Vector3f& _v2, const Material& mat)
         : Hittable(mat), v0(_v0), v1(_v1), v2(_v2) {
-        // Calculate face normal
-        Vector3f edge1 = v1 - v0;
-        Vector3f edge2 = v2 - v0;
-        normal = edge1.Cross(edge2);
-        normal.Normalize();
+        normal = FaceNormal(v0, v1, v2);
     }
     
     // ############################################################################################
     // Ray-triangle intersection test using Möller–Trumbore algorithm
     virtual bool hit(const Ray& ray, float tMin, float tMax, HitRecord& rec) const override {
-        // Implementation of Möller–Trumbore algorithm for ray-triangle intersection
-        Vector3f edge1 = v1 - v0;
-        Vector3f edge2 = v2 - v0;
-        Vector3f h = ray.direction.Cross(edge2);
-        float a = edge1.Dot(h);
-        
-        // If determinant is near zero, ray lies in plane of triangle
-        if (std::abs(a) < 1e-8) {
+        if (!IntersectTriangle(ray, v0, v1, v2, tMin, tMax, rec)) {
             return false;
         }
+        rec.primID = 0;
+        return true;
+    }
+    
+    // ############################################################################################
+    // Shading data for a triangle hit
+    virtual void getSurface(const Ray& ray, const HitRecord& rec, SurfaceInteraction& surf) const override {
+        surf.point = ray.origin + ray.direction * rec.t;
+        surf.setFaceNormal(ray, normal);
+        surf.material = &material;
+    }
+    
+    virtual size_t byteSize() const override { return sizeof(Triangle); }
+};
+
+// ############################################################################################
+// Triangle mesh that traces the arrays of a mapped binary mesh in place, with a uniform
+// scale and translation applied to the rays instead of the vertices. Primitive IDs are
+// triangle indices. The BVH of the file is used when present.
+class TriangleMesh : public Hittable {
+public:
+    TriangleMesh(std::shared_ptr<const MeshBinary> meshData, const Vector3f& pos, float meshScale, const Material& mat)
+        : Hittable(mat), data(meshData), position(pos), scale(meshScale), invScale(1.0f / meshScale) {}
+    
+    // ############################################################################################
+    // Intersect in object space: p' = (p - position) / scale keeps the ray parameter t
+    virtual bool hit(const Ray& ray, float tMin, float tMax, HitRecord& rec) const override {
+        Ray local = ray;
+        local.origin = (ray.origin - position) * invScale;
+        local.direction = ray.direction * invScale;
         
-        float f = 1.0f / a;
-        Vector3f s = ray.origin - v0;
-        float u = f * s.Dot(h);
-        
-        // If u is outside [0, 1], ray doesn't intersect triangle
-        if (u < 0.0f || u > 1.0f) {
-            return false;
-        }
+        const BvhNode* nodes = data->bvh();
+        bool hitAnything = false;
         
-        Vector3f q = s.Cross(edge1);
-        float v = f * ray.direction.Dot(q);
+        if (!nodes) return hitTriangles(local, 0, data->triangleCount(), tMin, tMax, rec);
         
-        // If v is outside [0, 1] or u+v > 1, ray doesn't intersect triangle
-        if (v < 0.0f || u + v > 1.0f) {
-            return false;
+        // Iterative traversal, nearer child first
+        float inv[3] = { 1.0f / local.direction.x, 1.0f / local.direction.y, 1.0f / local.direction.z };
+        float org[3] = { local.origin.x, local.origin.y, local.origin.z };
+        uint32_t stack[STACK_SIZE];
+        int depth = 0;
+        uint32_t node = 0;
+        float entry;
+        if (!boxHit(nodes[0], org, inv, tMin, tMax, entry)) return false;
+        for (;;) {
+            const BvhNode& n = nodes[node];
+            if (n.count > 0) {
+                if (hitTriangles(local, n.first, n.count, tMin, tMax, rec)) {
+                    tMax = rec.t;
+                    hitAnything = true;
+                }
+            } else {
+                float tLeft, tRight;
+                bool hitLeft = boxHit(nodes[n.first], org, inv, tMin, tMax, tLeft);
+                bool hitRight = boxHit(nodes[n.first + 1], org, inv, tMin, tMax, tRight);
+                if (hitLeft && hitRight) {
+                    // Deeper than any validated tree: test every triangle rather than overflow
+                    if (depth == STACK_SIZE) {
+                        return hitTriangles(local, 0, data->triangleCount(), tMin, tMax, rec) || hitAnything;
+                    }
+                    bool leftFirst = tLeft <= tRight;
+                    stack[depth++] = leftFirst ? n.first + 1 : n.first;
+                    node = leftFirst ? n.first : n.first + 1;
+                    continue;
+                }
+                if (hitLeft || hitRight) {
+                    node = hitLeft ? n.first : n.first + 1;
+                    continue;
+                }
+            }
+            if (depth == 0) break;
+            node = stack[--depth];
         }
-        
-        // Calculate t, the distance along the ray to the intersection
-        float t = f * edge2.Dot(q);
-        
-        // Check if t is within the allowed range
-        if (t < tMin || t > tMax) {
-            return false;
+        return hitAnything;
+    }
+    
+    // ############################################################################################
+    // Shading data: hit point and the triangle's face normal (unchanged by uniform scaling)
+    virtual void getSurface(const Ray& ray, const HitRecord& rec, SurfaceInteraction& surf) const override {
+        const Vector3f* vertices = data->vertices();
+        const uint32_t* tri = data->indices() + rec.primID * 3;
+        Vector3f normal = FaceNormal(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]]);
+        surf.point = ray.origin + ray.direction * rec.t;
+        surf.setFaceNormal(ray, scale < 0.0f ? -normal : normal);
+        surf.material = &material;
+    }
+    
+    virtual unsigned int primitiveCount() const override { return data->triangleCount(); }
+    
+    virtual size_t byteSize() const override { return sizeof(TriangleMesh); }
+    
+    const std::shared_ptr<const MeshBinary>& getMeshData() const { return data; }
+    const Vector3f& getPosition() const { return position; }
+    float getScale() const { return scale; }
+    
+private:
+    static const int STACK_SIZE = MAX_BVH_DEPTH + 1;
+
+    std::shared_ptr<const MeshBinary> data;
+    Vector3f position;
+    float scale;
+    float invScale;
+    
+    // ############################################################################################
+    // Closest hit among 'count' triangles from 'first', nearer than 'tMax'
+    bool hitTriangles(const Ray& local, uint32_t first, uint32_t count, float tMin, float tMax,
+                      HitRecord& rec) const {
+        const Vector3f* vertices = data->vertices();
+        const uint32_t* indices = data->indices();
+        bool hitAnything = false;
+        for (uint32_t t = first; t < first + count; t++) {
+            if (IntersectTriangle(local, vertices[indices[t * 3]], vertices[indices[t * 3 + 1]],
+                                  vertices[indices[t * 3 + 2]], tMin, tMax, rec)) {
+                rec.primID = t;
+                tMax = rec.t;
+                hitAnything = true;
+            }
         }
-        
-        // Intersection found, fill the record
-        rec.t = t;
-        rec.point = ray.origin + ray.direction * t;
-        rec.setFaceNormal(ray, normal);
-        rec.material = material;
-        
+        return hitAnything;
+    }
+    
+    // ############################################################################################
+    // Slab test against a node's box; 'entry' receives the distance where the ray enters it
+    static bool boxHit(const BvhNode& node, const float* org, const float* inv, float tMin, float tMax, float& entry) {
+        for (int axis = 0; axis < 3; axis++) {
+            float t0 = (node.lo[axis] - org[axis]) * inv[axis];
+            float t1 = (node.hi[axis] - org[axis]) * inv[axis];
+            if (t0 > t1) std::swap(t0, t1);
+            tMin = t0 > tMin ? t0 : tMin;
+            tMax = t1 < tMax ? t1 : tMax;
+            if (tMax < tMin) return false;
+        }
+        entry = tMin;
         return true;
     }
 };
@@ -312,13 +538,24 @@ public:
 class HittableList : public Hittable {
 public:
     std::vector<Hittable*> objects;
+    std::vector<unsigned int> firstPrimID;     // First global primitive ID of each object
+    unsigned int totalPrimitives = 0;
     
     HittableList() {}
     
+    // ############################################################################################
+    // Preallocate the object list for 'count' objects
+    void reserve(size_t count) {
+        objects.reserve(count);
+        firstPrimID.reserve(count);
+    }
+    
     // ############################################################################################
     // Add an object to the scene
     void add(Hittable* object) {
         objects.push_back(object);
+        firstPrimID.push_back(totalPrimitives);
+        totalPrimitives += object->primitiveCount();
     }
     
     // ############################################################################################
@@ -329,26 +566,52 @@ public:
             delete obj;
         }
         objects.clear();
+        firstPrimID.clear();
+        totalPrimitives = 0;
     }
     
     // ############################################################################################
     // Ray-scene intersection test - checks all objects and returns the closest hit
+    // The primitive ID is made global by offsetting it with the object's first ID
     virtual bool hit(const Ray& ray, float tMin, float tMax, HitRecord& rec) const override {
         HitRecord tempRec;
         bool hitAnything = false;
         float closestSoFar = tMax;
         
-        for (const auto* object : objects) {
-            if (object->hit(ray, tMin, closestSoFar, tempRec)) {
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (objects[i]->hit(ray, tMin, closestSoFar, tempRec)) {
                 hitAnything = true;
                 closestSoFar = tempRec.t;
                 rec = tempRec;
+                rec.primID += firstPrimID[i];
             }
         }
         
         return hitAnything;
     }
     
+    // ############################################################################################
+    // Find the object owning the global primitive ID and let it compute the shading data
+    virtual void getSurface(const Ray& ray, const HitRecord& rec, SurfaceInteraction& surf) const override {
+        size_t index;
+        if (totalPrimitives == objects.size()) {
+            index = rec.primID; // One primitive per object
+        } else {
+            index = std::upper_bound(firstPrimID.begin(), firstPrimID.end(), rec.primID) - firstPrimID.begin() - 1;
+        }
+        
+        HitRecord localRec = rec;
+        localRec.primID -= firstPrimID[index];
+        objects[index]->getSurface(ray, localRec, surf);
+    }
+    
+    virtual unsigned int primitiveCount() const override { return totalPrimitives; }
+    
+    // Bytes used by the object list and primitive ID table
+    size_t indexBytes() const { return VectorBytes(objects) + VectorBytes(firstPrimID); }
+    
+    virtual size_t byteSize() const override { return sizeof(HittableList); }
+    
     // ############################################################################################
     // Destructor - ensures all objects are properly deleted
     ~HittableList() {
@@ -369,6 +632,12 @@ public:
     Vector3f horizontal;
     Vector3f vertical;
     
+    // Parameters the camera was set up from, kept so the scene can be saved
+    Vector3f lookFrom;
+    Vector3f lookAt;
+    Vector3f vup;
+    float vfov;
+    
     // ############################################################################################
     // Constructor - sets up camera parameters
     Camera(
@@ -377,7 +646,7 @@ public:
         Vector3f vup,
         float vfov, // vertical field-of-view in degrees
         float aspect // aspect ratio
-    ) {
+    ) : lookFrom(lookFrom), lookAt(lookAt), vup(vup), vfov(vfov) {
         float theta = vfov * 3.1415926f / 180.0f;
         float h = tan(theta / 2);
         float viewport_height = 2.0f * h;
@@ -436,6 +705,7 @@ public:
         delete camera;
         camera = new Camera(lookFrom, lookAt, up, fov, 
                             static_cast<float>(imageWidth) / imageHeight);
+        hdrValid = false;
     }
 
     // ############################################################################################
@@ -443,21 +713,38 @@ public:
     void addLight(const Vector3f& position, const Vector3f& color = Vector3f(1.0f, 1.0f, 1.0f), 
                  float intensity = 1.0f) {
         lights.push_back(Light(position, color, intensity));
+        geometryMem.Set(objectBytes + VectorBytes(lights));
+        hdrValid = false;
     }
     
     // ############################################################################################
     // Add objects to the scene with materials
     void addSphere(const Vector3f& center, float radius, const Material& material) {
-        world.add(new Sphere(center, radius, material));
+        addObject(new Sphere(center, radius, material));
     }
     
     void addBox(const Vector3f& min, const Vector3f& max, const Material& material) {
-        world.add(new Box(min, max, material));
+        addObject(new Box(min, max, material));
     }
     
     void addTriangle(const Vector3f& v0, const Vector3f& v1, const Vector3f& v2, 
                      const Material& material) {
-        world.add(new Triangle(v0, v1, v2, material));
+        addObject(new Triangle(v0, v1, v2, material));
+    }
+    
+    // ############################################################################################
+    // Add a mapped binary mesh, placed with a uniform scale and translation. The mesh data
+    // is shared, not copied; the mapping stays alive as long as an object references it.
+    void addTriangleMesh(std::shared_ptr<const MeshBinary> mesh, const Vector3f& position, float scale,
+                         const Material& material) {
+        addObject(new TriangleMesh(mesh, position, scale, material));
+    }
+    
+    // ############################################################################################
+    // Add an object built by the caller, e.g. a set of compiled primitives; the ray tracer
+    // takes ownership
+    void addHittable(Hittable* object) {
+        addObject(object);
     }
     
     // ############################################################################################
@@ -478,18 +765,21 @@ public:
     // Set maximum reflection depth
     void setMaxReflectionDepth(int depth) {
         maxReflectionDepth = depth;
+        hdrValid = false;
     }
 
     // ############################################################################################
     // Enable/disable reflections
     void setReflectionsEnabled(bool enabled) {
         reflectionsEnabled = enabled;
+        hdrValid = false;
     }
     
     // ############################################################################################
     // Set background color
     void setBackgroundColor(const Vector3f& color) {
         backgroundColor = color;
+        hdrValid = false;
     }
     
     // ############################################################################################
@@ -497,44 +787,195 @@ public:
     void clearScene() {
         world.clear();
         lights.clear();
+        objectBytes = 0;
+        geometryMem.Set(VectorBytes(lights));
+        materialMem.Set(0);
+        accelerationMem.Set(world.indexBytes());
+        hdrValid = false;
     }
     
     // ############################################################################################
-    // Render the scene and return pixel data
-    std::vector<unsigned char> render() {
-        std::vector<unsigned char> pixels(imageWidth * imageHeight * 3);
+    // Preallocate room for a scene of known size, e.g. counted by the scene parser
+    void reserveScene(size_t objectCount, size_t lightCount) {
+        world.reserve(world.objects.size() + objectCount);
+        lights.reserve(lights.size() + lightCount);
+        geometryMem.Set(objectBytes + VectorBytes(lights));
+        accelerationMem.Set(world.indexBytes());
+    }
+    
+    // ############################################################################################
+    // Trace one row of the image into linear RGB floats (3 per pixel)
+    void traceRow(int y, float* out) {
+        for (int x = 0; x < imageWidth; ++x) {
+            float u = static_cast<float>(x) / (imageWidth - 1);
+            float v = 1.0f - static_cast<float>(y) / (imageHeight - 1); // Flip y for correct orientation
+            
+            Ray ray = camera->getRay(u, v);
+            Vector3f color;
+            
+            if (reflectionsEnabled) {
+                color = rayColorWithReflection(ray, world, maxReflectionDepth);
+            } else {
+                color = rayColor(ray, world);
+            }
+            
+            out[x * 3] = color.x;
+            out[x * 3 + 1] = color.y;
+            out[x * 3 + 2] = color.z;
+        }
         
-        #pragma omp parallel for // OpenMP parallelization for faster rendering
-        for (int y = 0; y < imageHeight; ++y) {
-            for (int x = 0; x < imageWidth; ++x) {
-                float u = static_cast<float>(x) / (imageWidth - 1);
-                float v = 1.0f - static_cast<float>(y) / (imageHeight - 1); // Flip y for correct orientation
-                
-                Ray ray = camera->getRay(u, v);
-                Vector3f color;
-                
-                if (reflectionsEnabled) {
-                    color = rayColorWithReflection(ray, world, maxReflectionDepth);
+        // Publish this thread's ray count once per row rather than once per ray
+        rayCount += threadRays();
+        threadRays() = 0;
+    }
+    
+    // ############################################################################################
+    // Render the scene into the linear float framebuffer
+    // With accumulate set, the frame is added to the previous ones (progressive rendering)
+    void renderLinear(bool accumulate = false) {
+        size_t rowFloats = static_cast<size_t>(imageWidth) * 3;
+        size_t size = rowFloats * imageHeight;
+        if (!accumulate || hdrBuffer.size() != size) {
+            hdrBuffer.resize(size);
+            accumulatedFrames = 0;
+        }
+        updateFramebufferMem();
+        
+        bool addToBuffer = accumulatedFrames > 0;
+        #pragma omp parallel // OpenMP parallelization for faster rendering
+        {
+            std::vector<float> row(addToBuffer ? rowFloats : 0);
+            
+            #pragma omp for
+            for (int y = 0; y < imageHeight; ++y) {
+                float* dst = &hdrBuffer[y * rowFloats];
+                if (!addToBuffer) {
+                    traceRow(y, dst);
                 } else {
-                    color = rayColor(ray, world);
+                    traceRow(y, row.data());
+                    for (size_t i = 0; i < rowFloats; i++) dst[i] += row[i];
                 }
-                
-                // Convert color to RGB bytes with gamma correction
-                int idx = (y * imageWidth + x) * 3;
-                // Apply simple gamma correction (gamma = 2.0)
-                pixels[idx] = static_cast<unsigned char>(255.99 * sqrt(std::min(color.x, 1.0f)));
-                pixels[idx + 1] = static_cast<unsigned char>(255.99 * sqrt(std::min(color.y, 1.0f)));
-                pixels[idx + 2] = static_cast<unsigned char>(255.99 * sqrt(std::min(color.z, 1.0f)));
             }
         }
+        accumulatedFrames++;
+        hdrValid = true;
+        frameValid = false;
+    }
+    
+    // ############################################################################################
+    // Tone map, gamma correct and quantize the float framebuffer into 8-bit RGB
+    void resolve(unsigned char* pixels) const {
+        int rowFloats = imageWidth * 3;
+        float scale = accumulatedFrames > 0 ? 1.0f / accumulatedFrames : 1.0f;
         
-        return pixels;
+        #pragma omp parallel for
+        for (int y = 0; y < imageHeight; ++y) {
+            ToneMapRow(&hdrBuffer[y * rowFloats], pixels + y * rowFloats, rowFloats, toneMapping, scale);
+        }
+    }
+    
+    // ############################################################################################
+    // Render the scene into the persistent 8-bit framebuffer
+    // The buffers are only reallocated when the image size changes
+    void renderFrame() {
+        renderLinear();
+        resolveFrame();
+    }
+    
+    // ############################################################################################
+    // Bring the 8-bit framebuffer up to date: trace only if the scene changed since the last
+    // frame, and only tone map the float frame again if just the tone mapping changed
+    void updateFrame() {
+        if (!hdrValid) {
+            renderFrame();
+        } else if (!frameValid) {
+            resolveFrame();
+        }
+    }
+    
+    // ############################################################################################
+    // Render the scene into a caller-owned buffer of width * height * 3 bytes
+    void renderInto(unsigned char* pixels) {
+        renderLinear();
+        resolve(pixels);
+    }
+    
+    // ############################################################################################
+    // Resample the float framebuffer (averaged over accumulated frames) to another size,
+    // e.g. to produce several output resolutions from one supersampled trace
+    void resampleHdr(int width, int height, std::vector<float>& out) const {
+        float scale = accumulatedFrames > 0 ? 1.0f / accumulatedFrames : 1.0f;
+        out.resize(static_cast<size_t>(width) * height * 3);
+        if (width == imageWidth && height == imageHeight) {
+            std::copy(hdrBuffer.begin(), hdrBuffer.end(), out.begin());
+        } else {
+            ResampleRGB(hdrBuffer.data(), imageWidth, imageHeight, out.data(), width, height);
+        }
+        if (scale != 1.0f) {
+            for (size_t i = 0; i < out.size(); i++) out[i] *= scale;
+        }
+    }
+    
+    // ############################################################################################
+    // Render the scene and return pixel data (the persistent framebuffer)
+    const PixelBuffer& render() {
+        renderFrame();
+        return framebuffer;
+    }
+    
+    // ############################################################################################
+    // 8-bit RGB framebuffer of the last renderFrame() and whether it is still up to date
+    const PixelBuffer& getFramebuffer() const {
+        return framebuffer;
+    }
+    
+    bool hasFrame() const {
+        return hdrValid && frameValid;
+    }
+    
+    // ############################################################################################
+    // Linear float framebuffer of the last render (RGB, row-major, top row first)
+    const HdrBuffer& getHdrBuffer() const {
+        return hdrBuffer;
+    }
+    
+    int getAccumulatedFrames() const {
+        return accumulatedFrames;
+    }
+    
+    // ############################################################################################
+    // Scene contents, e.g. for saving a compiled scene
+    const Camera& getCamera() const { return *camera; }
+    const std::vector<Light>& getLights() const { return lights; }
+    const HittableList& getWorld() const { return world; }
+    const Vector3f& getBackgroundColor() const { return backgroundColor; }
+    bool getReflectionsEnabled() const { return reflectionsEnabled; }
+    int getMaxReflectionDepth() const { return maxReflectionDepth; }
+    
+    // ############################################################################################
+    // Number of rays (camera, reflection and shadow) cast since the last reset
+    unsigned long long getRayCount() const {
+        return rayCount;
+    }
+    
+    void resetRayCount() {
+        rayCount = 0;
+    }
+    
+    // ############################################################################################
+    // Set the operator, exposure and gamma used when quantizing to 8 bits
+    // The traced float frame stays valid; only the 8-bit framebuffer is resolved again
+    void setToneMapping(const ToneMapSettings& settings) {
+        toneMapping = settings;
+        frameValid = false;
     }
     
     // ############################################################################################
     // Save rendered image to a file (PPM format - simple binary format)
+    // Writes the current frame, tracing only if the scene changed since the last frame
     bool saveToFile(const std::string& filename) {
-        std::vector<unsigned char> pixels = render();
+        updateFrame();
+        const PixelBuffer& pixels = framebuffer;
         
         // Open the file for writing
         std::ofstream file(filename, std::ios::binary);
@@ -547,7 +988,7 @@ public:
         file << "P6\n" << imageWidth << " " << imageHeight << "\n255\n";
         
         // Write pixel data
-        file.write(reinterpret_cast<char*>(pixels.data()), pixels.size());
+        file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
         
         if (!file) {
             std::cerr << "Error: Failed to write image data" << std::endl;
@@ -558,133 +999,137 @@ public:
     }
     
     // ############################################################################################
-    // Save rendered image to a simpler format (P3 PPM - ASCII format)
-    bool saveToTextFile(const std::string& filename) {
-        std::vector<unsigned char> pixels = render();
-        
-        // Open the file for writing
-        std::ofstream file(filename);
+    // Render straight to a binary PPM, band by band, without keeping the whole frame.
+    // Each band of rows is traced in parallel, tone mapped, and handed to a writer thread
+    // that writes it while the next band is traced. Memory stays at one float band plus a
+    // few 8-bit bands, whatever the resolution. The persistent framebuffer is not touched.
+    bool saveStreaming(const std::string& filename, int bandRows = 0, StreamStats* stats = NULL) {
+        FILE* file = fopen(filename.c_str(), "wb");
         if (!file) {
             std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
             return false;
         }
+        fprintf(file, "P6\n%d %d\n255\n", imageWidth, imageHeight);
         
-        // Write PPM header
-        file << "P3\n" << imageWidth << " " << imageHeight << "\n255\n";
+        if (bandRows <= 0) {
+            int threads = 1;
+#ifdef _OPENMP
+            threads = omp_get_max_threads();
+#endif
+            bandRows = std::max(16, 2 * threads);
+        }
+        bandRows = std::min(bandRows, imageHeight);
         
-        // Write pixel data
-        for (int y = 0; y < imageHeight; ++y) {
-            for (int x = 0; x < imageWidth; ++x) {
-                int idx = (y * imageWidth + x) * 3;
-                file << static_cast<int>(pixels[idx]) << " "
-                     << static_cast<int>(pixels[idx + 1]) << " "
-                     << static_cast<int>(pixels[idx + 2]) << "\n";
+        int rowFloats = imageWidth * 3;
+        std::vector<float> band(static_cast<size_t>(rowFloats) * bandRows);
+        MemAccount bandMem(MEM_FRAMEBUFFER);
+        bandMem.Set(VectorBytes(band));
+        
+        bool success;
+        {
+            StreamWriter writer(file, static_cast<size_t>(rowFloats) * bandRows);
+            for (int y0 = 0; y0 < imageHeight; y0 += bandRows) {
+                int rows = std::min(bandRows, imageHeight - y0);
+                StreamWriter::Block* block = writer.acquire();
+                unsigned char* pixels = block->data.data();
+                
+                #pragma omp parallel for schedule(dynamic)
+                for (int r = 0; r < rows; ++r) {
+                    traceRow(y0 + r, &band[r * rowFloats]);
+                    ToneMapRow(&band[r * rowFloats], pixels + r * rowFloats, rowFloats, toneMapping);
+                }
+                
+                block->used = static_cast<size_t>(rows) * rowFloats;
+                writer.submit(block);
+            }
+            success = writer.finish();
+            if (stats) {
+                stats->bytesWritten = writer.getBytesWritten();
+                stats->writeSeconds = writer.getWriteSeconds();
+                stats->stallSeconds = writer.getStallSeconds();
+                stats->bandRows = bandRows;
             }
         }
         
-        if (!file) {
+        if (fclose(file) != 0 && success) {
             std::cerr << "Error: Failed to write image data" << std::endl;
-            return false;
+            success = false;
         }
-        
-        return true;
+        return success;
     }
     
     // ############################################################################################
-    // Load scene from a simple text file format
-    bool loadSceneFromFile(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file) {
-            std::cerr << "Error: Could not open scene file: " << filename << std::endl;
+    // Render into a memory-mapped binary PPM. The file is preallocated, the header written,
+    // and each thread traces a row into a small float buffer and tone maps it straight into
+    // the mapped pixel region. Neither the 8-bit nor the float frame is held in memory, so
+    // poster-size images cost little more than the page cache. The framebuffer is untouched.
+    // Fails where the file's blocks cannot be reserved up front (use the streaming writer).
+    bool saveMapped(const std::string& filename) {
+        char header[64];
+        int headerLength = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", imageWidth, imageHeight);
+        size_t rowBytes = static_cast<size_t>(imageWidth) * 3;
+        
+        MappedFile file;
+        if (!file.create(filename, headerLength + rowBytes * imageHeight)) {
             return false;
         }
+        memcpy(file.data(), header, headerLength);
+        unsigned char* pixels = file.data() + headerLength;
         
-        clearScene();
-        
-        std::string line;
-        while (std::getline(file, line)) {
-            std::stringstream ss(line);
-            std::string type;
-            ss >> type;
+        #pragma omp parallel
+        {
+            std::vector<float> row(rowBytes);
+            MemAccount rowMem(MEM_FRAMEBUFFER);
+            rowMem.Set(VectorBytes(row));
             
-            if (type == "camera") {
-                Vector3f lookFrom, lookAt, up;
-                float fov;
-                ss >> lookFrom.x >> lookFrom.y >> lookFrom.z
-                   >> lookAt.x >> lookAt.y >> lookAt.z
-                   >> up.x >> up.y >> up.z >> fov;
-                setCamera(lookFrom, lookAt, up, fov);
-            }
-            else if (type == "light") {
-                Vector3f position, color;
-                float intensity;
-                ss >> position.x >> position.y >> position.z
-                   >> color.x >> color.y >> color.z >> intensity;
-                addLight(position, color, intensity);
-            }
-            else if (type == "sphere") {
-                Vector3f center, color;
-                float radius, ambient, diffuse, specular, shininess, reflectivity;
-                ss >> center.x >> center.y >> center.z >> radius
-                   >> color.x >> color.y >> color.z
-                   >> ambient >> diffuse >> specular >> shininess >> reflectivity;
-                Material mat(color, ambient, diffuse, specular, shininess, reflectivity);
-                addSphere(center, radius, mat);
-            }
-            else if (type == "box") {
-                Vector3f min, max, color;
-                float ambient, diffuse, specular, shininess, reflectivity;
-                ss >> min.x >> min.y >> min.z
-                   >> max.x >> max.y >> max.z
-                   >> color.x >> color.y >> color.z
-                   >> ambient >> diffuse >> specular >> shininess >> reflectivity;
-                Material mat(color, ambient, diffuse, specular, shininess, reflectivity);
-                addBox(min, max, mat);
-            }
-            else if (type == "triangle") {
-                Vector3f v0, v1, v2, color;
-                float ambient, diffuse, specular, shininess, reflectivity;
-                ss >> v0.x >> v0.y >> v0.z
-                   >> v1.x >> v1.y >> v1.z
-                   >> v2.x >> v2.y >> v2.z
-                   >> color.x >> color.y >> color.z
-                   >> ambient >> diffuse >> specular >> shininess >> reflectivity;
-                Material mat(color, ambient, diffuse, specular, shininess, reflectivity);
-                addTriangle(v0, v1, v2, mat);
-            }
-            else if (type == "background") {
-                Vector3f color;
-                ss >> color.x >> color.y >> color.z;
-                setBackgroundColor(color);
-            }
-            else if (type == "reflections") {
-                int enabled, depth;
-                ss >> enabled >> depth;
-                setReflectionsEnabled(enabled != 0);
-                setMaxReflectionDepth(depth);
-            }
-            else if (type == "off_model") {
-                std::string filePath;
-                Vector3f color;
-                float ambient, diffuse, specular, shininess, reflectivity;
-                ss >> filePath >> color.x >> color.y >> color.z
-                   >> ambient >> diffuse >> specular >> shininess >> reflectivity;
-                Material mat(color, ambient, diffuse, specular, shininess, reflectivity);
-                
-                // Use the first color component (red) as the scale factor
-                float scale = color.x * 5.0f; // Scale between 0-5 based on the red component
-                addMeshFromFile(*this, filePath, Vector3f(0, 0, 0), scale, mat);
+            #pragma omp for schedule(dynamic)
+            for (int y = 0; y < imageHeight; ++y) {
+                traceRow(y, row.data());
+                ToneMapRow(row.data(), pixels + y * rowBytes, static_cast<int>(rowBytes), toneMapping);
             }
         }
         
-        // Add a default light if none specified
-        if (lights.empty()) {
-            addLight(Vector3f(10, 10, 10));
+        if (!file.sync()) {
+            std::cerr << "Error: Failed to write image data" << std::endl;
+            return false;
         }
-        
         return true;
     }
     
+    // ############################################################################################
+    // Save rendered image as PNG using the built-in parallel encoder
+    // Writes the current frame, tracing only if the scene changed since the last frame
+    bool saveToPNG(const std::string& filename, PngEncodeStats* stats = NULL) {
+        updateFrame();
+        return WritePNG(filename, framebuffer.data(), imageWidth, imageHeight, stats);
+    }
+    
+    // ############################################################################################
+    // Save the linear float framebuffer (before tone mapping) as PFM or half-float OpenEXR
+    // Accumulated frames are averaged; exposure and tone mapping are left to the consumer
+    bool saveToPFM(const std::string& filename) {
+        if (!hdrValid) renderFrame();
+        return WritePFM(filename, hdrBuffer.data(), imageWidth, imageHeight, 1.0f / accumulatedFrames);
+    }
+    
+    bool saveToEXR(const std::string& filename) {
+        if (!hdrValid) renderFrame();
+        return WriteEXR(filename, hdrBuffer.data(), imageWidth, imageHeight, 1.0f / accumulatedFrames);
+    }
+    
+    // ############################################################################################
+    // Save rendered image to a simpler format (P3 PPM - ASCII format)
+    // Writes the current frame, tracing only if the scene changed since the last frame
+    bool saveToTextFile(const std::string& filename) {
+        updateFrame();
+        return WritePPMText(filename, framebuffer.data(), imageWidth, imageHeight);
+    }
+    
+    // ############################################################################################
+    // Load a scene from a text file (see SceneParser.h) or a compiled scene (CompiledScene.h);
+    // 'stats' receives the load time and scene size
+    bool loadSceneFromFile(const std::string& filename, SceneParseStats* stats = NULL);
+    
 private:
     int imageWidth;
     int imageHeight;
@@ -694,6 +1139,53 @@ private:
     HittableList world;
     std::vector<Light> lights;
     Vector3f backgroundColor = Vector3f(0.2f, 0.2f, 0.4f);
+    HdrBuffer hdrBuffer;            // Linear RGB radiance, summed over accumulatedFrames
+    PixelBuffer framebuffer;        // Tone mapped 8-bit RGB of the last renderFrame()
+    bool hdrValid = false;          // hdrBuffer was traced from the current scene
+    bool frameValid = false;        // framebuffer is hdrBuffer with the current tone mapping
+    int accumulatedFrames = 0;
+    ToneMapSettings toneMapping;
+    std::atomic<unsigned long long> rayCount{0};   // Rays cast since the last resetRayCount()
+    
+    // Memory accounting for the scene and the pixel buffer
+    size_t objectBytes = 0;     // Geometry bytes of all objects, excluding their materials
+    MemAccount geometryMem{MEM_GEOMETRY};
+    MemAccount materialMem{MEM_MATERIALS};
+    MemAccount accelerationMem{MEM_ACCELERATION};
+    MemAccount framebufferMem{MEM_FRAMEBUFFER};
+    
+    // ############################################################################################
+    // Add an object to the world and account for its memory
+    void addObject(Hittable* object) {
+        world.add(object);
+        objectBytes += object->byteSize() - sizeof(Material);
+        geometryMem.Set(objectBytes + VectorBytes(lights));
+        materialMem.Add(sizeof(Material));
+        accelerationMem.Set(world.indexBytes());
+        hdrValid = false;
+    }
+    
+    // ############################################################################################
+    // Tone map the float framebuffer into the persistent 8-bit framebuffer
+    void resolveFrame() {
+        framebuffer.resize(static_cast<size_t>(imageWidth) * imageHeight * 3);
+        updateFramebufferMem();
+        resolve(framebuffer.data());
+        frameValid = true;
+    }
+    
+    // ############################################################################################
+    // Rays cast by the calling thread that traceRow() has not yet added to rayCount
+    static unsigned long long& threadRays() {
+        static thread_local unsigned long long count = 0;
+        return count;
+    }
+    
+    // ############################################################################################
+    // Account for the float and 8-bit framebuffers
+    void updateFramebufferMem() {
+        framebufferMem.Set(VectorBytes(hdrBuffer) + VectorBytes(framebuffer));
+    }
     
     // ############################################################################################
     // Calculate color for a ray
@@ -701,9 +1193,14 @@ private:
         HitRecord rec;
         
         // Check if ray hits anything in the world
+        threadRays()++;
         if (world.hit(ray, 0.001f, std::numeric_limits<float>::infinity(), rec)) {
+            // Fetch shading data for the closest hit only
+            SurfaceInteraction surf;
+            world.getSurface(ray, rec, surf);
+            
             // Calculate lighting with shadows
-            return calculateLighting(rec, ray, world);
+            return calculateLighting(surf, ray, world);
         }
         
         // Ray didn't hit anything, return background color (gradient)
@@ -714,11 +1211,12 @@ private:
     
     // ############################################################################################
     // Calculate lighting at a point with shadows
-    Vector3f calculateLighting(const HitRecord& rec, const Ray& ray, const HittableList& world) {
+    Vector3f calculateLighting(const SurfaceInteraction& rec, const Ray& ray, const HittableList& world) {
         Vector3f resultColor(0.0f, 0.0f, 0.0f);
+        const Material& material = *rec.material;
         
         // Ambient component
-        Vector3f ambient = rec.material.color * rec.material.ambientCoef;
+        Vector3f ambient = material.color * material.ambientCoef;
         resultColor = ambient;
         
         // For each light in the scene
@@ -731,13 +1229,14 @@ private:
             // Check for shadows
             Ray shadowRay(rec.point + rec.normal * 0.001f, lightDir);
             HitRecord shadowRec;
+            threadRays()++;
             bool inShadow = world.hit(shadowRay, 0.001f, lightDistance - 0.001f, shadowRec);
             
             if (!inShadow) {
                 // Diffuse component
                 float diffuseFactor = std::max(rec.normal.Dot(lightDir), 0.0f);
-                Vector3f diffuse = rec.material.color * light.color * diffuseFactor * 
-                                   rec.material.diffuseCoef * light.intensity;
+                Vector3f diffuse = material.color * light.color * diffuseFactor * 
+                                   material.diffuseCoef * light.intensity;
                 
                 // Specular component
                 Vector3f viewDir = -ray.direction; // Already normalized
@@ -745,20 +1244,16 @@ private:
                 halfVector.Normalize();
                 float specularFactor = std::pow(
                     std::max(rec.normal.Dot(halfVector), 0.0f), 
-                    rec.material.shininess);
+                    material.shininess);
                 Vector3f specular = light.color * specularFactor * 
-                                   rec.material.specularCoef * light.intensity;
+                                   material.specularCoef * light.intensity;
                 
                 // Add diffuse and specular to result
                 resultColor = resultColor + diffuse + specular;
             }
         }
         
-        // Clamp color values to [0, 1]
-        resultColor.x = std::min(resultColor.x, 1.0f);
-        resultColor.y = std::min(resultColor.y, 1.0f);
-        resultColor.z = std::min(resultColor.z, 1.0f);
-        
+        // Unclamped radiance; the tone-map stage maps it to the display range
         return resultColor;
     }
     
@@ -769,22 +1264,27 @@ private:
             return Vector3f(0.0f, 0.0f, 0.0f);
         }
         
-        HitRecord rec;
+        HitRecord hit;
         
         // Check if ray hits anything in the world
-        if (world.hit(ray, 0.001f, std::numeric_limits<float>::infinity(), rec)) {
+        threadRays()++;
+        if (world.hit(ray, 0.001f, std::numeric_limits<float>::infinity(), hit)) {
+            // Fetch shading data for the closest hit only
+            SurfaceInteraction rec;
+            world.getSurface(ray, hit, rec);
+            
             // Calculate direct lighting
             Vector3f directColor = calculateLighting(rec, ray, world);
             
             // Calculate reflection if needed
-            if (rec.material.reflectivity > 0.0f) {
+            if (rec.material->reflectivity > 0.0f) {
                 Vector3f reflected = reflect(ray.direction, rec.normal);
                 Ray reflectionRay(rec.point + rec.normal * 0.001f, reflected);
                 Vector3f reflectionColor = rayColorWithReflection(reflectionRay, world, depth - 1);
                 
                 // Combine with reflection based on material reflectivity
-                return directColor * (1.0f - rec.material.reflectivity) + 
-                       reflectionColor * rec.material.reflectivity;
+                return directColor * (1.0f - rec.material->reflectivity) + 
+                       reflectionColor * rec.material->reflectivity;
             }
             
             return directColor;
@@ -803,4 +1303,6 @@ private:
     }
 };
 
+#include "SceneParser.h"
+
 #endif // RAY_TRACER_H
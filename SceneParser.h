@@ -0,0 +1,212 @@
+#ifndef SCENE_PARSER_H
+#define SCENE_PARSER_H
+
+#include "RayTracer.h"
+#include "CompiledScene.h"
+#include "./include/mapped_file.h"
+#include "./include/fast_parse.h"
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace scene_parser_detail {
+
+enum SceneKeyword {
+    KEYWORD_NONE,
+    KEYWORD_CAMERA,
+    KEYWORD_LIGHT,
+    KEYWORD_SPHERE,
+    KEYWORD_BOX,
+    KEYWORD_TRIANGLE,
+    KEYWORD_BACKGROUND,
+    KEYWORD_REFLECTIONS,
+    KEYWORD_OFF_MODEL
+};
+
+// ############################################################################################
+// Map a keyword to its enum. Length and first letter identify the only possible keyword,
+// so one switch and one memcmp replace a chain of string comparisons.
+inline SceneKeyword ClassifyKeyword(const char* word, size_t length) {
+    const char* name;
+    SceneKeyword keyword;
+    switch (length) {
+        case 3:  name = "box";         keyword = KEYWORD_BOX;         break;
+        case 5:  name = "light";       keyword = KEYWORD_LIGHT;       break;
+        case 6:
+            if (word[0] == 'c') { name = "camera"; keyword = KEYWORD_CAMERA; }
+            else                { name = "sphere"; keyword = KEYWORD_SPHERE; }
+            break;
+        case 8:  name = "triangle";    keyword = KEYWORD_TRIANGLE;    break;
+        case 9:  name = "off_model";   keyword = KEYWORD_OFF_MODEL;   break;
+        case 10: name = "background";  keyword = KEYWORD_BACKGROUND;  break;
+        case 11: name = "reflections"; keyword = KEYWORD_REFLECTIONS; break;
+        default: return KEYWORD_NONE;
+    }
+    return memcmp(word, name, length) == 0 ? keyword : KEYWORD_NONE;
+}
+
+// ############################################################################################
+// The next whitespace separated token of the line as [p, tokenEnd)
+inline const char* TokenEnd(const char* p, const char* end) {
+    while (p < end && !IsBlank(*p) && *p != '\n') p++;
+    return p;
+}
+
+// ############################################################################################
+// Parse 'count' whitespace separated floats; NULL if the line has fewer
+inline const char* ParseFloats(const char* p, const char* end, float* values, int count) {
+    for (int i = 0; i < count && p; i++) {
+        p = ParseFloat(SkipBlank(p, end), end, values[i]);
+    }
+    return p;
+}
+
+inline Material MaterialFrom(const float* v) {
+    return Material(Vector3f(v[0], v[1], v[2]), v[3], v[4], v[5], v[6], v[7]);
+}
+
+} // namespace scene_parser_detail
+
+// ############################################################################################
+// Load a scene description into the ray tracer, replacing its scene. The file is mapped and
+// read twice: a counting pass classifies each line's keyword so the object and light arrays
+// can be reserved once, and the parsing pass converts the values in place without building
+// strings or streams. Lines with unknown keywords (e.g. comments) are ignored; lines with
+// too few values are reported with their line number and skipped.
+inline bool ParseSceneFile(RayTracer& rayTracer, const std::string& filename, SceneParseStats* stats) {
+    using namespace scene_parser_detail;
+    auto start = std::chrono::high_resolution_clock::now();
+    MappedFile file;
+    if (!file.openRead(filename)) {
+        std::cerr << "Error: Could not open scene file: " << filename << std::endl;
+        return false;
+    }
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+
+    // Counting pass
+    size_t objectCount = 0, lightCount = 0;
+    for (const char* p = begin; p < end; p = SkipLine(p, end)) {
+        const char* word = SkipBlank(p, end);
+        switch (ClassifyKeyword(word, TokenEnd(word, end) - word)) {
+            case KEYWORD_SPHERE:
+            case KEYWORD_BOX:
+            case KEYWORD_TRIANGLE:
+            case KEYWORD_OFF_MODEL: objectCount++; break;
+            case KEYWORD_LIGHT:     lightCount++;  break;
+            default: break;
+        }
+    }
+    rayTracer.clearScene();
+    rayTracer.reserveScene(objectCount, std::max<size_t>(lightCount, 1));
+
+    // Parsing pass
+    size_t line = 0, skipped = 0, lightsAdded = 0, objectsAdded = 0;
+    for (const char* p = begin; p < end; ) {
+        const char* next = SkipLine(p, end);
+        const char* lineEnd = next > p && next[-1] == '\n' ? next - 1 : next;
+        line++;
+        const char* word = SkipBlank(p, lineEnd);
+        const char* wordEnd = TokenEnd(word, lineEnd);
+        SceneKeyword keyword = ClassifyKeyword(word, wordEnd - word);
+        p = next;
+
+        float v[17];
+        bool ok = true;
+        switch (keyword) {
+            case KEYWORD_CAMERA:
+                if ((ok = ParseFloats(wordEnd, lineEnd, v, 10) != NULL)) {
+                    rayTracer.setCamera(Vector3f(v[0], v[1], v[2]), Vector3f(v[3], v[4], v[5]),
+                                        Vector3f(v[6], v[7], v[8]), v[9]);
+                }
+                break;
+            case KEYWORD_LIGHT:
+                if ((ok = ParseFloats(wordEnd, lineEnd, v, 7) != NULL)) {
+                    rayTracer.addLight(Vector3f(v[0], v[1], v[2]), Vector3f(v[3], v[4], v[5]), v[6]);
+                    lightsAdded++;
+                }
+                break;
+            case KEYWORD_SPHERE:
+                if ((ok = ParseFloats(wordEnd, lineEnd, v, 12) != NULL)) {
+                    rayTracer.addSphere(Vector3f(v[0], v[1], v[2]), v[3], MaterialFrom(v + 4));
+                    objectsAdded++;
+                }
+                break;
+            case KEYWORD_BOX:
+                if ((ok = ParseFloats(wordEnd, lineEnd, v, 14) != NULL)) {
+                    rayTracer.addBox(Vector3f(v[0], v[1], v[2]), Vector3f(v[3], v[4], v[5]), MaterialFrom(v + 6));
+                    objectsAdded++;
+                }
+                break;
+            case KEYWORD_TRIANGLE:
+                if ((ok = ParseFloats(wordEnd, lineEnd, v, 17) != NULL)) {
+                    rayTracer.addTriangle(Vector3f(v[0], v[1], v[2]), Vector3f(v[3], v[4], v[5]),
+                                          Vector3f(v[6], v[7], v[8]), MaterialFrom(v + 9));
+                    objectsAdded++;
+                }
+                break;
+            case KEYWORD_BACKGROUND:
+                if ((ok = ParseFloats(wordEnd, lineEnd, v, 3) != NULL)) {
+                    rayTracer.setBackgroundColor(Vector3f(v[0], v[1], v[2]));
+                }
+                break;
+            case KEYWORD_REFLECTIONS: {
+                int enabled, depth;
+                const char* q = ParseInt(SkipBlank(wordEnd, lineEnd), lineEnd, enabled);
+                if ((ok = q && ParseInt(SkipBlank(q, lineEnd), lineEnd, depth))) {
+                    rayTracer.setReflectionsEnabled(enabled != 0);
+                    rayTracer.setMaxReflectionDepth(depth);
+                }
+                break;
+            }
+            case KEYWORD_OFF_MODEL: {
+                const char* path = SkipBlank(wordEnd, lineEnd);
+                const char* pathEnd = TokenEnd(path, lineEnd);
+                if ((ok = pathEnd > path && ParseFloats(pathEnd, lineEnd, v, 8) != NULL)) {
+                    // Use the first color component (red) as the scale factor
+                    float scale = v[0] * 5.0f; // Scale between 0-5 based on the red component
+                    // A mesh that fails to load is reported by addMeshFromFile and not counted
+                    if (addMeshFromFile(rayTracer, std::string(path, pathEnd), Vector3f(0, 0, 0), scale, MaterialFrom(v))) {
+                        objectsAdded++;
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        if (!ok) {
+            std::cerr << "Warning: " << filename << ":" << line << ": Too few values for '"
+                      << std::string(word, wordEnd) << "', line skipped" << std::endl;
+            skipped++;
+        }
+    }
+
+    // Add a default light if none specified
+    if (lightsAdded == 0) {
+        rayTracer.addLight(Vector3f(10, 10, 10));
+    }
+
+    if (stats) {
+        stats->fileBytes = file.size();
+        stats->lines = line;
+        stats->objects = objectsAdded;
+        stats->lights = lightsAdded;
+        stats->skippedLines = skipped;
+        stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    return true;
+}
+
+// ############################################################################################
+// Defined here rather than in the class so the parsers can use the complete RayTracer.
+// Compiled scenes are recognized by their magic, anything else is parsed as text.
+inline bool RayTracer::loadSceneFromFile(const std::string& filename, SceneParseStats* stats) {
+    if (IsCompiledSceneFile(filename)) {
+        return LoadCompiledScene(*this, filename, stats);
+    }
+    return ParseSceneFile(*this, filename, stats);
+}
+
+#endif // SCENE_PARSER_H
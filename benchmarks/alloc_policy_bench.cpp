@@ -0,0 +1,82 @@
+// ############################################################################################
+// Allocation policy benchmark
+// Builds a procedural triangle scene under each allocation policy (default / interleave,
+// with and without transparent huge pages) and reports build and render times.
+//
+// Usage: alloc_policy_bench [triangles] [width] [height] [frames]
+#include "RayTracer.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+// ############################################################################################
+// Tessellated sphere with roughly 'triangleCount' triangles
+void buildScene(RayTracer& rayTracer, int triangleCount) {
+    Material material(Vector3f(0.7f, 0.5f, 0.3f), 0.2f, 0.6f, 0.4f, 32.0f, 0.2f);
+    int rings = std::max(2, static_cast<int>(std::sqrt(triangleCount / 4.0f)));
+    int segments = 2 * rings;
+
+    for (int i = 0; i < rings; i++) {
+        float theta0 = 3.1415926f * i / rings;
+        float theta1 = 3.1415926f * (i + 1) / rings;
+        for (int j = 0; j < segments; j++) {
+            float phi0 = 2.0f * 3.1415926f * j / segments;
+            float phi1 = 2.0f * 3.1415926f * (j + 1) / segments;
+            Vector3f a(sinf(theta0) * cosf(phi0), cosf(theta0), sinf(theta0) * sinf(phi0));
+            Vector3f b(sinf(theta0) * cosf(phi1), cosf(theta0), sinf(theta0) * sinf(phi1));
+            Vector3f c(sinf(theta1) * cosf(phi0), cosf(theta1), sinf(theta1) * sinf(phi0));
+            Vector3f d(sinf(theta1) * cosf(phi1), cosf(theta1), sinf(theta1) * sinf(phi1));
+            rayTracer.addTriangle(a, c, b, material);
+            rayTracer.addTriangle(b, c, d, material);
+        }
+    }
+
+    rayTracer.addBox(Vector3f(-5, -1.5f, -5), Vector3f(5, -1.4f, 5), Material());
+    rayTracer.addLight(Vector3f(5, 5, 5), Vector3f(1.0f, 1.0f, 1.0f), 1.0f);
+    rayTracer.setReflectionsEnabled(true);
+    rayTracer.setMaxReflectionDepth(2);
+    rayTracer.setCamera(Vector3f(0, 1, 4), Vector3f(0, 0, 0), Vector3f(0, 1, 0), 50.0f);
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int triangles = argc > 1 ? atoi(argv[1]) : 20000;
+    int width = argc > 2 ? atoi(argv[2]) : 160;
+    int height = argc > 3 ? atoi(argv[3]) : 90;
+    int frames = argc > 4 ? atoi(argv[4]) : 3;
+
+    std::cout << "NUMA nodes online: " << NumaNodeCount() << std::endl;
+    std::cout << "Scene: ~" << triangles << " triangles, " << width << "x" << height
+              << ", " << frames << " frames per configuration" << std::endl;
+
+    AllocPolicy policies[] = { ALLOC_DEFAULT, ALLOC_INTERLEAVE };
+    for (int p = 0; p < 2; p++) {
+        for (int huge = 0; huge < 2; huge++) {
+            GlobalAllocConfig().policy = policies[p];
+            GlobalAllocConfig().hugePages = huge != 0;
+
+            RayTracer rayTracer(width, height);
+            auto buildStart = std::chrono::high_resolution_clock::now();
+            buildScene(rayTracer, triangles);
+            double buildTime = secondsSince(buildStart);
+
+            auto renderStart = std::chrono::high_resolution_clock::now();
+            for (int f = 0; f < frames; f++) {
+                rayTracer.renderFrame();
+            }
+            double renderTime = secondsSince(renderStart) / frames;
+
+            std::string label = std::string(AllocPolicyName(policies[p])) + (huge ? " + huge pages" : "");
+            std::cout << "  " << std::left << std::setw(24) << label << std::right
+                      << "  build " << buildTime * 1000.0 << " ms"
+                      << "  render " << renderTime * 1000.0 << " ms/frame" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef BENCH_MESH_H
+#define BENCH_MESH_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "include/math_utils.h"
+
+// ############################################################################################
+// Test meshes shared by the mesh benchmarks
+
+// ############################################################################################
+// A UV sphere with about 'triangleCount' triangles, rows of quads from pole to pole (in the
+// order most exporters write grids). 'normals', if given, receives the exact unit normals.
+template <typename Index>
+void buildSphere(size_t triangleCount, std::vector<Vector3f>& vertices, std::vector<Index>& indices,
+                 std::vector<Vector3f>* normals = NULL) {
+    int rings = std::max(2, static_cast<int>(sqrt(triangleCount / 4.0)));
+    int segments = rings * 2;
+    for (int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s < segments; s++) {
+            float phi = 6.2831853f * s / segments;
+            vertices.push_back(Vector3f(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+            if (normals) normals->push_back(vertices.back());
+        }
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            Index a = r * segments + s, b = r * segments + (s + 1) % segments;
+            Index c = a + segments, d = b + segments;
+            Index quad[6] = { a, c, b, b, c, d };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+#endif // BENCH_MESH_H
@@ -0,0 +1,171 @@
+// ############################################################################################
+// Triangle clipping allocation benchmark
+// Counts heap allocations through a replaced global operator new while four planes clip a
+// sphere on one thread, into outputs reserved up front. The previous clipper used two
+// vectors per triangle and three more per plane, copied back by assignment. MeshSlicer's
+// clipper ping-pongs fixed-size polygons on the stack. Both must produce the same mesh.
+//
+// Usage: clip_bench [million triangles]
+#include "MeshSlicer.h"
+#include "bench_mesh.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <new>
+
+static size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    allocationCount++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+const float EPSILON = 1e-6f;
+
+// ############################################################################################
+// The previous clipper, as MeshSlicer had it
+Vector3f legacyIntersection(const Vector3f& p1, const Vector3f& p2, const MeshSlicer::Plane& plane) {
+    float dist1 = plane.SignedDistance(p1);
+    float dist2 = plane.SignedDistance(p2);
+    if (std::abs(dist1) < EPSILON) return p1;
+    if (std::abs(dist2) < EPSILON) return p2;
+    if (std::abs(dist1 - dist2) < EPSILON) return (p1 + p2) * 0.5f;
+    float t = std::max(0.0f, std::min(1.0f, dist1 / (dist1 - dist2)));
+    return p1 + (p2 - p1) * t;
+}
+
+Vector3f legacyInterpolate(const Vector3f& attr1, const Vector3f& attr2, const Vector3f& p1, const Vector3f& p2,
+                           const Vector3f& intersection) {
+    float totalLength = (p2 - p1).length();
+    if (totalLength < EPSILON) return attr1;
+    float t = std::max(0.0f, std::min(1.0f, (intersection - p1).length() / totalLength));
+    return attr1 + (attr2 - attr1) * t;
+}
+
+void legacyClip(std::vector<Vector3f>& vertices, std::vector<Vector3f>& normals, const MeshSlicer::Plane& plane) {
+    if (vertices.empty() || vertices.size() != normals.size()) return;
+    std::vector<Vector3f> resultVertices;
+    std::vector<Vector3f> resultNormals;
+    std::vector<int> classification;
+    classification.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        float dist = plane.SignedDistance(vertices[i]);
+        classification.push_back(std::abs(dist) < EPSILON ? 0 : dist < 0 ? -1 : 1);
+    }
+    for (size_t i = 0; i < vertices.size(); i++) {
+        size_t j = (i + 1) % vertices.size();
+        if (classification[i] <= 0) {
+            resultVertices.push_back(vertices[i]);
+            resultNormals.push_back(normals[i]);
+        }
+        if (classification[i] * classification[j] == -1) {
+            Vector3f intersection = legacyIntersection(vertices[i], vertices[j], plane);
+            Vector3f normal = legacyInterpolate(normals[i], normals[j], vertices[i], vertices[j], intersection);
+            normal.Normalize();
+            resultVertices.push_back(intersection);
+            resultNormals.push_back(normal);
+        }
+    }
+    vertices = resultVertices;
+    normals = resultNormals;
+}
+
+void legacySlice(const std::vector<MeshSlicer::Plane>& planes, const std::vector<Vector3f>& inVertices,
+                 const std::vector<Vector3f>& inNormals, const std::vector<unsigned int>& inIndices,
+                 std::vector<Vector3f>& outVertices, std::vector<Vector3f>& outNormals,
+                 std::vector<unsigned int>& outIndices) {
+    for (size_t i = 0; i + 2 < inIndices.size(); i += 3) {
+        const unsigned int* tri = &inIndices[i];
+        bool allOutside = false;
+        for (size_t p = 0; p < planes.size() && !allOutside; p++) {
+            allOutside = planes[p].SignedDistance(inVertices[tri[0]]) > EPSILON &&
+                         planes[p].SignedDistance(inVertices[tri[1]]) > EPSILON &&
+                         planes[p].SignedDistance(inVertices[tri[2]]) > EPSILON;
+        }
+        if (allOutside) continue;
+        std::vector<Vector3f> triangleVertices = { inVertices[tri[0]], inVertices[tri[1]], inVertices[tri[2]] };
+        std::vector<Vector3f> triangleNormals = { inNormals[tri[0]], inNormals[tri[1]], inNormals[tri[2]] };
+        for (size_t p = 0; p < planes.size(); p++) legacyClip(triangleVertices, triangleNormals, planes[p]);
+        if (triangleVertices.size() >= 3) {
+            unsigned int baseIndex = outVertices.size();
+            outVertices.insert(outVertices.end(), triangleVertices.begin(), triangleVertices.end());
+            outNormals.insert(outNormals.end(), triangleNormals.begin(), triangleNormals.end());
+            for (size_t j = 1; j < triangleVertices.size() - 1; j++) {
+                unsigned int fan[3] = { baseIndex, static_cast<unsigned int>(baseIndex + j),
+                                        static_cast<unsigned int>(baseIndex + j + 1) };
+                outIndices.insert(outIndices.end(), fan, fan + 3);
+            }
+        }
+    }
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void report(const char* name, double seconds, size_t allocations, size_t triangles) {
+    std::cout << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << seconds * 1000.0 << " ms " << std::setw(12) << allocations << " allocations "
+              << std::setprecision(3) << std::setw(8) << static_cast<double>(allocations) / triangles
+              << " per triangle" << std::endl;
+}
+
+template <typename T>
+bool sameVector(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+int main(int argc, char** argv) {
+    double millions = argc > 1 ? atof(argv[1]) : 1.0;
+    std::vector<Vector3f> vertices, normals;
+    std::vector<unsigned int> indices;
+    buildSphere(static_cast<size_t>(millions * 1e6), vertices, indices, &normals);
+    size_t triangles = indices.size() / 3;
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+#endif
+
+    // Four planes that cut off the sides of the sphere, so most triangles are clipped by all four
+    MeshSlicer slicer;
+    std::vector<MeshSlicer::Plane> planes;
+    planes.push_back(MeshSlicer::Plane(Vector3f(1.0f, 0.2f, 0.0f), -0.7f));
+    planes.push_back(MeshSlicer::Plane(Vector3f(-1.0f, 0.1f, 0.2f), -0.7f));
+    planes.push_back(MeshSlicer::Plane(Vector3f(0.0f, 1.0f, 0.1f), -0.8f));
+    planes.push_back(MeshSlicer::Plane(Vector3f(0.1f, -1.0f, 0.0f), -0.8f));
+    for (size_t p = 0; p < planes.size(); p++) slicer.AddPlane(planes[p]);
+
+    std::vector<Vector3f> legacyVertices, legacyNormals, outVertices, outNormals;
+    std::vector<unsigned int> legacyIndices, outIndices;
+    legacyVertices.reserve(indices.size());
+    legacyNormals.reserve(indices.size());
+    legacyIndices.reserve(indices.size() * 2);
+    outVertices.reserve(indices.size());
+    outNormals.reserve(indices.size());
+    outIndices.reserve(indices.size() * 2);
+
+    size_t before = allocationCount;
+    auto start = std::chrono::high_resolution_clock::now();
+    legacySlice(planes, vertices, normals, indices, legacyVertices, legacyNormals, legacyIndices);
+    report("vectors", secondsSince(start), allocationCount - before, triangles);
+
+    before = allocationCount;
+    start = std::chrono::high_resolution_clock::now();
+    slicer.AppendSlicedTriangles(vertices.data(), normals.data(), indices.data(), triangles, outVertices, outNormals,
+                                 outIndices);
+    report("stack", secondsSince(start), allocationCount - before, triangles);
+
+    bool identical = sameVector(outVertices, legacyVertices) && sameVector(outNormals, legacyNormals) &&
+                     sameVector(outIndices, legacyIndices);
+    std::cout << "Mesh: " << triangles << " triangles clipped into " << outIndices.size() / 3 << ", output "
+              << (identical ? "identical" : "DIFFERS") << std::endl;
+    return identical ? 0 : 1;
+}
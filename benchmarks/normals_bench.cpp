@@ -0,0 +1,68 @@
+// ############################################################################################
+// Vertex normal benchmark
+// Compares the viewer's previous serial loop (scatter every face normal into its three
+// vertices, then normalize) with the parallel ComputeVertexNormals in each weighting mode.
+// Uniform weighting must reproduce the serial normals bit for bit; the other modes are
+// timed only.
+//
+// Usage: normals_bench [triangles in millions]
+#include "include/mesh_normals.h"
+#include "bench_mesh.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+// ############################################################################################
+// The viewer's original loop
+void serialNormals(const std::vector<Vector3f>& vertices, const std::vector<uint32_t>& indices,
+                   std::vector<Vector3f>& normals) {
+    normals.assign(vertices.size(), Vector3f(0.0f, 0.0f, 0.0f));
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        Vector3f normal = FaceNormal(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]);
+        for (int k = 0; k < 3; k++) normals[indices[i + k]] += normal;
+    }
+    for (size_t i = 0; i < normals.size(); i++) {
+        if (normals[i].length() > 0.0f) normals[i].Normalize();
+    }
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void report(const char* name, double seconds, size_t triangles) {
+    std::cout << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << seconds * 1000.0 << " ms " << std::setw(8) << triangles / 1e6 / seconds
+              << " Mtri/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    double millions = argc > 1 ? atof(argv[1]) : 4.0;
+    std::vector<Vector3f> vertices;
+    std::vector<uint32_t> indices;
+    buildSphere(static_cast<size_t>(millions * 1e6), vertices, indices);
+    size_t triangles = indices.size() / 3;
+    std::cout << "Mesh: " << vertices.size() << " vertices, " << triangles << " triangles" << std::endl;
+
+    std::vector<Vector3f> reference, normals;
+    auto start = std::chrono::high_resolution_clock::now();
+    serialNormals(vertices, indices, reference);
+    report("serial", secondsSince(start), triangles);
+
+    const char* names[3] = { "parallel uniform", "parallel area", "parallel angle" };
+    bool identical = false;
+    for (int w = NORMAL_WEIGHT_UNIFORM; w <= NORMAL_WEIGHT_ANGLE; w++) {
+        start = std::chrono::high_resolution_clock::now();
+        ComputeVertexNormals(vertices.data(), vertices.size(), indices.data(), triangles, normals,
+                             static_cast<NormalWeighting>(w));
+        report(names[w], secondsSince(start), triangles);
+        if (w == NORMAL_WEIGHT_UNIFORM) {
+            identical = memcmp(normals.data(), reference.data(), normals.size() * sizeof(Vector3f)) == 0;
+        }
+    }
+    std::cout << "Uniform normals " << (identical ? "identical to serial" : "DIFFER from serial") << std::endl;
+    return identical ? 0 : 1;
+}
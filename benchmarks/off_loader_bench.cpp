@@ -0,0 +1,143 @@
+// ############################################################################################
+// OFF loader benchmark
+// Writes a synthetic triangle mesh as OFF, loads it with the previous fscanf reader (one
+// call per number, one malloc per polygon) and with LoadOFF (memory mapped, parsed in
+// parallel chunks into flat arrays), checks that both produce the same mesh, and reports
+// times, throughput and the number of mesh allocations.
+//
+// Usage: off_loader_bench [faces] [output directory]
+#include "models/OFFReader.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+// ############################################################################################
+// The original readOffFile loop
+OffModel* readLegacyOff(const char* filename, size_t& allocations) {
+    FILE* input = fopen(filename, "r");
+    if (!input) return NULL;
+    char type[16];
+    int nv, np, noEdges;
+    if (fscanf(input, "%15s %d %d %d", type, &nv, &np, &noEdges) != 4) {
+        fclose(input);
+        return NULL;
+    }
+    OffModel* model = (OffModel*)malloc(sizeof(OffModel));
+    model->numberOfVertices = nv;
+    model->numberOfPolygons = np;
+    model->vertices = (Vertex*)malloc(nv * sizeof(Vertex));
+    model->polygons = (Polygon*)malloc(np * sizeof(Polygon));
+    model->indexPool = NULL;
+    allocations = 3;
+    for (int i = 0; i < nv; i++) {
+        float x, y, z;
+        if (fscanf(input, "%f %f %f", &x, &y, &z) != 3) x = y = z = 0.0f;
+        model->vertices[i].x = x;
+        model->vertices[i].y = y;
+        model->vertices[i].z = z;
+    }
+    for (int i = 0; i < np; i++) {
+        int n = 0;
+        if (fscanf(input, "%d", &n) != 1) n = 0;
+        model->polygons[i].noSides = n;
+        model->polygons[i].v = (int*)malloc(n * sizeof(int));
+        allocations++;
+        for (int j = 0; j < n; j++) {
+            if (fscanf(input, "%d", &model->polygons[i].v[j]) != 1) model->polygons[i].v[j] = 0;
+        }
+    }
+    fclose(input);
+    MemStats::Instance().Add(MEM_GEOMETRY, OffModelBytes(model));
+    return model;
+}
+
+// ############################################################################################
+// A wavy grid of 'faces' triangles (rounded up to whole quads)
+bool writeTestMesh(const std::string& filename, int faces) {
+    int side = std::max(2, static_cast<int>(std::sqrt(faces / 2.0)) + 1);
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file) return false;
+    int quads = (side - 1) * (side - 1);
+    fprintf(file, "OFF\n%d %d 0\n", side * side, quads * 2);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            float u = static_cast<float>(x) / (side - 1), v = static_cast<float>(y) / (side - 1);
+            fprintf(file, "%.6f %.6f %.6f\n", u * 2.0f - 1.0f, 0.1f * std::sin(u * 20.0f) * std::cos(v * 13.0f), v * -3.5f);
+        }
+    }
+    for (int y = 0; y + 1 < side; y++) {
+        for (int x = 0; x + 1 < side; x++) {
+            int a = y * side + x;
+            fprintf(file, "3 %d %d %d\n3 %d %d %d\n", a, a + side, a + 1, a + 1, a + side, a + side + 1);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int faces = argc > 1 ? atoi(argv[1]) : 2000000;
+    std::string directory = argc > 2 ? argv[2] : "/tmp";
+    std::string filename = directory + "/off_bench.off";
+    if (!writeTestMesh(filename, faces)) {
+        std::cerr << "Failed to write " << filename << std::endl;
+        return 1;
+    }
+
+    size_t allocations = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    OffModel* legacy = readLegacyOff(filename.c_str(), allocations);
+    double legacySeconds = secondsSince(start);
+
+    OffMesh mesh;
+    OffLoadStats stats;
+    start = std::chrono::high_resolution_clock::now();
+    bool loaded = LoadOFF(filename, mesh, &stats);
+    double fastSeconds = secondsSince(start);
+    if (!legacy || !loaded) {
+        std::cerr << "Failed to load " << filename << std::endl;
+        return 1;
+    }
+
+    // Same topology, and positions equal up to one unit in the last place
+    bool identical = legacy->numberOfVertices == mesh.vertexCount() && legacy->numberOfPolygons == mesh.faceCount();
+    size_t roundingDifferences = 0;
+    for (int i = 0; identical && i < mesh.vertexCount(); i++) {
+        const float a[3] = { legacy->vertices[i].x, legacy->vertices[i].y, legacy->vertices[i].z };
+        const float b[3] = { mesh.vertices[i].x, mesh.vertices[i].y, mesh.vertices[i].z };
+        for (int k = 0; k < 3; k++) {
+            if (a[k] == b[k]) continue;
+            roundingDifferences++;
+            identical = std::nextafter(a[k], b[k]) == b[k];
+        }
+    }
+    for (int f = 0; identical && f < mesh.faceCount(); f++) {
+        identical = legacy->polygons[f].noSides == mesh.faceSize(f) &&
+                    memcmp(legacy->polygons[f].v, mesh.face(f), mesh.faceSize(f) * sizeof(int)) == 0;
+    }
+
+    double megabytes = stats.fileBytes / (1024.0 * 1024.0);
+    double millionFaces = mesh.faceCount() / 1e6;
+    std::cout << "Mesh: " << mesh.vertexCount() << " vertices, " << mesh.faceCount() << " faces, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB" << std::endl;
+    std::cout << std::left << std::setw(10) << "fscanf" << std::right << std::setw(10) << legacySeconds * 1000.0
+              << " ms " << std::setw(8) << megabytes / legacySeconds << " MB/s " << std::setw(6)
+              << millionFaces / legacySeconds << " Mfaces/s " << std::setw(10) << allocations << " allocations" << std::endl;
+    std::cout << std::left << std::setw(10) << "LoadOFF" << std::right << std::setw(10) << fastSeconds * 1000.0
+              << " ms " << std::setw(8) << megabytes / fastSeconds << " MB/s " << std::setw(6)
+              << millionFaces / fastSeconds << " Mfaces/s " << std::setw(10) << 3 << " allocations" << std::endl;
+    std::cout << "Speedup: " << legacySeconds / fastSeconds << "x" << std::endl;
+    std::cout << "Meshes " << (identical ? "identical" : "DIFFER");
+    if (roundingDifferences > 0) std::cout << " (" << roundingDifferences << " coordinates 1 ulp apart)";
+    std::cout << std::endl;
+
+    FreeOffModel(legacy);
+    remove(filename.c_str());
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// ############################################################################################
+// ASCII PPM (P3) writer benchmark
+// Compares the table-driven parallel writer (WritePPMText) with the previous iostream
+// writer on a synthetic image, checks that both files are identical, and reports times.
+//
+// Usage: p3_writer_bench [width] [height] [output directory]
+#include "include/ppm_text.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+// ############################################################################################
+// The original saveToTextFile loop: three operator<< calls per pixel
+bool writeLegacyP3(const std::string& filename, const unsigned char* pixels, int width, int height) {
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    file << "P3\n" << width << " " << height << "\n255\n";
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int idx = (y * width + x) * 3;
+            file << static_cast<int>(pixels[idx]) << " "
+                 << static_cast<int>(pixels[idx + 1]) << " "
+                 << static_cast<int>(pixels[idx + 2]) << "\n";
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+bool filesEqual(const std::string& a, const std::string& b) {
+    std::ifstream fa(a, std::ios::binary), fb(b, std::ios::binary);
+    std::istreambuf_iterator<char> ia(fa), ib(fb), end;
+    return std::equal(ia, end, ib) && fb.peek() == EOF;
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? atoi(argv[1]) : 1920;
+    int height = argc > 2 ? atoi(argv[2]) : 1080;
+    std::string directory = argc > 3 ? argv[3] : "/tmp";
+
+    // Smooth gradients with some noise, so all digit counts occur
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 3);
+    srand(1);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            unsigned char* p = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+            p[0] = static_cast<unsigned char>(255.0f * x / std::max(width - 1, 1));
+            p[1] = static_cast<unsigned char>(255.0f * y / std::max(height - 1, 1));
+            p[2] = static_cast<unsigned char>(rand() & 0xFF);
+        }
+    }
+
+    std::string legacyFile = directory + "/p3_bench_legacy.ppm";
+    std::string fastFile = directory + "/p3_bench_fast.ppm";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bool legacyOk = writeLegacyP3(legacyFile, pixels.data(), width, height);
+    double legacySeconds = secondsSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    bool fastOk = WritePPMText(fastFile, pixels.data(), width, height);
+    double fastSeconds = secondsSince(start);
+
+    if (!legacyOk || !fastOk) {
+        std::cerr << "Failed to write benchmark output to " << directory << std::endl;
+        return 1;
+    }
+
+    std::ifstream sizeCheck(fastFile, std::ios::binary | std::ios::ate);
+    double megabytes = static_cast<double>(sizeCheck.tellg()) / (1024.0 * 1024.0);
+
+    std::cout << "Image: " << width << "x" << height << ", " << std::fixed << std::setprecision(1)
+              << megabytes << " MB of text" << std::endl;
+    std::cout << std::left << std::setw(12) << "iostream" << std::right << std::setw(10)
+              << legacySeconds * 1000.0 << " ms " << std::setw(10) << megabytes / legacySeconds << " MB/s" << std::endl;
+    std::cout << std::left << std::setw(12) << "table" << std::right << std::setw(10)
+              << fastSeconds * 1000.0 << " ms " << std::setw(10) << megabytes / fastSeconds << " MB/s" << std::endl;
+    std::cout << "Speedup: " << legacySeconds / fastSeconds << "x" << std::endl;
+
+    bool identical = filesEqual(legacyFile, fastFile);
+    std::cout << "Outputs " << (identical ? "identical" : "DIFFER") << std::endl;
+
+    remove(legacyFile.c_str());
+    remove(fastFile.c_str());
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// ############################################################################################
+// Scene parser benchmark
+// Writes a procedural scene of spheres and triangles, loads it with the previous parser (one
+// std::stringstream per line, keyword compared against a chain of string literals) and with
+// the mapped single-pass SceneParser, checks that both build the same scene, and reports
+// times and throughput.
+//
+// Usage: scene_parser_bench [objects] [output directory]
+#include "RayTracer.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+// The benchmark scene has no OFF models
+bool addMeshFromFile(RayTracer&, const std::string& filename, const Vector3f&, float, const Material&) {
+    std::cerr << "off_model is not supported by the benchmark: " << filename << std::endl;
+    return false;
+}
+
+// ############################################################################################
+// The original RayTracer::loadSceneFromFile loop (without off_model)
+bool loadLegacyScene(RayTracer& rayTracer, const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) return false;
+    rayTracer.clearScene();
+    bool hasLight = false;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string type;
+        ss >> type;
+        if (type == "camera") {
+            Vector3f lookFrom, lookAt, up;
+            float fov;
+            ss >> lookFrom.x >> lookFrom.y >> lookFrom.z >> lookAt.x >> lookAt.y >> lookAt.z
+               >> up.x >> up.y >> up.z >> fov;
+            rayTracer.setCamera(lookFrom, lookAt, up, fov);
+        } else if (type == "light") {
+            Vector3f position, color;
+            float intensity;
+            ss >> position.x >> position.y >> position.z >> color.x >> color.y >> color.z >> intensity;
+            rayTracer.addLight(position, color, intensity);
+            hasLight = true;
+        } else if (type == "sphere") {
+            Vector3f center, color;
+            float radius, ambient, diffuse, specular, shininess, reflectivity;
+            ss >> center.x >> center.y >> center.z >> radius >> color.x >> color.y >> color.z
+               >> ambient >> diffuse >> specular >> shininess >> reflectivity;
+            rayTracer.addSphere(center, radius, Material(color, ambient, diffuse, specular, shininess, reflectivity));
+        } else if (type == "box") {
+            Vector3f min, max, color;
+            float ambient, diffuse, specular, shininess, reflectivity;
+            ss >> min.x >> min.y >> min.z >> max.x >> max.y >> max.z >> color.x >> color.y >> color.z
+               >> ambient >> diffuse >> specular >> shininess >> reflectivity;
+            rayTracer.addBox(min, max, Material(color, ambient, diffuse, specular, shininess, reflectivity));
+        } else if (type == "triangle") {
+            Vector3f v0, v1, v2, color;
+            float ambient, diffuse, specular, shininess, reflectivity;
+            ss >> v0.x >> v0.y >> v0.z >> v1.x >> v1.y >> v1.z >> v2.x >> v2.y >> v2.z
+               >> color.x >> color.y >> color.z >> ambient >> diffuse >> specular >> shininess >> reflectivity;
+            rayTracer.addTriangle(v0, v1, v2, Material(color, ambient, diffuse, specular, shininess, reflectivity));
+        } else if (type == "background") {
+            Vector3f color;
+            ss >> color.x >> color.y >> color.z;
+            rayTracer.setBackgroundColor(color);
+        } else if (type == "reflections") {
+            int enabled, depth;
+            ss >> enabled >> depth;
+            rayTracer.setReflectionsEnabled(enabled != 0);
+            rayTracer.setMaxReflectionDepth(depth);
+        }
+    }
+    if (!hasLight) rayTracer.addLight(Vector3f(10, 10, 10));
+    return true;
+}
+
+// ############################################################################################
+// Half spheres, half triangles scattered over a cube, behind a camera and two lights
+bool writeTestScene(const std::string& filename, int objects) {
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file) return false;
+    fprintf(file, "# Procedural benchmark scene\ncamera 0 0 30  0 0 0  0 1 0  45\n");
+    fprintf(file, "light 10 10 10  1 1 1  0.8\nlight -10 5 10  0.6 0.6 1  0.5\nbackground 0.1 0.1 0.2\nreflections 1 3\n");
+    srand(1);
+    for (int i = 0; i < objects; i++) {
+        float x = rand() / (float)RAND_MAX * 20.0f - 10.0f;
+        float y = rand() / (float)RAND_MAX * 20.0f - 10.0f;
+        float z = rand() / (float)RAND_MAX * 20.0f - 10.0f;
+        float r = rand() / (float)RAND_MAX, g = rand() / (float)RAND_MAX;
+        if (i % 2 == 0) {
+            fprintf(file, "sphere %.4f %.4f %.4f 0.1 %.3f %.3f 0.5 0.1 0.7 0.3 32 0.2\n", x, y, z, r, g);
+        } else {
+            fprintf(file, "triangle %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.3f %.3f 0.5 0.1 0.7 0.3 32 0\n",
+                    x, y, z, x + 0.2f, y, z, x, y + 0.2f, z, r, g);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int objects = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::string directory = argc > 2 ? argv[2] : "/tmp";
+    std::string filename = directory + "/scene_bench.txt";
+    if (!writeTestScene(filename, objects)) {
+        std::cerr << "Failed to write " << filename << std::endl;
+        return 1;
+    }
+
+    RayTracer legacy(4, 4), parsed(4, 4);
+    auto start = std::chrono::high_resolution_clock::now();
+    bool legacyLoaded = loadLegacyScene(legacy, filename);
+    double legacySeconds = secondsSince(start);
+
+    SceneParseStats stats;
+    start = std::chrono::high_resolution_clock::now();
+    bool loaded = parsed.loadSceneFromFile(filename, &stats);
+    double fastSeconds = secondsSince(start);
+    if (!legacyLoaded || !loaded) {
+        std::cerr << "Failed to load " << filename << std::endl;
+        return 1;
+    }
+
+    // Both scenes must render the same image
+    legacy.renderFrame();
+    parsed.renderFrame();
+    bool identical = legacy.getRayCount() == parsed.getRayCount() &&
+                     legacy.getFramebuffer() == parsed.getFramebuffer();
+
+    double megabytes = stats.fileBytes / (1024.0 * 1024.0);
+    std::cout << "Scene: " << stats.objects << " objects, " << stats.lights << " lights, " << stats.lines
+              << " lines, " << std::fixed << std::setprecision(1) << megabytes << " MB" << std::endl;
+    std::cout << std::left << std::setw(14) << "stringstream" << std::right << std::setw(10) << legacySeconds * 1000.0
+              << " ms " << std::setw(8) << megabytes / legacySeconds << " MB/s" << std::endl;
+    std::cout << std::left << std::setw(14) << "SceneParser" << std::right << std::setw(10) << fastSeconds * 1000.0
+              << " ms " << std::setw(8) << megabytes / fastSeconds << " MB/s" << std::endl;
+    std::cout << "Speedup: " << legacySeconds / fastSeconds << "x" << std::endl;
+    std::cout << "Renders " << (identical ? "identical" : "DIFFER") << std::endl;
+
+    remove(filename.c_str());
+    return identical ? 0 : 1;
+}
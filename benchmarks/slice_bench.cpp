@@ -0,0 +1,68 @@
+// ############################################################################################
+// Mesh slicing benchmark
+// Times MeshSlicer::SliceMesh with two planes on one thread (the serial path) against all
+// threads (chunks sliced in parallel and merged by prefix sums). The two outputs must match
+// byte for byte. Welding is left out so only the slicing is measured.
+//
+// Usage: slice_bench [million triangles]
+#include "MeshSlicer.h"
+#include "bench_mesh.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void report(const char* name, double seconds, size_t triangles) {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << seconds * 1000.0 << " ms " << std::setw(8) << triangles / 1e6 / seconds
+              << " Mtri/s" << std::endl;
+}
+
+template <typename T>
+bool sameVector(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+int main(int argc, char** argv) {
+    double millions = argc > 1 ? atof(argv[1]) : 2.0;
+    std::vector<Vector3f> vertices, normals;
+    std::vector<unsigned int> indices;
+    buildSphere(static_cast<size_t>(millions * 1e6), vertices, indices, &normals);
+    size_t triangles = indices.size() / 3;
+
+    MeshSlicer slicer;
+    slicer.AddPlane(MeshSlicer::Plane(Vector3f(1.0f, 0.2f, 0.0f), -0.3f));
+    slicer.AddPlane(MeshSlicer::Plane(Vector3f(0.0f, -1.0f, 0.3f), -0.1f));
+    slicer.SetWeld(false);
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    std::vector<Vector3f> serialVertices, serialNormals, outVertices, outNormals;
+    std::vector<unsigned int> serialIndices, outIndices;
+    auto start = std::chrono::high_resolution_clock::now();
+    slicer.SliceMesh(vertices, normals, indices, serialVertices, serialNormals, serialIndices);
+    report("serial", secondsSince(start), triangles);
+
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    start = std::chrono::high_resolution_clock::now();
+    slicer.SliceMesh(vertices, normals, indices, outVertices, outNormals, outIndices);
+    report("parallel", secondsSince(start), triangles);
+
+    bool identical = sameVector(outVertices, serialVertices) && sameVector(outNormals, serialNormals) &&
+                     sameVector(outIndices, serialIndices);
+    std::cout << "Mesh: " << triangles << " triangles sliced into " << outIndices.size() / 3 << " on " << threads
+              << " threads, parallel output " << (identical ? "identical to serial" : "DIFFERS from serial")
+              << std::endl;
+    return identical ? 0 : 1;
+}
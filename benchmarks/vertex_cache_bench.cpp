@@ -0,0 +1,82 @@
+// ############################################################################################
+// Vertex cache optimization benchmark
+// Runs OptimizeMeshOrder on a sphere in exporter row order and on the same sphere with its
+// triangles shuffled, as scanned or merged meshes tend to be. Prints the ACMR for 16- and
+// 32-entry caches and the time of a sweep that fetches every corner in index order, before
+// and after, plus the time of the pass itself. The reordered mesh must contain the same
+// triangles (compared as positions).
+//
+// Usage: vertex_cache_bench [million triangles]
+#include "include/mesh_optimize.h"
+#include "bench_mesh.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+volatile float fetchSink;     // Keeps the sweep from being optimized away
+
+// ############################################################################################
+// Fetch every corner's position in index order, as a vertex shader or BVH leaf test does
+double fetchSweep(const std::vector<Vector3f>& vertices, const std::vector<uint32_t>& indices) {
+    auto start = std::chrono::high_resolution_clock::now();
+    Vector3f sum(0.0f, 0.0f, 0.0f);
+    for (size_t c = 0; c < indices.size(); c++) sum += vertices[indices[c]];
+    fetchSink = sum.x + sum.y + sum.z;
+    return secondsSince(start);
+}
+
+// ############################################################################################
+// Sum of the triangles' corner positions, which any reordering must preserve (up to rounding)
+double triangleChecksum(const std::vector<Vector3f>& vertices, const std::vector<uint32_t>& indices) {
+    double sum = 0.0;
+    for (size_t c = 0; c < indices.size(); c++) {
+        const Vector3f& p = vertices[indices[c]];
+        sum += p.x * 1.0 + p.y * 3.0 + p.z * 7.0;
+    }
+    return sum;
+}
+
+// ############################################################################################
+// Optimize one mesh and report; false if the triangles changed
+bool run(const char* name, std::vector<Vector3f> vertices, std::vector<uint32_t> indices) {
+    size_t triangles = indices.size() / 3;
+    double checksum = triangleChecksum(vertices, indices);
+    double acmr32 = ComputeACMR(indices.data(), triangles, vertices.size(), 32);
+    double sweepBefore = fetchSweep(vertices, indices);
+
+    MeshOptimizeStats stats = OptimizeMeshOrder(vertices, indices);
+    double acmr32After = ComputeACMR(indices.data(), triangles, vertices.size(), 32);
+    double sweepAfter = fetchSweep(vertices, indices);
+    bool same = fabs(triangleChecksum(vertices, indices) - checksum) <= 1e-6 * (fabs(checksum) + triangles);
+
+    std::cout << std::fixed << std::setprecision(3) << name << ": ACMR(16) " << stats.acmrBefore << " -> "
+              << stats.acmrAfter << ", ACMR(32) " << acmr32 << " -> " << acmr32After << std::setprecision(1)
+              << ", pass " << stats.seconds * 1000.0 << " ms, fetch sweep " << sweepBefore * 1000.0 << " -> "
+              << sweepAfter * 1000.0 << " ms" << (same ? "" : "  TRIANGLES CHANGED") << std::endl;
+    return same;
+}
+
+int main(int argc, char** argv) {
+    double millions = argc > 1 ? atof(argv[1]) : 1.0;
+    std::vector<Vector3f> vertices;
+    std::vector<uint32_t> indices;
+    buildSphere(static_cast<size_t>(millions * 1e6), vertices, indices);
+    size_t triangles = indices.size() / 3;
+    std::cout << "Mesh: " << vertices.size() << " vertices, " << triangles << " triangles" << std::endl;
+
+    bool ok = run("row order", vertices, indices);
+
+    srand(1);
+    for (size_t t = triangles - 1; t > 0; t--) {
+        size_t other = (static_cast<size_t>(rand()) * (RAND_MAX + 1ULL) + rand()) % (t + 1);
+        for (int k = 0; k < 3; k++) std::swap(indices[t * 3 + k], indices[other * 3 + k]);
+    }
+    ok = run("shuffled", vertices, indices) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// ############################################################################################
+// Vertex welding benchmark
+// Builds a triangle soup (a grid whose triangles each have their own three corners, as in
+// face-by-face OFF exports and sliced meshes), welds it with a serial std::unordered_map
+// keyed by position and with the parallel WeldVertices, exactly and with a tolerance after
+// jittering the corners, checks the results and reports times and reduction ratios.
+//
+// Usage: weld_bench [million triangles]
+#include "include/mesh_weld.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+// ############################################################################################
+// A grid of about 'triangleCount' triangles in the xy plane, every triangle with its own
+// corners, each moved by up to 'jitter' in x and y
+void buildSoup(size_t triangleCount, float jitter, std::vector<Vector3f>& vertices, std::vector<uint32_t>& indices,
+               size_t& gridVertices) {
+    int side = std::max(1, static_cast<int>(sqrt(triangleCount / 2.0)));
+    gridVertices = static_cast<size_t>(side + 1) * (side + 1);
+    srand(1);
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            Vector3f quad[4] = { Vector3f(x, y, 0.0f), Vector3f(x + 1, y, 0.0f), Vector3f(x + 1, y + 1, 0.0f),
+                                 Vector3f(x, y + 1, 0.0f) };
+            const int corners[6] = { 0, 1, 2, 0, 2, 3 };
+            for (int k = 0; k < 6; k++) {
+                Vector3f p = quad[corners[k]];
+                p.x += jitter * (rand() / static_cast<float>(RAND_MAX) - 0.5f);
+                p.y += jitter * (rand() / static_cast<float>(RAND_MAX) - 0.5f);
+                indices.push_back(static_cast<uint32_t>(vertices.size()));
+                vertices.push_back(p);
+            }
+        }
+    }
+}
+
+// ############################################################################################
+// The straightforward serial weld of exact duplicates
+struct PositionHash {
+    size_t operator()(const Vector3f& p) const {
+        return mesh_weld_detail::HashCell(mesh_weld_detail::FloatBits(p.x), mesh_weld_detail::FloatBits(p.y),
+                                          mesh_weld_detail::FloatBits(p.z));
+    }
+};
+
+struct PositionEqual {
+    bool operator()(const Vector3f& a, const Vector3f& b) const {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+};
+
+void serialWeld(std::vector<Vector3f>& vertices, std::vector<uint32_t>& indices) {
+    std::unordered_map<Vector3f, uint32_t, PositionHash, PositionEqual> first;
+    std::vector<uint32_t> newIndex(vertices.size());
+    std::vector<Vector3f> kept;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        std::pair<std::unordered_map<Vector3f, uint32_t, PositionHash, PositionEqual>::iterator, bool> inserted =
+            first.insert(std::make_pair(vertices[i], static_cast<uint32_t>(kept.size())));
+        if (inserted.second) kept.push_back(vertices[i]);
+        newIndex[i] = inserted.first->second;
+    }
+    for (size_t c = 0; c < indices.size(); c++) indices[c] = newIndex[indices[c]];
+    vertices.swap(kept);
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void report(const char* name, double seconds, size_t inputVertices, size_t outputVertices) {
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << seconds * 1000.0 << " ms " << std::setw(8) << inputVertices / 1e6 / seconds
+              << " Mverts/s  " << inputVertices << " -> " << outputVertices << " vertices (ratio "
+              << std::setprecision(3) << static_cast<double>(outputVertices) / inputVertices << ")" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    double millions = argc > 1 ? atof(argv[1]) : 1.0;
+    size_t triangles = static_cast<size_t>(millions * 1e6);
+    size_t gridVertices;
+    std::vector<Vector3f> soup, vertices, reference;
+    std::vector<uint32_t> soupIndices, indices, referenceIndices;
+    buildSoup(triangles, 0.0f, soup, soupIndices, gridVertices);
+    std::cout << "Soup: " << soup.size() << " vertices, " << soupIndices.size() / 3 << " triangles, "
+              << gridVertices << " distinct positions" << std::endl;
+
+    reference = soup;
+    referenceIndices = soupIndices;
+    auto start = std::chrono::high_resolution_clock::now();
+    serialWeld(reference, referenceIndices);
+    report("serial hash map", secondsSince(start), soup.size(), reference.size());
+
+    vertices = soup;
+    indices = soupIndices;
+    WeldStats exact = WeldVertices(vertices, indices, 0.0f);
+    report("parallel exact", exact.seconds, exact.inputVertices, exact.outputVertices);
+    bool identical = vertices.size() == reference.size() && indices == referenceIndices &&
+                     memcmp(vertices.data(), reference.data(), vertices.size() * sizeof(Vector3f)) == 0;
+    std::cout << "Exact weld " << (identical ? "identical to serial" : "DIFFERS from serial") << std::endl;
+
+    // Corners moved by up to 0.0005 weld back into the grid with a tolerance of 0.002
+    soup.clear();
+    soupIndices.clear();
+    buildSoup(triangles, 0.001f, soup, soupIndices, gridVertices);
+    WeldStats tolerance = WeldVertices(soup, soupIndices, 0.002f);
+    report("parallel tolerance", tolerance.seconds, tolerance.inputVertices, tolerance.outputVertices);
+    bool welded = tolerance.outputVertices == gridVertices;
+    std::cout << "Tolerance weld " << (welded ? "restored the grid" : "did NOT restore the grid") << std::endl;
+    return identical && welded ? 0 : 1;
+}
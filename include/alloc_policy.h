@@ -0,0 +1,231 @@
+#ifndef ALLOC_POLICY_H
+#define ALLOC_POLICY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// ############################################################################################
+// Page placement policy for large scene and framebuffer allocations
+enum AllocPolicy {
+    ALLOC_DEFAULT = 0,      // Let the OS place pages (first touch)
+    ALLOC_INTERLEAVE        // Spread pages round-robin over all NUMA nodes
+};
+
+struct AllocConfig {
+    AllocPolicy policy;
+    bool hugePages;         // Ask for transparent huge pages with madvise
+
+    AllocConfig() : policy(ALLOC_DEFAULT), hugePages(false) {}
+};
+
+// ############################################################################################
+// Process-wide allocation configuration - set it before loading the scene
+inline AllocConfig& GlobalAllocConfig() {
+    static AllocConfig config;
+    return config;
+}
+
+inline const char* AllocPolicyName(AllocPolicy policy) {
+    return policy == ALLOC_INTERLEAVE ? "interleave" : "default";
+}
+
+// ############################################################################################
+// Parse a policy name as used on the command line, returns false for unknown names
+inline bool ParseAllocPolicy(const std::string& name, AllocPolicy& policy) {
+    if (name == "default") { policy = ALLOC_DEFAULT; return true; }
+    if (name == "interleave") { policy = ALLOC_INTERLEAVE; return true; }
+    return false;
+}
+
+// ############################################################################################
+// Bit mask of online NUMA nodes, read from sysfs (0 if unknown or not on Linux)
+inline unsigned long OnlineNumaNodeMask() {
+    static long cached = -1;
+    if (cached >= 0) return static_cast<unsigned long>(cached);
+
+    unsigned long mask = 0;
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if (f) {
+        // Format is a list of ranges, e.g. "0-1" or "0,2-3"
+        int first, last;
+        char sep;
+        while (fscanf(f, "%d", &first) == 1) {
+            last = first;
+            if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+                if (fscanf(f, "%d", &last) != 1) break;
+                if (fscanf(f, "%c", &sep) != 1) sep = '\n';
+            }
+            for (int n = first; n <= last && n < 64; n++) mask |= 1ul << n;
+            if (sep != ',') break;
+        }
+        fclose(f);
+    }
+    cached = static_cast<long>(mask);
+    return mask;
+}
+
+inline int NumaNodeCount() {
+    return __builtin_popcountl(OnlineNumaNodeMask());
+}
+
+// ############################################################################################
+// Apply the configured policy to a freshly mapped region
+inline void ApplyAllocPolicy(void* addr, size_t bytes, const AllocConfig& config) {
+#ifdef MADV_HUGEPAGE
+    if (config.hugePages) {
+        madvise(addr, bytes, MADV_HUGEPAGE);
+    }
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+    if (config.policy == ALLOC_INTERLEAVE && NumaNodeCount() > 1) {
+        const int MPOL_INTERLEAVE_MODE = 3; // MPOL_INTERLEAVE from <linux/mempolicy.h>
+        unsigned long mask = OnlineNumaNodeMask();
+        syscall(SYS_mbind, addr, bytes, MPOL_INTERLEAVE_MODE, &mask, sizeof(mask) * 8, 0);
+    }
+#endif
+}
+
+// ############################################################################################
+// Map zeroed memory with the current policy. With huge pages the region is 2MB aligned
+// so the kernel can back it with huge pages from the start.
+inline void* PolicyAlloc(size_t bytes) {
+    const AllocConfig& config = GlobalAllocConfig();
+    const size_t hugePageSize = 2u << 20;
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t length = (bytes + pageSize - 1) / pageSize * pageSize;
+
+    void* addr;
+    if (config.hugePages && length >= hugePageSize) {
+        // Over-map, then trim the unaligned head and tail
+        size_t padded = length + hugePageSize;
+        char* raw = static_cast<char*>(mmap(NULL, padded, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (base + hugePageSize - 1) & ~(uintptr_t)(hugePageSize - 1);
+        size_t head = aligned - base;
+        size_t tail = padded - head - length;
+        if (head) munmap(raw, head);
+        if (tail) munmap(reinterpret_cast<char*>(aligned) + length, tail);
+        addr = reinterpret_cast<void*>(aligned);
+    } else {
+        addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) throw std::bad_alloc();
+    }
+
+    ApplyAllocPolicy(addr, length, config);
+    return addr;
+}
+
+inline void PolicyFree(void* addr, size_t bytes) {
+    if (!addr) return;
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    munmap(addr, (bytes + pageSize - 1) / pageSize * pageSize);
+}
+
+// ############################################################################################
+// STL allocator backed by PolicyAlloc, used for framebuffers.
+// Elements are default-initialized rather than zeroed: fresh pages are already zero, and
+// leaving them untouched means each page is first written (and placed) by a render thread.
+template <typename T>
+class PolicyAllocator {
+public:
+    typedef T value_type;
+
+    PolicyAllocator() {}
+    template <typename U> PolicyAllocator(const PolicyAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(PolicyAlloc(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { PolicyFree(p, n * sizeof(T)); }
+
+    template <typename U> void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+    template <typename U, typename... Args> void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U> struct rebind { typedef PolicyAllocator<U> other; };
+};
+
+template <typename T, typename U>
+inline bool operator==(const PolicyAllocator<T>&, const PolicyAllocator<U>&) { return true; }
+template <typename T, typename U>
+inline bool operator!=(const PolicyAllocator<T>&, const PolicyAllocator<U>&) { return false; }
+
+// ############################################################################################
+// Bump allocator for scene objects. Memory comes in large chunks from PolicyAlloc so the
+// whole scene follows the configured policy; everything is returned once the last object
+// is freed (e.g. when the scene is cleared). Allocation is serialized with a mutex.
+class SceneArena {
+public:
+    static SceneArena& Instance() {
+        static SceneArena arena;
+        return arena;
+    }
+
+    void* Allocate(size_t bytes) {
+        const size_t chunkSize = 4u << 20;
+        const size_t alignment = 16;
+        std::lock_guard<std::mutex> lock(mutex);
+        bytes = (bytes + alignment - 1) & ~(alignment - 1);
+
+        if (chunks.empty() || offset + bytes > chunks.back().size) {
+            Chunk chunk;
+            chunk.size = bytes > chunkSize ? bytes : chunkSize;
+            chunk.data = static_cast<char*>(PolicyAlloc(chunk.size));
+            chunks.push_back(chunk);
+            offset = 0;
+        }
+
+        void* result = chunks.back().data + offset;
+        offset += bytes;
+        liveObjects++;
+        return result;
+    }
+
+    void Deallocate(void* ptr) {
+        if (!ptr) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--liveObjects == 0) {
+            for (size_t i = 0; i < chunks.size(); i++) {
+                PolicyFree(chunks[i].data, chunks[i].size);
+            }
+            chunks.clear();
+            offset = 0;
+        }
+    }
+
+    size_t ReservedBytes() const {
+        size_t total = 0;
+        for (size_t i = 0; i < chunks.size(); i++) total += chunks[i].size;
+        return total;
+    }
+
+private:
+    struct Chunk {
+        char* data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t offset;
+    size_t liveObjects;
+    std::mutex mutex;
+
+    SceneArena() : offset(0), liveObjects(0) {}
+    SceneArena(const SceneArena&) = delete;
+    SceneArena& operator=(const SceneArena&) = delete;
+};
+
+#endif // ALLOC_POLICY_H
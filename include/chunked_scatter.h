@@ -0,0 +1,59 @@
+#ifndef CHUNKED_SCATTER_H
+#define CHUNKED_SCATTER_H
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ############################################################################################
+// Turn per-chunk counts into slots: chunk c's count for key k is slots[c * keyCount + k],
+// and it is replaced by the first slot of that (chunk, key), with keys in order and the
+// chunks in order within every key, counting from 'base'. 'keyStart', if given, receives
+// the first slot of every key and the end after the last. Returns the end slot.
+inline size_t ChunkSlotOffsets(size_t* slots, size_t keyCount, size_t chunks, size_t base,
+                               std::vector<size_t>* keyStart = NULL) {
+    if (keyStart) keyStart->resize(keyCount + 1);
+    size_t total = base;
+    for (size_t k = 0; k < keyCount; k++) {
+        if (keyStart) (*keyStart)[k] = total;
+        for (size_t c = 0; c < chunks; c++) {
+            size_t counted = slots[c * keyCount + k];
+            slots[c * keyCount + k] = total;
+            total += counted;
+        }
+    }
+    if (keyStart) (*keyStart)[keyCount] = total;
+    return total;
+}
+
+// ############################################################################################
+// Stable parallel scatter of 'count' items into 'keyCount' groups without atomics. The
+// items are split into one contiguous range per chunk (a multiple of 'granularity' items
+// each, e.g. 3 to keep triangles together). Every chunk counts its items per key with
+// countRange(first, last, counts), ChunkSlotOffsets gives every chunk its own slots in each
+// key's group, and every chunk then places its items with scatterRange(first, last, next),
+// where next[k] is the slot for its next item of key k. Items keep their order within a
+// key, so the result does not depend on the number of chunks. 'keyStart' is as in
+// ChunkSlotOffsets.
+template <typename CountRange, typename ScatterRange>
+inline void ChunkedScatter(size_t count, size_t keyCount, int chunks, size_t granularity, CountRange countRange,
+                           ScatterRange scatterRange, std::vector<size_t>* keyStart = NULL) {
+    std::vector<size_t> slots(static_cast<size_t>(chunks) * keyCount, 0);
+    size_t chunkSize = (count / granularity + chunks - 1) / chunks * granularity;
+    #pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < chunks; c++) {
+        size_t first = std::min(count, c * chunkSize);
+        countRange(first, std::min(count, first + chunkSize), &slots[c * keyCount]);
+    }
+    ChunkSlotOffsets(slots.data(), keyCount, chunks, 0, keyStart);
+    #pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < chunks; c++) {
+        size_t first = std::min(count, c * chunkSize);
+        scatterRange(first, std::min(count, first + chunkSize), &slots[c * keyCount]);
+    }
+}
+
+#endif // CHUNKED_SCATTER_H
@@ -0,0 +1,147 @@
+#ifndef FAST_PARSE_H
+#define FAST_PARSE_H
+
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+
+// ############################################################################################
+// Number parsing over [begin, end) character ranges that need not be NUL terminated (e.g.
+// memory-mapped files), in the style of std::from_chars: each parser returns the position
+// after the number, or NULL if no number starts at 'p'. No locale, no allocation.
+
+namespace fast_parse_detail {
+
+// Powers of ten that are exact in double precision
+const double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool IsDigit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+} // namespace fast_parse_detail
+
+// ############################################################################################
+// Whitespace other than newlines
+inline bool IsBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// ############################################################################################
+// Skip whitespace within the current line
+inline const char* SkipBlank(const char* p, const char* end) {
+    while (p < end && IsBlank(*p)) p++;
+    return p;
+}
+
+// ############################################################################################
+// Skip whitespace (including newlines) and '#' comments running to the end of their line
+inline const char* SkipSpace(const char* p, const char* end) {
+    while (p < end) {
+        if (IsBlank(*p) || *p == '\n') {
+            p++;
+        } else if (*p == '#') {
+            while (p < end && *p != '\n') p++;
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+// ############################################################################################
+// Skip the rest of the current line, including its newline
+inline const char* SkipLine(const char* p, const char* end) {
+    const void* newline = p < end ? memchr(p, '\n', end - p) : NULL;
+    return newline ? static_cast<const char*>(newline) + 1 : end;
+}
+
+// ############################################################################################
+// Parse a decimal integer with optional sign
+inline const char* ParseInt(const char* p, const char* end, int& value) {
+    using namespace fast_parse_detail;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if (p >= end || !IsDigit(*p)) return NULL;
+    int64_t result = 0;
+    while (p < end && IsDigit(*p)) {
+        result = result * 10 + (*p++ - '0');
+        if (result > 0x7fffffffLL + negative) return NULL; // Overflow
+    }
+    value = static_cast<int>(negative ? -result : result);
+    return p;
+}
+
+// ############################################################################################
+// Parse a floating point number: [sign] digits [. digits] [e [sign] digits], also ".5".
+// Up to 19 significant digits are kept and scaled by an exact power of ten, which rounds
+// correctly in double precision for everything a mesh or scene file contains.
+inline const char* ParseFloat(const char* p, const char* end, double& value) {
+    using namespace fast_parse_detail;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;         // Significant digits stored in mantissa
+    int exponent = 0;       // Decimal exponent applied to mantissa
+    bool any = false;
+    while (p < end && IsDigit(*p)) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;     // Digits beyond the precision only scale the value
+        }
+        p++;
+        any = true;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && IsDigit(*p)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+            p++;
+            any = true;
+        }
+    }
+    if (!any) return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) negativeExponent = *q++ == '-';
+        if (q < end && IsDigit(*q)) {
+            int e = 0;
+            while (q < end && IsDigit(*q)) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+                q++;
+            }
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0 && exponent != 0) {
+        if (exponent > 0 && exponent <= 22) result *= POW10[exponent];
+        else if (exponent < 0 && exponent >= -22) result /= POW10[-exponent];
+        else result *= std::pow(10.0, exponent);
+    }
+    value = negative ? -result : result;
+    return p;
+}
+
+inline const char* ParseFloat(const char* p, const char* end, float& value) {
+    double result;
+    p = ParseFloat(p, end, result);
+    if (p) value = static_cast<float>(result);
+    return p;
+}
+
+#endif // FAST_PARSE_H
@@ -0,0 +1,605 @@
+#ifndef FRAME_ARCHIVE_H
+#define FRAME_ARCHIVE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <cerrno>
+#include <iostream>
+#include "png_io.h"
+
+// ############################################################################################
+// Frame archive: many rendered frames with metadata in one indexed file.
+//
+// Layout (all integers little endian):
+//   "RMFA" u32 version
+//   frame payloads, one after another
+//   index: per frame a FrameInfo record (see WriteIndex)
+//   trailer: u64 index offset, u32 frame count, "RMFI"
+//
+// A writer holds an exclusive lock on the file and only ever appends: new payloads go after
+// the existing trailer and a new index (old and new entries) and trailer follow them on
+// close. Until then the last complete trailer still describes the earlier frames, and
+// readers fall back to it when an append was cut short. Payloads are 8-bit RGB, optionally
+// delta filtered (each byte minus the same channel of the pixel to its left) and
+// LZ4-block compressed. Compression and writing run on a background thread.
+
+// ############################################################################################
+// LZ4 block format compressor and decompressor
+
+namespace lz4_detail {
+
+inline uint32_t Read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+inline void PutLength(std::vector<unsigned char>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<unsigned char>(length));
+}
+
+} // namespace lz4_detail
+
+// ############################################################################################
+// Compress 'size' bytes into LZ4 block format, appending to 'out'.
+// Greedy matching with a 4K-entry hash of 4-byte sequences.
+inline void Lz4Compress(const unsigned char* data, size_t size, std::vector<unsigned char>& out) {
+    using namespace lz4_detail;
+    const int HASH_BITS = 12;
+    const size_t MIN_MATCH = 4;
+    const size_t LAST_LITERALS = 5;     // The block must end with at least 5 literals
+    const size_t MATCH_LIMIT = 12;      // and no match may start in its last 12 bytes
+    const size_t MAX_OFFSET = 65535;
+
+    std::vector<uint32_t> table(1 << HASH_BITS, 0);
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    if (size > MATCH_LIMIT) {
+        while (pos + MATCH_LIMIT < size) {
+            uint32_t sequence = Read32(data + pos);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+            size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(pos);
+
+            if (candidate >= pos || pos - candidate > MAX_OFFSET || Read32(data + candidate) != sequence) {
+                pos++;
+                continue;
+            }
+
+            // Extend the match, keeping the last bytes as literals
+            size_t length = MIN_MATCH;
+            size_t limit = size - LAST_LITERALS;
+            while (pos + length < limit && data[candidate + length] == data[pos + length]) length++;
+
+            // Sequence: token, literal length, literals, offset, match length
+            size_t literals = pos - anchor;
+            size_t matchExtra = length - MIN_MATCH;
+            out.push_back(static_cast<unsigned char>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchExtra, 15)));
+            if (literals >= 15) PutLength(out, literals - 15);
+            out.insert(out.end(), data + anchor, data + pos);
+            size_t offset = pos - candidate;
+            out.push_back(static_cast<unsigned char>(offset));
+            out.push_back(static_cast<unsigned char>(offset >> 8));
+            if (matchExtra >= 15) PutLength(out, matchExtra - 15);
+
+            pos += length;
+            anchor = pos;
+        }
+    }
+
+    // Final literals
+    size_t literals = size - anchor;
+    out.push_back(static_cast<unsigned char>(std::min<size_t>(literals, 15) << 4));
+    if (literals >= 15) PutLength(out, literals - 15);
+    out.insert(out.end(), data + anchor, data + size);
+}
+
+// ############################################################################################
+// Decompress an LZ4 block into exactly 'rawSize' bytes; false if the data is malformed
+inline bool Lz4Decompress(const unsigned char* data, size_t size, unsigned char* out, size_t rawSize) {
+    size_t in = 0, pos = 0;
+    while (in < size) {
+        unsigned char token = data[in++];
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            unsigned char b;
+            do {
+                if (in >= size) return false;
+                b = data[in++];
+                literals += b;
+            } while (b == 255);
+        }
+        if (in + literals > size || pos + literals > rawSize) return false;
+        memcpy(out + pos, data + in, literals);
+        in += literals;
+        pos += literals;
+        if (in == size) break; // The last sequence has no match
+
+        if (in + 2 > size) return false;
+        size_t offset = data[in] | (data[in + 1] << 8);
+        in += 2;
+        size_t length = (token & 15) + 4;
+        if ((token & 15) == 15) {
+            unsigned char b;
+            do {
+                if (in >= size) return false;
+                b = data[in++];
+                length += b;
+            } while (b == 255);
+        }
+        if (offset == 0 || offset > pos || pos + length > rawSize) return false;
+        for (size_t k = 0; k < length; k++, pos++) out[pos] = out[pos - offset]; // May overlap
+    }
+    return pos == rawSize;
+}
+
+// ############################################################################################
+// Metadata stored with each frame
+struct FrameInfo {
+    std::string name;           // Scene or frame name
+    uint32_t width;
+    uint32_t height;
+    double renderSeconds;
+    uint64_t rayCount;
+    uint64_t timestamp;         // Seconds since the epoch when the frame was added
+
+    // Filled in by the archive
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t rawSize;
+    uint32_t flags;             // FRAME_LZ4 | FRAME_DELTA
+    uint32_t checksum;          // CRC-32 of the raw pixels
+
+    FrameInfo() : width(0), height(0), renderSeconds(0.0), rayCount(0), timestamp(0),
+                  offset(0), storedSize(0), rawSize(0), flags(0), checksum(0) {}
+};
+
+enum FrameFlags {
+    FRAME_LZ4 = 1,
+    FRAME_DELTA = 2
+};
+
+namespace archive_detail {
+
+const uint32_t VERSION = 1;
+const size_t HEADER_SIZE = 8;
+const size_t TRAILER_SIZE = 16;
+const size_t INDEX_ENTRY_SIZE = 8 * 3 + 4 * 4 + 8 * 3 + 4;    // Without the name
+
+inline void Put32(std::vector<unsigned char>& out, uint32_t v) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+}
+
+inline void Put64(std::vector<unsigned char>& out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+}
+
+inline uint32_t Get32(const unsigned char* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+inline uint64_t Get64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+inline void EncodeIndex(const std::vector<FrameInfo>& frames, std::vector<unsigned char>& out) {
+    for (size_t i = 0; i < frames.size(); i++) {
+        const FrameInfo& f = frames[i];
+        Put64(out, f.offset);
+        Put64(out, f.storedSize);
+        Put64(out, f.rawSize);
+        Put32(out, f.width);
+        Put32(out, f.height);
+        Put32(out, f.flags);
+        Put32(out, f.checksum);
+        uint64_t seconds;
+        memcpy(&seconds, &f.renderSeconds, 8);
+        Put64(out, seconds);
+        Put64(out, f.rayCount);
+        Put64(out, f.timestamp);
+        Put32(out, static_cast<uint32_t>(f.name.size()));
+        out.insert(out.end(), f.name.begin(), f.name.end());
+    }
+}
+
+inline void EncodeTrailer(uint64_t indexOffset, uint32_t count, std::vector<unsigned char>& out) {
+    Put64(out, indexOffset);
+    Put32(out, count);
+    out.insert(out.end(), { 'R', 'M', 'F', 'I' });
+}
+
+// ############################################################################################
+// True if a frame's raw size is that of its width * height RGB pixels
+inline bool HasRawSize(const FrameInfo& f) {
+    uint64_t pixels = static_cast<uint64_t>(f.width) * f.height;
+    return pixels <= UINT64_MAX / 3 && f.rawSize == pixels * 3;
+}
+
+// ############################################################################################
+// Decode 'count' index entries that must fill the 'size' bytes exactly and describe frames
+// that lie between the header and 'indexOffset'
+inline bool DecodeIndex(const unsigned char* p, size_t size, uint32_t count, uint64_t indexOffset,
+                        std::vector<FrameInfo>& frames) {
+    const size_t FIXED = INDEX_ENTRY_SIZE;
+    size_t pos = 0;
+    frames.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        if (pos + FIXED > size) return false;
+        FrameInfo f;
+        f.offset = Get64(p + pos);
+        f.storedSize = Get64(p + pos + 8);
+        f.rawSize = Get64(p + pos + 16);
+        f.width = Get32(p + pos + 24);
+        f.height = Get32(p + pos + 28);
+        f.flags = Get32(p + pos + 32);
+        f.checksum = Get32(p + pos + 36);
+        uint64_t seconds = Get64(p + pos + 40);
+        memcpy(&f.renderSeconds, &seconds, 8);
+        f.rayCount = Get64(p + pos + 48);
+        f.timestamp = Get64(p + pos + 56);
+        uint32_t nameLength = Get32(p + pos + 64);
+        pos += FIXED;
+        if (pos + nameLength > size) return false;
+        f.name.assign(reinterpret_cast<const char*>(p + pos), nameLength);
+        pos += nameLength;
+        if (f.offset < HEADER_SIZE || f.storedSize > indexOffset || f.offset > indexOffset - f.storedSize) return false;
+        if (!HasRawSize(f)) return false;
+        frames.push_back(f);
+    }
+    return pos == size;
+}
+
+// ############################################################################################
+// Read the index whose trailer ends at byte 'end'; false if there is no valid one there.
+// Indices larger than 'maxIndexBytes' are not read.
+inline bool ReadIndexAt(FILE* file, uint64_t end, uint64_t maxIndexBytes, std::vector<FrameInfo>& frames,
+                        uint64_t& indexOffset) {
+    unsigned char trailer[TRAILER_SIZE];
+    if (end < HEADER_SIZE + TRAILER_SIZE || fseek(file, static_cast<long>(end - TRAILER_SIZE), SEEK_SET) != 0 ||
+        fread(trailer, 1, TRAILER_SIZE, file) != TRAILER_SIZE || memcmp(trailer + 12, "RMFI", 4) != 0) {
+        return false;
+    }
+    indexOffset = Get64(trailer);
+    uint32_t count = Get32(trailer + 8);
+    if (indexOffset < HEADER_SIZE || indexOffset > end - TRAILER_SIZE) return false;
+    uint64_t indexBytes = end - TRAILER_SIZE - indexOffset;
+    if (indexBytes > maxIndexBytes || indexBytes < static_cast<uint64_t>(count) * INDEX_ENTRY_SIZE) return false;
+
+    std::vector<unsigned char> index(static_cast<size_t>(indexBytes));
+    if (fseek(file, static_cast<long>(indexOffset), SEEK_SET) != 0 ||
+        fread(index.data(), 1, index.size(), file) != index.size()) {
+        return false;
+    }
+    return DecodeIndex(index.data(), index.size(), count, indexOffset, frames);
+}
+
+// ############################################################################################
+// Read the index of an open archive; false if the file is not a valid archive. 'end'
+// receives the end of the last complete trailer: when an append was cut short (the writer
+// crashed or is still running), the bytes after it are searched backwards for the
+// trailer it left behind.
+inline bool ReadIndex(FILE* file, std::vector<FrameInfo>& frames, uint64_t& indexOffset, uint64_t& end) {
+    unsigned char header[HEADER_SIZE];
+    if (fseek(file, 0, SEEK_SET) != 0 || fread(header, 1, HEADER_SIZE, file) != HEADER_SIZE ||
+        memcmp(header, "RMFA", 4) != 0 || fseek(file, 0, SEEK_END) != 0) {
+        return false;
+    }
+    end = static_cast<uint64_t>(ftell(file));
+    if (ReadIndexAt(file, end, end, frames, indexOffset)) return true;
+
+    // Blocks overlap by three bytes so that no "RMFI" is split between two of them
+    const size_t BLOCK = 1 << 20;
+    const uint64_t MAX_RECOVERED_INDEX = 64 << 20;
+    std::vector<unsigned char> block(BLOCK + 3);
+    uint64_t blockEnd = end;
+    while (blockEnd > HEADER_SIZE) {
+        uint64_t blockStart = std::max<uint64_t>(blockEnd > BLOCK ? blockEnd - BLOCK : 0, HEADER_SIZE);
+        size_t size = static_cast<size_t>(std::min<uint64_t>(end, blockEnd + 3) - blockStart);
+        if (fseek(file, static_cast<long>(blockStart), SEEK_SET) != 0 || fread(block.data(), 1, size, file) != size) {
+            return false;
+        }
+        for (size_t i = static_cast<size_t>(blockEnd - blockStart); i-- > 0;) {
+            if (i + 4 > size || memcmp(block.data() + i, "RMFI", 4) != 0) continue;
+            end = blockStart + i + 4;
+            if (ReadIndexAt(file, end, MAX_RECOVERED_INDEX, frames, indexOffset)) return true;
+        }
+        blockEnd = blockStart;
+    }
+    return false;
+}
+
+// ############################################################################################
+// Horizontal delta filter over RGB rows and its inverse
+inline void DeltaEncode(const unsigned char* in, unsigned char* out, size_t width, size_t height) {
+    size_t stride = width * 3;
+    for (size_t y = 0; y < height; y++) {
+        const unsigned char* row = in + y * stride;
+        unsigned char* dst = out + y * stride;
+        for (size_t i = 0; i < stride; i++) dst[i] = static_cast<unsigned char>(row[i] - (i >= 3 ? row[i - 3] : 0));
+    }
+}
+
+inline void DeltaDecode(unsigned char* data, size_t width, size_t height) {
+    size_t stride = width * 3;
+    for (size_t y = 0; y < height; y++) {
+        unsigned char* row = data + y * stride;
+        for (size_t i = 3; i < stride; i++) row[i] = static_cast<unsigned char>(row[i] + row[i - 3]);
+    }
+}
+
+} // namespace archive_detail
+
+// ############################################################################################
+// Appends frames to an archive. addFrame() copies the pixels and returns immediately; a
+// background thread compresses and writes frames in order. At most 'maxPending' frames
+// wait in the queue, after which addFrame() blocks.
+class FrameArchiveWriter {
+public:
+    FrameArchiveWriter() : file(NULL), writePos(0), stopping(false), failed(false), maxPending(4) {}
+    ~FrameArchiveWriter() { close(); }
+
+    // ############################################################################################
+    // Open an archive, keeping the frames of an existing one. The file stays locked against
+    // other writers until close(); a second writer waits for the first to finish.
+    bool open(const std::string& path) {
+        using namespace archive_detail;
+        close();
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        file = fd >= 0 ? fdopen(fd, "r+b") : NULL;
+        if (!file) {
+            if (fd >= 0) ::close(fd);
+            std::cerr << "Error: Could not open archive for writing: " << path << std::endl;
+            return false;
+        }
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            std::cerr << "Waiting for another writer of " << path << std::endl;
+            int result;
+            while ((result = flock(fd, LOCK_EX)) != 0 && errno == EINTR) {}
+            if (result != 0) {
+                std::cerr << "Error: Could not lock archive: " << path << std::endl;
+                fclose(file);
+                file = NULL;
+                return false;
+            }
+        }
+
+        // Append after the last complete trailer; the bytes of an unfinished append are dropped
+        uint64_t indexOffset = 0, end = 0;
+        bool valid = ReadIndex(file, frames, indexOffset, end);
+        if (valid) {
+            fseek(file, 0, SEEK_END);
+            if (static_cast<uint64_t>(ftell(file)) != end) {
+                std::cerr << "Warning: Dropping an unfinished append at the end of " << path << std::endl;
+            }
+        } else {
+            // Only an empty or new file becomes an archive; anything else is left untouched
+            if (fseek(file, 0, SEEK_END) != 0 || ftell(file) != 0) {
+                std::cerr << "Error: " << path << " exists and is not a valid frame archive" << std::endl;
+                fclose(file);
+                file = NULL;
+                return false;
+            }
+            // A new archive starts with an empty index, so it is valid from the start
+            frames.clear();
+            std::vector<unsigned char> start(4);
+            memcpy(start.data(), "RMFA", 4);
+            Put32(start, VERSION);
+            EncodeTrailer(HEADER_SIZE, 0, start);
+            end = start.size();
+            valid = fseek(file, 0, SEEK_SET) == 0 && fwrite(start.data(), 1, start.size(), file) == start.size();
+        }
+        if (!valid || fflush(file) != 0 || ftruncate(fd, static_cast<off_t>(end)) != 0) {
+            std::cerr << "Error: Could not prepare archive for writing: " << path << std::endl;
+            fclose(file);
+            file = NULL;
+            return false;
+        }
+        writePos = end;
+        failed = false;
+        stopping = false;
+        worker = std::thread(&FrameArchiveWriter::workerLoop, this);
+        return true;
+    }
+
+    // ############################################################################################
+    // Queue a frame of 8-bit RGB pixels (width * height * 3 bytes)
+    void addFrame(const FrameInfo& info, const unsigned char* pixels) {
+        Pending pending;
+        pending.info = info;
+        pending.info.rawSize = static_cast<uint64_t>(info.width) * info.height * 3;
+        pending.pixels.assign(pixels, pixels + pending.info.rawSize);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            spaceCondition.wait(lock, [this] { return queue.size() < maxPending; });
+            queue.push_back(std::move(pending));
+        }
+        workCondition.notify_one();
+    }
+
+    // ############################################################################################
+    // Finish queued frames, write the index and close; false if anything failed
+    bool close() {
+        if (!file) return true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        workCondition.notify_one();
+        if (worker.joinable()) worker.join();
+
+        // The payloads reach the disk before the index that refers to them; until the new
+        // trailer is written, the previous one still describes the file
+        std::vector<unsigned char> index;
+        archive_detail::EncodeIndex(frames, index);
+        archive_detail::EncodeTrailer(writePos, static_cast<uint32_t>(frames.size()), index);
+        bool ok = !failed && fflush(file) == 0 && fsync(fileno(file)) == 0 &&
+                  fseek(file, static_cast<long>(writePos), SEEK_SET) == 0 &&
+                  fwrite(index.data(), 1, index.size(), file) == index.size();
+        ok = fflush(file) == 0 && ok;
+        ok = fclose(file) == 0 && ok;       // Also releases the lock
+        file = NULL;
+        if (!ok) {
+            std::cerr << "Error: Failed to write frame archive" << std::endl;
+        }
+        return ok;
+    }
+
+    const std::vector<FrameInfo>& getFrames() const { return frames; }
+    bool isOpen() const { return file != NULL; }
+
+private:
+    struct Pending {
+        FrameInfo info;
+        std::vector<unsigned char> pixels;
+    };
+
+    FILE* file;
+    uint64_t writePos;
+    std::vector<FrameInfo> frames;
+    std::deque<Pending> queue;
+    std::mutex mutex;
+    std::condition_variable workCondition;
+    std::condition_variable spaceCondition;
+    std::thread worker;
+    bool stopping;
+    bool failed;
+    size_t maxPending;
+
+    // ############################################################################################
+    // Background thread: filter, compress and append each queued frame
+    void workerLoop() {
+        std::vector<unsigned char> filtered, compressed;
+        for (;;) {
+            Pending frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                workCondition.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                frame = std::move(queue.front());
+                queue.pop_front();
+            }
+            spaceCondition.notify_one();
+
+            FrameInfo& info = frame.info;
+            info.checksum = png_detail::Crc32(frame.pixels.data(), frame.pixels.size());
+            filtered.resize(frame.pixels.size());
+            archive_detail::DeltaEncode(frame.pixels.data(), filtered.data(), info.width, info.height);
+            compressed.clear();
+            Lz4Compress(filtered.data(), filtered.size(), compressed);
+
+            // Keep whichever is smaller
+            const std::vector<unsigned char>* payload = &compressed;
+            info.flags = FRAME_LZ4 | FRAME_DELTA;
+            if (compressed.size() >= frame.pixels.size()) {
+                payload = &frame.pixels;
+                info.flags = 0;
+            }
+            info.offset = writePos;
+            info.storedSize = payload->size();
+
+            if (fseek(file, static_cast<long>(writePos), SEEK_SET) != 0 ||
+                fwrite(payload->data(), 1, payload->size(), file) != payload->size()) {
+                failed = true;
+                continue;
+            }
+            writePos += payload->size();
+            frames.push_back(info);
+        }
+    }
+
+    FrameArchiveWriter(const FrameArchiveWriter&) = delete;
+    FrameArchiveWriter& operator=(const FrameArchiveWriter&) = delete;
+};
+
+// ############################################################################################
+// Reads frames back from an archive
+class FrameArchiveReader {
+public:
+    FrameArchiveReader() : file(NULL) {}
+    ~FrameArchiveReader() { if (file) fclose(file); }
+
+    bool open(const std::string& path) {
+        if (file) fclose(file);
+        file = fopen(path.c_str(), "rb");
+        if (!file) {
+            std::cerr << "Error: Could not open archive: " << path << std::endl;
+            return false;
+        }
+        uint64_t indexOffset, end;
+        if (!archive_detail::ReadIndex(file, frames, indexOffset, end)) {
+            std::cerr << "Error: Not a valid frame archive: " << path << std::endl;
+            return false;
+        }
+        fseek(file, 0, SEEK_END);
+        if (static_cast<uint64_t>(ftell(file)) != end) {
+            std::cerr << "Warning: " << path << " ends in an unfinished append; reading the frames before it" << std::endl;
+        }
+        return true;
+    }
+
+    const std::vector<FrameInfo>& getFrames() const { return frames; }
+
+    // ############################################################################################
+    // Decode frame 'index' into 8-bit RGB, verifying its checksum
+    bool readFrame(size_t index, std::vector<unsigned char>& pixels) {
+        if (index >= frames.size()) return false;
+        const FrameInfo& info = frames[index];
+        if (!archive_detail::HasRawSize(info)) {
+            std::cerr << "Error: Frame size does not match its dimensions: " << info.name << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> stored(static_cast<size_t>(info.storedSize));
+        if (fseek(file, static_cast<long>(info.offset), SEEK_SET) != 0 ||
+            fread(stored.data(), 1, stored.size(), file) != stored.size()) {
+            std::cerr << "Error: Truncated frame: " << info.name << std::endl;
+            return false;
+        }
+
+        pixels.resize(static_cast<size_t>(info.rawSize));
+        if (info.flags & FRAME_LZ4) {
+            if (!Lz4Decompress(stored.data(), stored.size(), pixels.data(), pixels.size())) {
+                std::cerr << "Error: Corrupt frame data: " << info.name << std::endl;
+                return false;
+            }
+        } else {
+            if (stored.size() != pixels.size()) return false;
+            pixels.swap(stored);
+        }
+        if (info.flags & FRAME_DELTA) archive_detail::DeltaDecode(pixels.data(), info.width, info.height);
+
+        if (png_detail::Crc32(pixels.data(), pixels.size()) != info.checksum) {
+            std::cerr << "Error: Checksum mismatch in frame: " << info.name << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    FILE* file;
+    std::vector<FrameInfo> frames;
+
+    FrameArchiveReader(const FrameArchiveReader&) = delete;
+    FrameArchiveReader& operator=(const FrameArchiveReader&) = delete;
+};
+
+#endif // FRAME_ARCHIVE_H
@@ -0,0 +1,227 @@
+#ifndef HDR_IO_H
+#define HDR_IO_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// ############################################################################################
+// HDR image output from linear float RGB (interleaved, top row first):
+// - PFM: 32-bit float, little endian, rows stored bottom to top
+// - OpenEXR: uncompressed scanline file with HALF channels B, G, R
+// Both writers scale the values (e.g. by 1 / accumulated frames) while converting rows in
+// parallel, then write the whole image with one call.
+
+// ############################################################################################
+// Scalar float to half conversion, round to nearest even, with denormals, Inf and NaN
+inline uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7FFFFFFF;
+
+    if (absBits >= 0x7F800000) {                    // Inf or NaN
+        return static_cast<uint16_t>(sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 : 0));
+    }
+    if (absBits >= 0x477FF000) {                    // Rounds to a value above the half range
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+    if (absBits < 0x38800000) {                     // Half denormal or zero
+        if (absBits < 0x33000000) return static_cast<uint16_t>(sign);
+        uint32_t mantissa = (absBits & 0x007FFFFF) | 0x00800000;
+        int shift = 126 - static_cast<int>(absBits >> 23);  // 14 to 24
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Normal: rebias the exponent and round the mantissa from 23 to 10 bits
+    uint32_t half = ((absBits - 0x38000000) >> 13);
+    uint32_t rest = absBits & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return static_cast<uint16_t>(sign | half);
+}
+
+// ############################################################################################
+// Convert 'count' floats, multiplied by 'scale', to halves.
+// Uses the F16C conversion instruction (8 values at a time) when the CPU has it.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+__attribute__((target("avx,f16c")))
+inline void FloatToHalfRowF16C(const float* in, uint16_t* out, size_t count, float scale) {
+    const __m256 mul = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(in + i), mul);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+    }
+    for (; i < count; i++) out[i] = FloatToHalf(in[i] * scale);
+}
+#endif
+
+inline void FloatToHalfRow(const float* in, uint16_t* out, size_t count, float scale = 1.0f) {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    static const bool hasF16C = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    if (hasF16C) {
+        FloatToHalfRowF16C(in, out, count, scale);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) out[i] = FloatToHalf(in[i] * scale);
+}
+
+namespace hdr_detail {
+
+inline bool WriteWhole(const std::string& filename, const std::vector<unsigned char>& data) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error: Failed to write image data" << std::endl;
+    }
+    return ok;
+}
+
+// EXR header values are little endian
+inline void PutLE32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+inline void PutAttribute(std::vector<unsigned char>& out, const char* name, const char* type,
+                         const std::vector<unsigned char>& value) {
+    out.insert(out.end(), name, name + strlen(name) + 1);
+    out.insert(out.end(), type, type + strlen(type) + 1);
+    PutLE32(out, static_cast<uint32_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+inline bool IsLittleEndian() {
+    const uint16_t probe = 1;
+    unsigned char first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+} // namespace hdr_detail
+
+// ############################################################################################
+// Write linear RGB floats as a PFM file
+inline bool WritePFM(const std::string& filename, const float* rgb, int width, int height, float scale = 1.0f) {
+    char header[64];
+    // A negative scale marks little-endian data
+    int headerLength = snprintf(header, sizeof(header), "PF\n%d %d\n%s\n", width, height,
+                                hdr_detail::IsLittleEndian() ? "-1.0" : "1.0");
+
+    size_t rowFloats = static_cast<size_t>(width) * 3;
+    std::vector<unsigned char> data(headerLength + rowFloats * height * sizeof(float));
+    memcpy(data.data(), header, headerLength);
+    float* pixels = reinterpret_cast<float*>(&data[headerLength]);
+
+    #pragma omp parallel for
+    for (int y = 0; y < height; y++) {
+        const float* src = rgb + (height - 1 - y) * rowFloats; // PFM stores the bottom row first
+        float* dst = pixels + y * rowFloats;
+        for (size_t i = 0; i < rowFloats; i++) dst[i] = src[i] * scale;
+    }
+
+    return hdr_detail::WriteWhole(filename, data);
+}
+
+// ############################################################################################
+// Write linear RGB floats as an uncompressed half-float OpenEXR file
+inline bool WriteEXR(const std::string& filename, const float* rgb, int width, int height, float scale = 1.0f) {
+    using namespace hdr_detail;
+    std::vector<unsigned char> out;
+
+    // Magic number and version 2 (single part scanline)
+    const unsigned char magic[8] = { 0x76, 0x2F, 0x31, 0x01, 0x02, 0x00, 0x00, 0x00 };
+    out.assign(magic, magic + 8);
+
+    // Channels are listed alphabetically; each is HALF (1), linear, sampled 1x1
+    std::vector<unsigned char> channels;
+    const char* names[3] = { "B", "G", "R" };
+    for (int c = 0; c < 3; c++) {
+        channels.push_back(static_cast<unsigned char>(names[c][0]));
+        channels.push_back(0);
+        PutLE32(channels, 1);   // Pixel type HALF
+        PutLE32(channels, 0);   // pLinear + reserved
+        PutLE32(channels, 1);   // x sampling
+        PutLE32(channels, 1);   // y sampling
+    }
+    channels.push_back(0);
+    PutAttribute(out, "channels", "chlist", channels);
+    PutAttribute(out, "compression", "compression", std::vector<unsigned char>(1, 0));
+
+    std::vector<unsigned char> window;
+    PutLE32(window, 0);
+    PutLE32(window, 0);
+    PutLE32(window, static_cast<uint32_t>(width - 1));
+    PutLE32(window, static_cast<uint32_t>(height - 1));
+    PutAttribute(out, "dataWindow", "box2i", window);
+    PutAttribute(out, "displayWindow", "box2i", window);
+    PutAttribute(out, "lineOrder", "lineOrder", std::vector<unsigned char>(1, 0)); // Increasing Y
+
+    std::vector<unsigned char> value;
+    float one = 1.0f;
+    uint32_t oneBits;
+    memcpy(&oneBits, &one, 4);
+    PutLE32(value, oneBits);
+    PutAttribute(out, "pixelAspectRatio", "float", value);
+    PutAttribute(out, "screenWindowWidth", "float", value);
+    PutAttribute(out, "screenWindowCenter", "v2f", std::vector<unsigned char>(8, 0));
+    out.push_back(0); // End of header
+
+    // Offset table, then one chunk per scanline: y, byte count, B row, G row, R row
+    size_t lineBytes = static_cast<size_t>(width) * 3 * sizeof(uint16_t);
+    size_t chunkBytes = 8 + lineBytes;
+    size_t tableStart = out.size();
+    size_t dataStart = tableStart + static_cast<size_t>(height) * 8;
+    out.resize(dataStart + chunkBytes * height);
+
+    size_t rowFloats = static_cast<size_t>(width) * 3;
+    bool littleEndian = IsLittleEndian();
+    #pragma omp parallel
+    {
+        std::vector<uint16_t> halves(rowFloats);
+        std::vector<uint16_t> planar(rowFloats);
+
+        #pragma omp for
+        for (int y = 0; y < height; y++) {
+            size_t chunk = dataStart + y * chunkBytes;
+            for (int i = 0; i < 8; i++) {
+                out[tableStart + y * 8 + i] = static_cast<unsigned char>(static_cast<uint64_t>(chunk) >> (8 * i));
+            }
+            for (int i = 0; i < 4; i++) {
+                out[chunk + i] = static_cast<unsigned char>(static_cast<uint32_t>(y) >> (8 * i));
+                out[chunk + 4 + i] = static_cast<unsigned char>(static_cast<uint32_t>(lineBytes) >> (8 * i));
+            }
+
+            // Convert interleaved RGB, then regroup into B, G and R planes
+            FloatToHalfRow(rgb + y * rowFloats, halves.data(), rowFloats, scale);
+            for (int x = 0; x < width; x++) {
+                planar[x] = halves[x * 3 + 2];
+                planar[width + x] = halves[x * 3 + 1];
+                planar[2 * width + x] = halves[x * 3];
+            }
+            if (!littleEndian) {
+                for (size_t i = 0; i < rowFloats; i++) planar[i] = static_cast<uint16_t>((planar[i] >> 8) | (planar[i] << 8));
+            }
+            memcpy(&out[chunk + 8], planar.data(), lineBytes);
+        }
+    }
+
+    return WriteWhole(filename, out);
+}
+
+#endif // HDR_IO_H
@@ -0,0 +1,164 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include "mapped_file.h"
+#include "png_io.h"
+#include "hdr_io.h"
+
+// ############################################################################################
+// An RGB image loaded for analysis. 8-bit images keep their bytes; HDR (PFM) images keep
+// linear floats. Both are interleaved RGB with rows stored top to bottom.
+struct Image {
+    int width;
+    int height;
+    bool hdr;
+    std::vector<unsigned char> bytes;   // 8-bit RGB (when !hdr)
+    std::vector<float> pixels;          // Linear RGB (when hdr)
+
+    Image() : width(0), height(0), hdr(false) {}
+
+    // Channel value i as a float, 8-bit values scaled to [0, 1]
+    float value(size_t i) const {
+        return hdr ? pixels[i] : bytes[i] * (1.0f / 255.0f);
+    }
+};
+
+namespace image_io_detail {
+
+// ############################################################################################
+// Read the next header integer of a PNM / PFM header, skipping whitespace and comments
+inline bool ReadHeaderToken(const unsigned char* data, size_t size, size_t& pos, std::string& token) {
+    token.clear();
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') pos++;
+        } else if (isspace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    while (pos < size && !isspace(data[pos])) token += static_cast<char>(data[pos++]);
+    return !token.empty();
+}
+
+} // namespace image_io_detail
+
+// ############################################################################################
+// Load a binary or ASCII PPM (P6 / P3), PNG or PFM file, detected from its contents
+inline bool LoadImage(const std::string& filename, Image& image) {
+    using namespace image_io_detail;
+    MappedFile file;
+    if (!file.openRead(filename, true)) return false;      // Decoded front to back
+    const unsigned char* data = file.data();
+    size_t size = file.size();
+
+    if (size >= 8 && data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G') {
+        image.hdr = false;
+        return DecodePNG(data, size, image.bytes, image.width, image.height);
+    }
+
+    size_t pos = 0;
+    std::string magic, w, h, maxValue;
+    if (!ReadHeaderToken(data, size, pos, magic) || !ReadHeaderToken(data, size, pos, w) ||
+        !ReadHeaderToken(data, size, pos, h) || !ReadHeaderToken(data, size, pos, maxValue)) {
+        std::cerr << "Error: Unrecognized image file: " << filename << std::endl;
+        return false;
+    }
+    image.width = atoi(w.c_str());
+    image.height = atoi(h.c_str());
+    size_t count = static_cast<size_t>(image.width) * image.height * 3;
+    if (image.width <= 0 || image.height <= 0) {
+        std::cerr << "Error: Invalid image size in " << filename << std::endl;
+        return false;
+    }
+
+    if (magic == "P6") {
+        pos++; // Single whitespace byte after the maximum value
+        if (atoi(maxValue.c_str()) != 255 || pos + count > size) {
+            std::cerr << "Error: Unsupported or truncated PPM: " << filename << std::endl;
+            return false;
+        }
+        image.hdr = false;
+        image.bytes.assign(data + pos, data + pos + count);
+        return true;
+    }
+
+    if (magic == "P3") {
+        int maxInput = std::max(atoi(maxValue.c_str()), 1);
+        image.hdr = false;
+        image.bytes.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            int value = 0;
+            while (pos < size && !isdigit(data[pos])) pos++;
+            if (pos >= size) {
+                std::cerr << "Error: Truncated PPM: " << filename << std::endl;
+                return false;
+            }
+            while (pos < size && isdigit(data[pos])) value = value * 10 + (data[pos++] - '0');
+            image.bytes[i] = static_cast<unsigned char>(std::min(value * 255 / maxInput, 255));
+        }
+        return true;
+    }
+
+    if (magic == "PF") {
+        pos++;
+        float endianScale = static_cast<float>(atof(maxValue.c_str()));
+        if (pos + count * sizeof(float) > size) {
+            std::cerr << "Error: Truncated PFM: " << filename << std::endl;
+            return false;
+        }
+        bool swap = (endianScale < 0.0f) != hdr_detail::IsLittleEndian();
+        size_t rowFloats = static_cast<size_t>(image.width) * 3;
+        image.hdr = true;
+        image.pixels.resize(count);
+        #pragma omp parallel for
+        for (int y = 0; y < image.height; y++) {
+            // PFM rows run bottom to top
+            const unsigned char* src = data + pos + (image.height - 1 - y) * rowFloats * sizeof(float);
+            float* dst = &image.pixels[y * rowFloats];
+            memcpy(dst, src, rowFloats * sizeof(float));
+            if (swap) {
+                for (size_t i = 0; i < rowFloats; i++) {
+                    uint32_t bits;
+                    memcpy(&bits, &dst[i], 4);
+                    bits = __builtin_bswap32(bits);
+                    memcpy(&dst[i], &bits, 4);
+                }
+            }
+        }
+        return true;
+    }
+
+    std::cerr << "Error: Unsupported image format '" << magic << "': " << filename << std::endl;
+    return false;
+}
+
+// ############################################################################################
+// Write 8-bit RGB as a binary PPM
+inline bool SavePPM(const std::string& filename, const unsigned char* rgb, int width, int height) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    size_t bytes = static_cast<size_t>(width) * height * 3;
+    bool ok = fwrite(rgb, 1, bytes, file) == bytes;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error: Failed to write image data" << std::endl;
+    }
+    return ok;
+}
+
+#endif // IMAGE_IO_H
@@ -0,0 +1,150 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ############################################################################################
+// A file mapped into memory, either read-only or created with a fixed size for writing.
+// The mapping (and file descriptor) is released when the object is destroyed.
+class MappedFile {
+public:
+    MappedFile() : fd(-1), address(NULL), length(0), writable(false) {}
+    ~MappedFile() { close(); }
+
+    // ############################################################################################
+    // Map an existing file for reading. With 'prefetch', the whole file is faulted in at once
+    // and read ahead sequentially, for readers that scan all of it front to back; otherwise
+    // pages are faulted in on demand (e.g. for random access by BVH traversal).
+    bool openRead(const std::string& path, bool prefetch = false) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Error: Could not open file: " << path << std::endl;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            std::cerr << "Error: Could not stat file: " << path << std::endl;
+            close();
+            return false;
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length == 0) return true;
+
+        int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if (prefetch) flags |= MAP_POPULATE;
+#endif
+        void* mapped = mmap(NULL, length, PROT_READ, flags, fd, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Error: Could not map file: " << path << std::endl;
+            close();
+            return false;
+        }
+        address = static_cast<unsigned char*>(mapped);
+        if (prefetch) madvise(address, length, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    // ############################################################################################
+    // Create (or truncate) a file of exactly 'size' bytes, with its blocks allocated, and map
+    // it for writing. Writes through the mapping go to the page cache and reach the file
+    // without any copy held by the process.
+    bool create(const std::string& path, size_t size) {
+        close();
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cerr << "Error: Could not open file for writing: " << path << std::endl;
+            return false;
+        }
+        // Reserve the blocks up front so a full disk fails here rather than with SIGBUS
+        // while threads write into the mapping. Where fallocate is unsupported the file
+        // would be sparse and carry that risk, so creating it fails as well.
+        int reserved = size > 0 ? posix_fallocate(fd, 0, static_cast<off_t>(size)) : 0;
+        if (reserved != 0) {
+            std::cerr << "Error: Could not reserve " << size << " bytes for: " << path << " ("
+                      << strerror(reserved) << ")" << std::endl;
+            close();
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            std::cerr << "Error: Could not resize file: " << path << std::endl;
+            close();
+            return false;
+        }
+        length = size;
+        writable = true;
+        if (length == 0) return true;
+
+        void* mapped = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Error: Could not map file: " << path << std::endl;
+            close();
+            return false;
+        }
+        address = static_cast<unsigned char*>(mapped);
+        return true;
+    }
+
+    // ############################################################################################
+    // Map 'size' bytes of zeroed anonymous memory for writing, e.g. to build an image in the
+    // same form as a mapped file. The memory is returned to the system when closed.
+    bool allocate(size_t size) {
+        close();
+        length = size;
+        writable = true;
+        if (length == 0) return true;
+        void* mapped = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "Error: Could not allocate " << size << " bytes" << std::endl;
+            length = 0;
+            writable = false;
+            return false;
+        }
+        address = static_cast<unsigned char*>(mapped);
+        return true;
+    }
+
+    // ############################################################################################
+    // Unmap and close. For writable files the data is left to the kernel to flush,
+    // unless sync() was called first.
+    void close() {
+        if (address) munmap(address, length);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        address = NULL;
+        length = 0;
+        writable = false;
+    }
+
+    // ############################################################################################
+    // Flush written pages to the file, returns false on I/O errors
+    bool sync() {
+        if (!address || !writable) return true;
+        return msync(address, length, MS_SYNC) == 0;
+    }
+
+    unsigned char* data() { return address; }
+    const unsigned char* data() const { return address; }
+    size_t size() const { return length; }
+    bool isOpen() const { return fd >= 0 || address != NULL; }
+
+private:
+    int fd;
+    unsigned char* address;
+    size_t length;
+    bool writable;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+#endif // MAPPED_FILE_H
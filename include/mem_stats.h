@@ -0,0 +1,150 @@
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+// ############################################################################################
+// Categories that memory is accounted under
+enum MemCategory {
+    MEM_GEOMETRY = 0,       // Primitives, vertices, indices, lights
+    MEM_ACCELERATION,       // Object lists and any spatial index over them
+    MEM_MATERIALS,          // Material data (currently copied per primitive)
+    MEM_FRAMEBUFFER,        // Pixel buffers
+    MEM_TEMPORARY,          // Scratch data that only lives during loading/processing
+    MEM_CATEGORY_COUNT
+};
+
+inline const char* MemCategoryName(MemCategory category) {
+    static const char* names[MEM_CATEGORY_COUNT] = {
+        "geometry", "acceleration", "materials", "framebuffer", "temporary"
+    };
+    return names[category];
+}
+
+// ############################################################################################
+// Bytes held by a vector's allocation (capacity, not size)
+template <typename T, typename A>
+inline size_t VectorBytes(const std::vector<T, A>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+// ############################################################################################
+// Process-wide memory accounting with per-category high-water marks
+// All counters are atomic so render threads may report without locking
+class MemStats {
+public:
+    static MemStats& Instance() {
+        static MemStats stats;
+        return stats;
+    }
+
+    // ############################################################################################
+    // Record an allocation of 'bytes' in the given category
+    void Add(MemCategory category, size_t bytes) {
+        long long delta = static_cast<long long>(bytes);
+        long long now = current[category].fetch_add(delta) + delta;
+        UpdatePeak(peak[category], now);
+        long long total = currentTotal.fetch_add(delta) + delta;
+        UpdatePeak(peakTotal, total);
+    }
+
+    // ############################################################################################
+    // Record that 'bytes' previously added to the category were freed
+    void Release(MemCategory category, size_t bytes) {
+        long long delta = static_cast<long long>(bytes);
+        current[category].fetch_sub(delta);
+        currentTotal.fetch_sub(delta);
+    }
+
+    size_t Current(MemCategory category) const { return static_cast<size_t>(current[category].load()); }
+    size_t Peak(MemCategory category) const { return static_cast<size_t>(peak[category].load()); }
+    size_t CurrentTotal() const { return static_cast<size_t>(currentTotal.load()); }
+    size_t PeakTotal() const { return static_cast<size_t>(peakTotal.load()); }
+
+    // ############################################################################################
+    // Print a table of current and peak usage per category
+    void Print(std::ostream& out) const {
+        out << "Memory usage (current / peak):" << std::endl;
+        for (int i = 0; i < MEM_CATEGORY_COUNT; i++) {
+            MemCategory category = static_cast<MemCategory>(i);
+            out << "  " << std::left << std::setw(14) << MemCategoryName(category) << std::right
+                << FormatBytes(Current(category)) << " / " << FormatBytes(Peak(category)) << std::endl;
+        }
+        out << "  " << std::left << std::setw(14) << "total" << std::right
+            << FormatBytes(CurrentTotal()) << " / " << FormatBytes(PeakTotal()) << std::endl;
+    }
+
+private:
+    std::atomic<long long> current[MEM_CATEGORY_COUNT];
+    std::atomic<long long> peak[MEM_CATEGORY_COUNT];
+    std::atomic<long long> currentTotal;
+    std::atomic<long long> peakTotal;
+
+    MemStats() : currentTotal(0), peakTotal(0) {
+        for (int i = 0; i < MEM_CATEGORY_COUNT; i++) {
+            current[i] = 0;
+            peak[i] = 0;
+        }
+    }
+
+    MemStats(const MemStats&) = delete;
+    MemStats& operator=(const MemStats&) = delete;
+
+    // ############################################################################################
+    // Raise a high-water mark without losing concurrent updates
+    static void UpdatePeak(std::atomic<long long>& peakValue, long long value) {
+        long long previous = peakValue.load();
+        while (value > previous && !peakValue.compare_exchange_weak(previous, value)) {
+        }
+    }
+
+    static std::string FormatBytes(size_t bytes) {
+        char buffer[32];
+        if (bytes >= (1ull << 30)) snprintf(buffer, sizeof(buffer), "%10.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+        else if (bytes >= (1ull << 20)) snprintf(buffer, sizeof(buffer), "%10.2f MB", bytes / (1024.0 * 1024.0));
+        else snprintf(buffer, sizeof(buffer), "%10.2f KB", bytes / 1024.0);
+        return buffer;
+    }
+};
+
+// ############################################################################################
+// Bytes owned by one component in one category. Resizing the owner's storage is reported
+// with Set(), and whatever is still held is released when the account is destroyed.
+class MemAccount {
+public:
+    explicit MemAccount(MemCategory c) : category(c), bytes(0) {}
+    ~MemAccount() { Set(0); }
+
+    void Add(size_t amount) {
+        bytes += amount;
+        MemStats::Instance().Add(category, amount);
+    }
+
+    void Release(size_t amount) {
+        if (amount > bytes) amount = bytes;
+        bytes -= amount;
+        MemStats::Instance().Release(category, amount);
+    }
+
+    void Set(size_t amount) {
+        if (amount > bytes) Add(amount - bytes);
+        else Release(bytes - amount);
+    }
+
+    size_t Bytes() const { return bytes; }
+
+private:
+    MemCategory category;
+    size_t bytes;
+
+    MemAccount(const MemAccount&) = delete;
+    MemAccount& operator=(const MemAccount&) = delete;
+};
+
+#endif // MEM_STATS_H
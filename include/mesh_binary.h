@@ -0,0 +1,335 @@
+#ifndef MESH_BINARY_H
+#define MESH_BINARY_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include "math_utils.h"
+#include "mapped_file.h"
+#include "mesh_bvh.h"
+
+// ############################################################################################
+// Binary triangle mesh format, loaded by mapping the file and using its arrays in place.
+//
+// Layout (little endian):
+//   MeshBinaryHeader (88 bytes)
+//   vertex block:  vertexCount x float[3]
+//   normal block:  vertexCount x float[3]      (optional, MESH_HAS_NORMALS)
+//   index block:   triangleCount x uint32[3]
+//   BVH block:     bvhNodeCount x BvhNode      (optional, MESH_HAS_BVH; triangles in leaf order)
+// Every block starts at a multiple of MESH_BLOCK_ALIGNMENT bytes.
+
+const uint32_t MESH_BINARY_VERSION = 1;
+const size_t MESH_BLOCK_ALIGNMENT = 64;
+
+enum MeshBinaryFlags {
+    MESH_HAS_NORMALS = 1,
+    MESH_HAS_BVH = 2
+};
+
+struct MeshBinaryHeader {
+    char magic[4];              // "RMSH"
+    uint32_t version;
+    uint32_t flags;
+    uint32_t headerBytes;       // sizeof(MeshBinaryHeader), for later extensions
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    uint32_t bvhNodeCount;
+    uint32_t reserved;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint64_t vertexOffset;      // Byte offsets of the blocks, 0 if absent
+    uint64_t normalOffset;
+    uint64_t indexOffset;
+    uint64_t bvhOffset;
+};
+
+static_assert(sizeof(MeshBinaryHeader) == 88, "MeshBinaryHeader is part of the file format");
+static_assert(sizeof(Vector3f) == 12, "Vector3f must be three packed floats to be used in place");
+
+namespace mesh_binary_detail {
+
+inline bool IsLittleEndian() {
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+}
+
+inline uint64_t Align(uint64_t offset) {
+    return (offset + MESH_BLOCK_ALIGNMENT - 1) / MESH_BLOCK_ALIGNMENT * MESH_BLOCK_ALIGNMENT;
+}
+
+inline bool WriteBlock(FILE* file, uint64_t& position, uint64_t offset, const void* data, size_t bytes) {
+    static const char zeros[MESH_BLOCK_ALIGNMENT] = {};
+    if (fwrite(zeros, 1, offset - position, file) != offset - position) return false;
+    position = offset + bytes;
+    return bytes == 0 || fwrite(data, 1, bytes, file) == bytes;
+}
+
+} // namespace mesh_binary_detail
+
+// ############################################################################################
+// True if the file starts with the binary mesh magic
+inline bool IsMeshBinaryFile(const std::string& filename) {
+    char magic[4] = {};
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) return false;
+    bool match = fread(magic, 1, 4, file) == 4 && memcmp(magic, "RMSH", 4) == 0;
+    fclose(file);
+    return match;
+}
+
+namespace mesh_binary_detail {
+
+// ############################################################################################
+// Fill in the header of a mesh image and place its blocks; returns the image size in bytes
+inline uint64_t LayoutMeshBinary(MeshBinaryHeader& header, const Vector3f* vertices, size_t vertexCount,
+                                 bool hasNormals, size_t triangleCount, size_t bvhNodeCount) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "RMSH", 4);
+    header.version = MESH_BINARY_VERSION;
+    header.flags = (hasNormals ? MESH_HAS_NORMALS : 0) | (bvhNodeCount > 0 ? MESH_HAS_BVH : 0);
+    header.headerBytes = sizeof(MeshBinaryHeader);
+    header.vertexCount = static_cast<uint32_t>(vertexCount);
+    header.triangleCount = static_cast<uint32_t>(triangleCount);
+    header.bvhNodeCount = static_cast<uint32_t>(bvhNodeCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float p[3] = { vertices[i].x, vertices[i].y, vertices[i].z };
+        for (int k = 0; k < 3; k++) {
+            if (i == 0 || p[k] < header.boundsMin[k]) header.boundsMin[k] = p[k];
+            if (i == 0 || p[k] > header.boundsMax[k]) header.boundsMax[k] = p[k];
+        }
+    }
+
+    uint64_t vertexBytes = vertexCount * sizeof(Vector3f);
+    uint64_t offset = Align(sizeof(MeshBinaryHeader));
+    header.vertexOffset = offset;
+    offset = Align(offset + vertexBytes);
+    if (hasNormals) {
+        header.normalOffset = offset;
+        offset = Align(offset + vertexBytes);
+    }
+    header.indexOffset = offset;
+    offset += triangleCount * 3 * sizeof(uint32_t);
+    if (header.bvhNodeCount) {
+        header.bvhOffset = Align(offset);
+        offset = header.bvhOffset + bvhNodeCount * sizeof(BvhNode);
+    }
+    return offset;
+}
+
+} // namespace mesh_binary_detail
+
+// ############################################################################################
+// Write a triangle mesh. 'normals' (one per vertex) and 'bvh' may be NULL. With a BVH, the
+// indices must be in the order BuildMeshBvh left them.
+inline bool WriteMeshBinary(const std::string& filename, const Vector3f* vertices, size_t vertexCount,
+                            const Vector3f* normals, const uint32_t* indices, size_t triangleCount,
+                            const BvhNode* bvh, size_t bvhNodeCount) {
+    using namespace mesh_binary_detail;
+    if (!IsLittleEndian()) {
+        std::cerr << "Error: Binary meshes can only be written on little-endian machines" << std::endl;
+        return false;
+    }
+
+    MeshBinaryHeader header;
+    LayoutMeshBinary(header, vertices, vertexCount, normals != NULL, triangleCount, bvh ? bvhNodeCount : 0);
+    size_t vertexBytes = vertexCount * sizeof(Vector3f);
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+    uint64_t position = 0;
+    bool ok = WriteBlock(file, position, 0, &header, sizeof(header)) &&
+              WriteBlock(file, position, header.vertexOffset, vertices, vertexBytes) &&
+              (!normals || WriteBlock(file, position, header.normalOffset, normals, vertexBytes)) &&
+              WriteBlock(file, position, header.indexOffset, indices, triangleCount * 3 * sizeof(uint32_t)) &&
+              (!header.bvhNodeCount || WriteBlock(file, position, header.bvhOffset, bvh, header.bvhNodeCount * sizeof(BvhNode)));
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error: Failed to write mesh data: " << filename << std::endl;
+    }
+    return ok;
+}
+
+// ############################################################################################
+// A binary mesh mapped read-only. The arrays point into the mapping and stay valid while the
+// object lives; opening checks the header and block layout, validate() the contents.
+// The mesh is either a file of its own or an image embedded in a larger mapped file (e.g. a
+// compiled scene), which it then shares.
+class MeshBinary {
+public:
+    MeshBinary() : base(0), length(0), header(NULL) {}
+
+    bool open(const std::string& filename) {
+        header = NULL;
+        std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>();
+        if (!mapping->openRead(filename)) return false;
+        return openEmbedded(mapping, 0, mapping->size(), filename);
+    }
+
+    // ############################################################################################
+    // Use the mesh image at [offset, offset + bytes) of an existing mapping, which must
+    // start at a multiple of MESH_BLOCK_ALIGNMENT
+    bool openEmbedded(std::shared_ptr<const MappedFile> mapping, size_t offset, size_t bytes, const std::string& name) {
+        using namespace mesh_binary_detail;
+        header = NULL;
+        file = mapping;
+        base = offset;
+        length = bytes;
+        if (!IsLittleEndian()) {
+            std::cerr << "Error: Binary meshes can only be used on little-endian machines" << std::endl;
+            return false;
+        }
+        if (offset > file->size() || bytes > file->size() - offset || offset % MESH_BLOCK_ALIGNMENT != 0) {
+            std::cerr << "Error: Binary mesh outside its file: " << name << std::endl;
+            return false;
+        }
+        const MeshBinaryHeader* h = reinterpret_cast<const MeshBinaryHeader*>(file->data() + base);
+        if (length < sizeof(MeshBinaryHeader) || memcmp(h->magic, "RMSH", 4) != 0) {
+            std::cerr << "Error: Not a binary mesh: " << name << std::endl;
+            return false;
+        }
+        if (h->version != MESH_BINARY_VERSION || h->headerBytes < sizeof(MeshBinaryHeader)) {
+            std::cerr << "Error: Unsupported binary mesh version " << h->version << ": " << name << std::endl;
+            return false;
+        }
+
+        uint64_t vertexBytes = static_cast<uint64_t>(h->vertexCount) * sizeof(Vector3f);
+        bool ok = blockFits(h->vertexOffset, vertexBytes) &&
+                  blockFits(h->indexOffset, static_cast<uint64_t>(h->triangleCount) * 3 * sizeof(uint32_t)) &&
+                  (!(h->flags & MESH_HAS_NORMALS) || blockFits(h->normalOffset, vertexBytes)) &&
+                  (!(h->flags & MESH_HAS_BVH) ||
+                   (h->bvhNodeCount > 0 && blockFits(h->bvhOffset, static_cast<uint64_t>(h->bvhNodeCount) * sizeof(BvhNode))));
+        if (!ok) {
+            std::cerr << "Error: Truncated or corrupt binary mesh: " << name << std::endl;
+            return false;
+        }
+        header = h;
+        return true;
+    }
+
+    // ############################################################################################
+    // Check that every index references an existing vertex (one parallel pass) and that the
+    // BVH is a tree the tracer can walk
+    bool validate() const {
+        if (!header) return false;
+        const uint32_t* index = indices();
+        size_t count = static_cast<size_t>(triangleCount()) * 3;
+        uint32_t vertices = vertexCount();
+        long long bad = 0;
+        #pragma omp parallel for reduction(+:bad)
+        for (long long i = 0; i < static_cast<long long>(count); i++) bad += index[i] >= vertices;
+        if (bad > 0) {
+            std::cerr << "Error: Binary mesh has out-of-range indices" << std::endl;
+            return false;
+        }
+        return validateBvh();
+    }
+
+    bool isOpen() const { return header != NULL; }
+    uint32_t vertexCount() const { return header->vertexCount; }
+    uint32_t triangleCount() const { return header->triangleCount; }
+    uint32_t bvhNodeCount() const { return header->bvhNodeCount; }
+    size_t fileBytes() const { return length; }
+
+    // The whole mesh image, header included, e.g. to embed it in another file
+    const unsigned char* image() const { return file->data() + base; }
+
+    const Vector3f* vertices() const { return block<Vector3f>(header->vertexOffset); }
+    const Vector3f* normals() const { return (header->flags & MESH_HAS_NORMALS) ? block<Vector3f>(header->normalOffset) : NULL; }
+    const uint32_t* indices() const { return block<uint32_t>(header->indexOffset); }
+    const BvhNode* bvh() const { return (header->flags & MESH_HAS_BVH) ? block<BvhNode>(header->bvhOffset) : NULL; }
+
+    Vector3f boundsMin() const { return Vector3f(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]); }
+    Vector3f boundsMax() const { return Vector3f(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]); }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    size_t base;                // Start of the mesh image in the mapping
+    size_t length;              // Size of the mesh image
+    const MeshBinaryHeader* header;
+
+    // ############################################################################################
+    // Walk the BVH from the root: every node in range, children after their parent (so the
+    // walk ends) and no path deeper than MAX_BVH_DEPTH, which the tracer's stack is sized for
+    bool validateBvh() const {
+        const BvhNode* nodes = bvh();
+        if (!nodes) return true;
+        uint32_t nodeCount = bvhNodeCount();
+        std::vector<uint8_t> visited(nodeCount, 0);
+        std::vector<std::pair<uint32_t, uint32_t> > stack(1, std::make_pair(0u, 0u));
+        while (!stack.empty()) {
+            uint32_t n = stack.back().first, depth = stack.back().second;
+            stack.pop_back();
+            if (visited[n]) {
+                std::cerr << "Error: Binary mesh BVH node " << n << " has several parents" << std::endl;
+                return false;
+            }
+            visited[n] = 1;
+            const BvhNode& node = nodes[n];
+            bool leaf = node.count > 0;
+            uint64_t end = static_cast<uint64_t>(node.first) + (leaf ? node.count : 2);
+            if (leaf ? end > triangleCount() : (node.first <= n || end > nodeCount)) {
+                std::cerr << "Error: Binary mesh has out-of-range BVH nodes" << std::endl;
+                return false;
+            }
+            if (leaf) continue;
+            if (depth + 1 > MAX_BVH_DEPTH) {
+                std::cerr << "Error: Binary mesh BVH is deeper than " << MAX_BVH_DEPTH << " levels" << std::endl;
+                return false;
+            }
+            stack.push_back(std::make_pair(node.first, depth + 1));
+            stack.push_back(std::make_pair(node.first + 1, depth + 1));
+        }
+        return true;
+    }
+
+    bool blockFits(uint64_t offset, uint64_t bytes) const {
+        return offset >= sizeof(MeshBinaryHeader) && offset % MESH_BLOCK_ALIGNMENT == 0 &&
+               offset <= length && bytes <= length - offset;
+    }
+
+    template <typename T>
+    const T* block(uint64_t offset) const {
+        return reinterpret_cast<const T*>(file->data() + base + offset);
+    }
+
+    MeshBinary(const MeshBinary&) = delete;
+    MeshBinary& operator=(const MeshBinary&) = delete;
+};
+
+// ############################################################################################
+// Build a mesh image in memory, with the same layout as WriteMeshBinary, and open it. Used
+// for meshes loaded from other formats so they are traced and shared like mapped ones.
+// Returns NULL if the memory could not be allocated.
+inline std::shared_ptr<MeshBinary> BuildMeshBinary(const Vector3f* vertices, size_t vertexCount,
+                                                   const Vector3f* normals, const uint32_t* indices,
+                                                   size_t triangleCount, const BvhNode* bvh, size_t bvhNodeCount,
+                                                   const std::string& name) {
+    using namespace mesh_binary_detail;
+    MeshBinaryHeader header;
+    uint64_t bytes = LayoutMeshBinary(header, vertices, vertexCount, normals != NULL, triangleCount,
+                                      bvh ? bvhNodeCount : 0);
+    std::shared_ptr<MappedFile> memory = std::make_shared<MappedFile>();
+    if (!memory->allocate(static_cast<size_t>(bytes))) return std::shared_ptr<MeshBinary>();
+
+    unsigned char* image = memory->data();
+    size_t vertexBytes = vertexCount * sizeof(Vector3f);
+    memcpy(image, &header, sizeof(header));
+    if (vertexBytes) memcpy(image + header.vertexOffset, vertices, vertexBytes);
+    if (normals && vertexBytes) memcpy(image + header.normalOffset, normals, vertexBytes);
+    if (triangleCount) memcpy(image + header.indexOffset, indices, triangleCount * 3 * sizeof(uint32_t));
+    if (header.bvhNodeCount) memcpy(image + header.bvhOffset, bvh, header.bvhNodeCount * sizeof(BvhNode));
+
+    std::shared_ptr<MeshBinary> mesh = std::make_shared<MeshBinary>();
+    if (!mesh->openEmbedded(memory, 0, memory->size(), name)) return std::shared_ptr<MeshBinary>();
+    return mesh;
+}
+
+#endif // MESH_BINARY_H
@@ -0,0 +1,191 @@
+#ifndef MESH_BVH_H
+#define MESH_BVH_H
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "math_utils.h"
+
+// ############################################################################################
+// Bounding volume hierarchy over the triangles of one mesh, stored as a flat node array
+// that can be written to and used straight from a file. The children of an interior node
+// are adjacent (left = first, right = first + 1) and the triangles of a leaf are
+// contiguous in the mesh's index array, which the builder reorders accordingly.
+struct BvhNode {
+    float lo[3];
+    uint32_t first;     // Leaf: first triangle; interior: index of the left child
+    float hi[3];
+    uint32_t count;     // Triangles in a leaf, 0 for interior nodes
+};
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode is part of the binary mesh format");
+
+namespace mesh_bvh_detail {
+
+struct Bounds {
+    Vector3f lo, hi;
+
+    Bounds() : lo(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()),
+               hi(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()) {}
+
+    void grow(const Vector3f& p) {
+        lo = Vector3f(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+        hi = Vector3f(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+    }
+
+    void grow(const Bounds& b) {
+        grow(b.lo);
+        grow(b.hi);
+    }
+
+    float area() const {
+        Vector3f d = hi - lo;
+        return d.x < 0.0f ? 0.0f : 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+inline float Axis(const Vector3f& v, int axis) {
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+struct Task {
+    uint32_t node, begin, end, depth;
+};
+
+// Below this depth only median splits are made, which bounds the tree depth (and the
+// traversal stack) at MAX_SAH_DEPTH + 32
+const uint32_t MAX_SAH_DEPTH = 64;
+
+} // namespace mesh_bvh_detail
+
+// Deepest node level BuildMeshBvh produces (the root is level 0); traversal stacks are sized
+// for it and MeshBinary::validate rejects deeper trees
+const uint32_t MAX_BVH_DEPTH = mesh_bvh_detail::MAX_SAH_DEPTH + 32;
+
+// ############################################################################################
+// Build a BVH over 'triangleCount' triangles (3 indices each) with a binned surface area
+// heuristic. 'indices' is reordered so each leaf covers a contiguous range of triangles.
+inline void BuildMeshBvh(const Vector3f* vertices, uint32_t* indices, size_t triangleCount,
+                         std::vector<BvhNode>& nodes, unsigned maxLeafSize = 4) {
+    using namespace mesh_bvh_detail;
+    const int BINS = 12;
+    nodes.clear();
+    if (triangleCount == 0) return;
+
+    // Per triangle bounds and centroids, in the order the triangles are partitioned
+    std::vector<uint32_t> order(triangleCount);
+    std::vector<Bounds> triBounds(triangleCount);
+    std::vector<Vector3f> centroids(triangleCount);
+    #pragma omp parallel for
+    for (long long t = 0; t < static_cast<long long>(triangleCount); t++) {
+        order[t] = static_cast<uint32_t>(t);
+        for (int k = 0; k < 3; k++) triBounds[t].grow(vertices[indices[t * 3 + k]]);
+        centroids[t] = (triBounds[t].lo + triBounds[t].hi) * 0.5f;
+    }
+
+    nodes.reserve(2 * triangleCount / std::max(maxLeafSize / 2, 1u) + 1);
+    nodes.push_back(BvhNode());
+    std::vector<Task> stack(1, Task{0, 0, static_cast<uint32_t>(triangleCount), 0});
+    while (!stack.empty()) {
+        Task task = stack.back();
+        stack.pop_back();
+
+        Bounds bounds, centroidBounds;
+        for (uint32_t i = task.begin; i < task.end; i++) {
+            bounds.grow(triBounds[order[i]]);
+            centroidBounds.grow(centroids[order[i]]);
+        }
+        BvhNode& node = nodes[task.node];
+        node.lo[0] = bounds.lo.x; node.lo[1] = bounds.lo.y; node.lo[2] = bounds.lo.z;
+        node.hi[0] = bounds.hi.x; node.hi[1] = bounds.hi.y; node.hi[2] = bounds.hi.z;
+        uint32_t count = task.end - task.begin;
+
+        // Find the cheapest split plane among the bin boundaries of every axis,
+        // binning the triangles for all three axes in one pass
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = count * bounds.area();   // Cost of keeping a leaf
+        if (count > 1 && task.depth < MAX_SAH_DEPTH) {
+            Bounds binBounds[3][BINS];
+            uint32_t binCount[3][BINS] = {};
+            float binLo[3], binScale[3];
+            for (int axis = 0; axis < 3; axis++) {
+                binLo[axis] = Axis(centroidBounds.lo, axis);
+                float extent = Axis(centroidBounds.hi, axis) - binLo[axis];
+                binScale[axis] = extent > 0.0f ? BINS / extent : 0.0f;
+            }
+            for (uint32_t i = task.begin; i < task.end; i++) {
+                const Vector3f& c = centroids[order[i]];
+                for (int axis = 0; axis < 3; axis++) {
+                    int b = std::min(static_cast<int>((Axis(c, axis) - binLo[axis]) * binScale[axis]), BINS - 1);
+                    binBounds[axis][b].grow(triBounds[order[i]]);
+                    binCount[axis][b]++;
+                }
+            }
+            for (int axis = 0; axis < 3; axis++) {
+                if (binScale[axis] == 0.0f) continue;
+                float rightArea[BINS];
+                uint32_t rightCount[BINS];
+                Bounds right;
+                uint32_t n = 0;
+                for (int b = BINS - 1; b > 0; b--) {
+                    right.grow(binBounds[axis][b]);
+                    n += binCount[axis][b];
+                    rightArea[b] = right.area();
+                    rightCount[b] = n;
+                }
+                Bounds left;
+                n = 0;
+                for (int b = 0; b < BINS - 1; b++) {
+                    left.grow(binBounds[axis][b]);
+                    n += binCount[axis][b];
+                    float cost = n * left.area() + rightCount[b + 1] * rightArea[b + 1];
+                    if (n > 0 && rightCount[b + 1] > 0 && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b + 1;
+                    }
+                }
+            }
+        }
+
+        // Split in the middle when the leaf would be too large but no plane was chosen
+        uint32_t middle;
+        if (bestAxis >= 0) {
+            float lo = Axis(centroidBounds.lo, bestAxis);
+            float scale = BINS / (Axis(centroidBounds.hi, bestAxis) - lo);
+            middle = static_cast<uint32_t>(std::partition(order.begin() + task.begin, order.begin() + task.end,
+                [&](uint32_t t) {
+                    return std::min(static_cast<int>((Axis(centroids[t], bestAxis) - lo) * scale), BINS - 1) < bestSplit;
+                }) - order.begin());
+        } else if (count > maxLeafSize) {
+            Vector3f extent = centroidBounds.hi - centroidBounds.lo;
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+            middle = task.begin + count / 2;
+            std::nth_element(order.begin() + task.begin, order.begin() + middle, order.begin() + task.end,
+                [&](uint32_t a, uint32_t b) { return Axis(centroids[a], axis) < Axis(centroids[b], axis); });
+        } else {
+            node.first = task.begin;
+            node.count = count;
+            continue;
+        }
+
+        uint32_t left = static_cast<uint32_t>(nodes.size());
+        nodes[task.node].first = left;
+        nodes[task.node].count = 0;
+        nodes.push_back(BvhNode());
+        nodes.push_back(BvhNode());
+        stack.push_back(Task{left, task.begin, middle, task.depth + 1});
+        stack.push_back(Task{left + 1, middle, task.end, task.depth + 1});
+    }
+
+    // Reorder the triangles to match the leaves
+    std::vector<uint32_t> sorted(triangleCount * 3);
+    #pragma omp parallel for
+    for (long long i = 0; i < static_cast<long long>(triangleCount); i++) {
+        for (int k = 0; k < 3; k++) sorted[i * 3 + k] = indices[order[i] * 3 + k];
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+#endif // MESH_BVH_H
@@ -0,0 +1,164 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <sys/stat.h>
+#include "mesh_binary.h"
+#include "mesh_bvh.h"
+#include "mesh_weld.h"
+#include "mesh_optimize.h"
+#include "off_mesh.h"
+#include "mem_stats.h"
+
+// ############################################################################################
+// How a mesh was obtained from the cache
+struct MeshCacheLookup {
+    bool hit = false;               // Shared from an earlier load
+    bool mapped = false;            // A binary mesh file, mapped in place
+    OffLoadStats offStats;          // OFF parse statistics (misses only)
+    WeldStats weld;                 // Duplicate vertex removal of OFF files (misses only)
+    double bvhSeconds = 0.0;        // BVH build of OFF files (misses only)
+    MeshOptimizeStats order;        // Vertex reordering of OFF files (misses only)
+    double seconds = 0.0;           // Whole lookup, including triangulation and BVH build
+};
+
+// ############################################################################################
+// Process-wide cache of immutable triangle meshes, keyed by path and modification time.
+// Every scene object referencing the same file shares one MeshBinary (vertices, triangle
+// indices and BVH); the position, scale and material stay per object (TriangleMesh), so
+// repeated references cost one small object each. Binary meshes are mapped; OFF files are
+// parsed, fan triangulated, welded and given a BVH once, in an in-memory image of the same
+// layout with the vertices in the order the BVH leaves first use them.
+// A file that changed on disk (different mtime or size) is loaded again.
+class MeshCache {
+public:
+    static MeshCache& Instance() {
+        static MeshCache cache;
+        return cache;
+    }
+
+    // ############################################################################################
+    // The mesh for 'path', loading it on the first request; NULL if it cannot be read
+    std::shared_ptr<const MeshBinary> acquire(const std::string& path, MeshCacheLookup* lookup = NULL) {
+        auto start = std::chrono::high_resolution_clock::now();
+        MeshCacheLookup local;
+        MeshCacheLookup& result = lookup ? *lookup : local;
+        result = MeshCacheLookup();
+
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            std::cerr << "Error: Could not open mesh file: " << path << std::endl;
+            return std::shared_ptr<const MeshBinary>();
+        }
+        Key key(info);
+
+        // Loading happens under the lock, so concurrent requests for a file parse it once
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, Entry>::iterator found = entries.find(path);
+        if (found != entries.end() && found->second.key == key) {
+            hits++;
+            result.hit = true;
+            result.mapped = found->second.mapped;
+            result.seconds = secondsSince(start);
+            return found->second.mesh;
+        }
+
+        std::shared_ptr<const MeshBinary> mesh = IsMeshBinaryFile(path) ? mapBinary(path, result)
+                                                                        : loadOff(path, result);
+        if (!mesh) return mesh;
+        Entry& entry = entries[path];
+        entry.key = key;
+        entry.mesh = mesh;
+        entry.mapped = result.mapped;
+        entry.memory.reset(new MemAccount(MEM_GEOMETRY));
+        if (!entry.mapped) entry.memory->Set(mesh->fileBytes());
+        result.seconds = secondsSince(start);
+        return mesh;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+    size_t hitCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hits;
+    }
+
+private:
+    // ############################################################################################
+    // Identity of a file's contents as far as stat can tell
+    struct Key {
+        long long seconds = 0;
+        long long nanoseconds = 0;
+        long long bytes = -1;
+
+        Key() {}
+        explicit Key(const struct stat& info)
+            : seconds(info.st_mtim.tv_sec), nanoseconds(info.st_mtim.tv_nsec), bytes(info.st_size) {}
+
+        bool operator==(const Key& other) const {
+            return seconds == other.seconds && nanoseconds == other.nanoseconds && bytes == other.bytes;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<const MeshBinary> mesh;
+        bool mapped = false;
+        std::shared_ptr<MemAccount> memory;     // In-memory images count as geometry
+    };
+
+    mutable std::mutex mutex;
+    std::map<std::string, Entry> entries;
+    size_t hits = 0;
+
+    // MemStats must outlive the cache, whose entries release their bytes on destruction
+    MeshCache() { MemStats::Instance(); }
+
+    static double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    std::shared_ptr<const MeshBinary> mapBinary(const std::string& path, MeshCacheLookup& result) {
+        std::shared_ptr<MeshBinary> mesh = std::make_shared<MeshBinary>();
+        if (!mesh->open(path) || !mesh->validate()) return std::shared_ptr<const MeshBinary>();
+        result.mapped = true;
+        return mesh;
+    }
+
+    // ############################################################################################
+    // Parse an OFF file, fan triangulate its faces, weld exact duplicate vertices (exports
+    // that repeat every face's corners shrink to the shared ones) and build the BVH
+    std::shared_ptr<const MeshBinary> loadOff(const std::string& path, MeshCacheLookup& result) {
+        OffMesh off;
+        if (!LoadOFF(path, off, &result.offStats)) return std::shared_ptr<const MeshBinary>();
+
+        std::vector<uint32_t> indices;
+        off.triangulate(indices);
+        result.weld = WeldVertices(off.vertices, indices, 0.0f);
+        MemAccount scratchMem(MEM_TEMPORARY);
+        scratchMem.Set(VectorBytes(indices));
+
+        std::vector<BvhNode> bvh;
+        auto bvhStart = std::chrono::high_resolution_clock::now();
+        BuildMeshBvh(off.vertices.data(), indices.data(), indices.size() / 3, bvh);
+        result.bvhSeconds = secondsSince(bvhStart);
+        // The BVH fixed the triangle order; numbering the vertices in that order makes the
+        // triangles of a leaf (and of neighbouring leaves) read nearby vertices
+        result.order = OptimizeMeshOrder(off.vertices, indices, NULL, false);
+        return BuildMeshBinary(off.vertices.data(), off.vertices.size(), NULL, indices.data(), indices.size() / 3,
+                               bvh.data(), bvh.size(), path);
+    }
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+};
+
+#endif // MESH_CACHE_H
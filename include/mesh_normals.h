@@ -0,0 +1,215 @@
+#ifndef MESH_NORMALS_H
+#define MESH_NORMALS_H
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "math_utils.h"
+#include "mem_stats.h"
+#include "chunked_scatter.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ############################################################################################
+// How the normals of the faces around a vertex are combined into its vertex normal
+enum NormalWeighting {
+    NORMAL_WEIGHT_UNIFORM,  // Every adjacent face counts the same (sum of unit face normals)
+    NORMAL_WEIGHT_AREA,     // Faces count by their area, so slivers barely contribute
+    NORMAL_WEIGHT_ANGLE     // Faces count by their corner angle at the vertex, independent of tessellation
+};
+
+// ############################################################################################
+// Parse "uniform", "area" or "angle"
+inline bool ParseNormalWeighting(const std::string& name, NormalWeighting& weighting) {
+    if (name == "uniform") weighting = NORMAL_WEIGHT_UNIFORM;
+    else if (name == "area") weighting = NORMAL_WEIGHT_AREA;
+    else if (name == "angle") weighting = NORMAL_WEIGHT_ANGLE;
+    else return false;
+    return true;
+}
+
+// ############################################################################################
+// Unit normal of a counter-clockwise triangle; zero for degenerate triangles
+inline Vector3f FaceNormal(const Vector3f& v0, const Vector3f& v1, const Vector3f& v2) {
+    Vector3f normal = (v1 - v0).Cross(v2 - v0);
+    if (normal.length() > 0.0f) normal.Normalize();
+    else normal = Vector3f(0.0f, 0.0f, 0.0f);
+    return normal;
+}
+
+namespace mesh_normals_detail {
+
+// ############################################################################################
+// Interior angle of the triangle at corner p, between the edges to a and b
+inline float CornerAngle(const Vector3f& p, const Vector3f& a, const Vector3f& b) {
+    Vector3f e1 = a - p, e2 = b - p;
+    float lengths = e1.length() * e2.length();
+    if (!(lengths > 0.0f)) return 0.0f;
+    float cosine = std::max(-1.0f, std::min(1.0f, e1.Dot(e2) / lengths));
+    return acosf(cosine);
+}
+
+const unsigned VERTEX_BLOCK_BITS = 16;      // 64K vertices (768 KB of normals) per block
+
+// ############################################################################################
+// Group the corners (triangle * 3 + k) by the block of vertices they use, keeping triangle
+// order within every block (ChunkedScatter over whole triangles, one key per block).
+// Block b's corners are corners[blockStart[b]] up to corners[blockStart[b + 1]].
+inline void BucketCornersByBlock(const uint32_t* indices, size_t cornerCount, size_t blockCount, int chunks,
+                                 std::vector<size_t>& blockStart, std::vector<uint32_t>& corners) {
+    corners.resize(cornerCount);
+    uint32_t* out = corners.data();
+    ChunkedScatter(cornerCount, blockCount, chunks, 3,
+        [=](size_t first, size_t last, size_t* count) {
+            // Neighbouring corners mostly share a block, so count runs rather than single corners
+            const uint32_t* index = indices + first;
+            const uint32_t* end = indices + last;
+            while (index < end) {
+                uint32_t block = *index >> VERTEX_BLOCK_BITS;
+                const uint32_t* run = index;
+                while (++index < end && (*index >> VERTEX_BLOCK_BITS) == block) {}
+                count[block] += index - run;
+            }
+        },
+        [=](size_t first, size_t last, size_t* next) {
+            uint32_t i = static_cast<uint32_t>(first);
+            uint32_t end = static_cast<uint32_t>(last);
+            while (i < end) {
+                uint32_t block = indices[i] >> VERTEX_BLOCK_BITS;
+                uint32_t* slot = out + next[block];
+                do {
+                    *slot++ = i++;
+                } while (i < end && (indices[i] >> VERTEX_BLOCK_BITS) == block);
+                next[block] = slot - out;
+            }
+        },
+        &blockStart);
+}
+
+// ############################################################################################
+// The contribution of triangle 'tri' to the normal of its corner c. The weighting is a
+// template argument so the per-corner loops compile without a branch on it.
+template <NormalWeighting weighting>
+inline Vector3f CornerNormal(const Vector3f* vertices, const uint32_t* tri, int c, const Vector3f& unitNormal) {
+    switch (weighting) {
+        case NORMAL_WEIGHT_AREA:
+            // The cross product's length is twice the triangle's area
+            return (vertices[tri[1]] - vertices[tri[0]]).Cross(vertices[tri[2]] - vertices[tri[0]]);
+        case NORMAL_WEIGHT_ANGLE:
+            return unitNormal * CornerAngle(vertices[tri[c]], vertices[tri[(c + 1) % 3]], vertices[tri[(c + 2) % 3]]);
+        default:
+            return unitNormal;
+    }
+}
+
+// ############################################################################################
+// Add every triangle's contribution to its three vertices, in triangle order. The unit face
+// normals are stored if 'faceNormals' is not NULL.
+template <NormalWeighting weighting>
+inline void ScatterFaces(const Vector3f* vertices, const uint32_t* indices, size_t triangleCount, Vector3f* normals,
+                         Vector3f* faceNormals) {
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = indices + t * 3;
+        Vector3f unit = FaceNormal(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]]);
+        if (faceNormals) faceNormals[t] = unit;
+        for (int c = 0; c < 3; c++) normals[tri[c]] += CornerNormal<weighting>(vertices, tri, c, unit);
+    }
+}
+
+// ############################################################################################
+// Add the contributions of the corners [first, last) (bucketed by BucketCornersByBlock)
+template <NormalWeighting weighting>
+inline void GatherCorners(const Vector3f* vertices, const uint32_t* indices, const uint32_t* first,
+                          const uint32_t* last, const Vector3f* faceNormals, Vector3f* normals) {
+    for (; first < last; first++) {
+        uint32_t corner = *first, t = corner / 3;
+        normals[indices[corner]] += CornerNormal<weighting>(vertices, indices + static_cast<size_t>(t) * 3,
+                                                            static_cast<int>(corner % 3), faceNormals[t]);
+    }
+}
+
+inline void NormalizeRange(Vector3f* normals, size_t first, size_t last) {
+    for (size_t v = first; v < last; v++) {
+        if (normals[v].length() > 0.0f) normals[v].Normalize();
+    }
+}
+
+} // namespace mesh_normals_detail
+
+// ############################################################################################
+// Unit normals of all triangles (3 indices each), in parallel
+inline void ComputeFaceNormals(const Vector3f* vertices, const uint32_t* indices, size_t triangleCount,
+                               std::vector<Vector3f>& faceNormals) {
+    faceNormals.resize(triangleCount);
+    #pragma omp parallel for
+    for (long long t = 0; t < static_cast<long long>(triangleCount); t++) {
+        const uint32_t* tri = indices + t * 3;
+        faceNormals[t] = FaceNormal(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]]);
+    }
+}
+
+// ############################################################################################
+// Smooth vertex normals for a triangle mesh. With several threads this runs without locks
+// or atomics: face normals in one parallel pass, then the corners are bucketed by blocks of
+// 64K vertices and each block is accumulated by a single thread, so no two threads ever
+// write the same normal and every block's normals stay in cache. A single thread (or a
+// mesh of one block) scatters the faces directly instead, which needs no scratch memory.
+// Either way faces are summed in triangle order, so the result does not depend on the
+// thread count and, with uniform weighting, equals the viewer's original serial loop.
+// Vertices without faces get a zero normal. The unit face normals are returned too if
+// 'faceNormals' is given.
+inline void ComputeVertexNormals(const Vector3f* vertices, size_t vertexCount, const uint32_t* indices,
+                                 size_t triangleCount, std::vector<Vector3f>& normals,
+                                 NormalWeighting weighting = NORMAL_WEIGHT_UNIFORM,
+                                 std::vector<Vector3f>* faceNormals = NULL) {
+    using namespace mesh_normals_detail;
+    size_t cornerCount = triangleCount * 3;
+    size_t blockCount = (vertexCount + (size_t(1) << VERTEX_BLOCK_BITS) - 1) >> VERTEX_BLOCK_BITS;
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    normals.assign(vertexCount, Vector3f(0.0f, 0.0f, 0.0f));
+    Vector3f* out = normals.data();
+
+    if (threads == 1 || blockCount <= 1) {
+        if (faceNormals) faceNormals->resize(triangleCount);
+        Vector3f* unit = faceNormals ? faceNormals->data() : NULL;
+        switch (weighting) {
+            case NORMAL_WEIGHT_UNIFORM: ScatterFaces<NORMAL_WEIGHT_UNIFORM>(vertices, indices, triangleCount, out, unit); break;
+            case NORMAL_WEIGHT_AREA:    ScatterFaces<NORMAL_WEIGHT_AREA>(vertices, indices, triangleCount, out, unit); break;
+            case NORMAL_WEIGHT_ANGLE:   ScatterFaces<NORMAL_WEIGHT_ANGLE>(vertices, indices, triangleCount, out, unit); break;
+        }
+        NormalizeRange(out, 0, vertexCount);
+        return;
+    }
+
+    std::vector<Vector3f> localFaceNormals;
+    std::vector<Vector3f>& unitNormals = faceNormals ? *faceNormals : localFaceNormals;
+    ComputeFaceNormals(vertices, indices, triangleCount, unitNormals);
+    std::vector<size_t> blockStart;
+    std::vector<uint32_t> corners;
+    BucketCornersByBlock(indices, cornerCount, blockCount, threads, blockStart, corners);
+    MemAccount scratchMem(MEM_TEMPORARY);
+    scratchMem.Set(VectorBytes(corners) + VectorBytes(blockStart) + VectorBytes(localFaceNormals));
+
+    const Vector3f* unit = unitNormals.data();
+    const uint32_t* bucketed = corners.data();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long long b = 0; b < static_cast<long long>(blockCount); b++) {
+        const uint32_t* first = bucketed + blockStart[b];
+        const uint32_t* last = bucketed + blockStart[b + 1];
+        switch (weighting) {
+            case NORMAL_WEIGHT_UNIFORM: GatherCorners<NORMAL_WEIGHT_UNIFORM>(vertices, indices, first, last, unit, out); break;
+            case NORMAL_WEIGHT_AREA:    GatherCorners<NORMAL_WEIGHT_AREA>(vertices, indices, first, last, unit, out); break;
+            case NORMAL_WEIGHT_ANGLE:   GatherCorners<NORMAL_WEIGHT_ANGLE>(vertices, indices, first, last, unit, out); break;
+        }
+        size_t begin = static_cast<size_t>(b) << VERTEX_BLOCK_BITS;
+        NormalizeRange(out, begin, std::min(vertexCount, begin + (size_t(1) << VERTEX_BLOCK_BITS)));
+    }
+}
+
+#endif // MESH_NORMALS_H
@@ -0,0 +1,185 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "math_utils.h"
+#include "mem_stats.h"
+
+// Entries of the simulated post-transform vertex cache (FIFO), as on most GPUs
+const unsigned VERTEX_CACHE_SIZE = 16;
+
+// ############################################################################################
+// Result of reordering a mesh for the vertex cache and vertex fetch
+struct MeshOptimizeStats {
+    bool trianglesReordered = false;
+    double acmrBefore = 0.0;    // Average cache misses per triangle before the pass (0.5 at best, 3 at worst),
+    double acmrAfter = 0.0;     // measured only if the triangles were reordered
+    double seconds = 0.0;
+};
+
+// ############################################################################################
+// Average cache miss ratio: transformed vertices per triangle with a FIFO cache of
+// 'cacheSize' entries. A vertex is in the cache if fewer than 'cacheSize' misses happened
+// since it was last loaded, so no cache needs to be modelled.
+inline double ComputeACMR(const uint32_t* indices, size_t triangleCount, size_t vertexCount,
+                          unsigned cacheSize = VERTEX_CACHE_SIZE) {
+    if (triangleCount == 0) return 0.0;
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t c = 0; c < triangleCount * 3; c++) {
+        uint32_t v = indices[c];
+        if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize) loadedAt[v] = ++misses;
+    }
+    return static_cast<double>(misses) / triangleCount;
+}
+
+namespace mesh_optimize_detail {
+
+// ############################################################################################
+// The fanning vertex to continue from: among the vertices of the triangles just emitted,
+// the one that has been cached longest and stays cached while its remaining triangles are
+// emitted, else any with triangles left; -1 if there is none (a dead end).
+inline int64_t NextFanningVertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& live,
+                                 const std::vector<uint64_t>& cacheTime, uint64_t time, unsigned cacheSize) {
+    int64_t best = -1;
+    int64_t bestPriority = -1;
+    for (size_t k = 0; k < candidates.size(); k++) {
+        uint32_t v = candidates[k];
+        if (live[v] == 0) continue;
+        int64_t priority = 0;
+        if (time - cacheTime[v] + 2 * live[v] <= cacheSize) priority = static_cast<int64_t>(time - cacheTime[v]);
+        if (priority > bestPriority) {
+            bestPriority = priority;
+            best = v;
+        }
+    }
+    return best;
+}
+
+} // namespace mesh_optimize_detail
+
+// ############################################################################################
+// Reorder the triangles for the post-transform vertex cache with Tipsify (Sander, Nehab and
+// Barczak, "Fast triangle reordering for vertex locality and reduced overdraw", 2007): the
+// triangles around one vertex are emitted as a fan, then the walk moves on to a vertex of
+// that fan which is still cached, falling back to recently used vertices (and finally any
+// vertex with triangles left) at dead ends. It runs in linear time; the result gets within
+// a few percent of slower greedy optimizers such as Forsyth's.
+inline void OptimizeVertexCache(uint32_t* indices, size_t triangleCount, size_t vertexCount,
+                                unsigned cacheSize = VERTEX_CACHE_SIZE) {
+    using namespace mesh_optimize_detail;
+    if (triangleCount == 0) return;
+    size_t cornerCount = triangleCount * 3;
+
+    // Triangles around every vertex: vertex v's are adjacency[offsets[v]] up to adjacency[offsets[v + 1]]
+    // ('live' counts the triangles of every vertex that are not emitted yet)
+    std::vector<uint32_t> live(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(cornerCount);
+    for (size_t c = 0; c < cornerCount; c++) live[indices[c]]++;
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+    {
+        std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+        for (size_t c = 0; c < cornerCount; c++) adjacency[next[indices[c]]++] = static_cast<uint32_t>(c / 3);
+    }
+
+    std::vector<uint64_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd, candidates, output;
+    output.reserve(cornerCount);
+    MemAccount scratchMem(MEM_TEMPORARY);
+    scratchMem.Set(VectorBytes(offsets) + VectorBytes(adjacency) + VectorBytes(live) + VectorBytes(cacheTime) +
+                   VectorBytes(output) + triangleCount / 8);
+
+    uint64_t time = cacheSize + 1;
+    size_t cursor = 0;          // Vertices below it have no triangles left
+    int64_t fanning = 0;
+    while (fanning >= 0) {
+        uint32_t f = static_cast<uint32_t>(fanning);
+        candidates.clear();
+        for (uint32_t k = offsets[f]; k < offsets[f + 1]; k++) {
+            uint32_t t = adjacency[k];
+            if (emitted[t]) continue;
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = indices[t * 3 + c];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize) cacheTime[v] = time++;
+            }
+            emitted[t] = true;
+        }
+        fanning = NextFanningVertex(candidates, live, cacheTime, time, cacheSize);
+        if (fanning < 0) {
+            while (!deadEnd.empty() && fanning < 0) {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) fanning = v;
+            }
+            while (fanning < 0 && cursor < vertexCount) {
+                if (live[cursor] > 0) fanning = static_cast<int64_t>(cursor);
+                else cursor++;
+            }
+        }
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+// ############################################################################################
+// Number the vertices in the order the triangles first use them, so vertex fetches walk
+// memory forward; vertices no triangle uses keep their relative order at the end. The
+// indices are rewritten and remap[old] = new is returned for the vertex attributes
+// (ReorderVertices).
+inline void OptimizeVertexFetch(uint32_t* indices, size_t triangleCount, size_t vertexCount,
+                                std::vector<uint32_t>& remap) {
+    const uint32_t unused = 0xFFFFFFFFu;
+    remap.assign(vertexCount, unused);
+    uint32_t next = 0;
+    for (size_t c = 0; c < triangleCount * 3; c++) {
+        uint32_t& target = remap[indices[c]];
+        if (target == unused) target = next++;
+        indices[c] = target;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] == unused) remap[v] = next++;
+    }
+}
+
+// ############################################################################################
+// Move every per-vertex value to its new index
+template <typename T>
+inline void ReorderVertices(std::vector<T>& values, const std::vector<uint32_t>& remap) {
+    if (values.size() != remap.size()) return;
+    std::vector<T> reordered(values.size());
+    for (size_t v = 0; v < values.size(); v++) reordered[remap[v]] = values[v];
+    values.swap(reordered);
+}
+
+// ############################################################################################
+// The whole pass: triangles in vertex cache order (unless 'reorderTriangles' is false, e.g.
+// when a BVH already fixed their order), then vertices (and normals, if given one per
+// vertex) in order of first use. The ACMR is measured before and after reordering the
+// triangles; renumbering the vertices alone does not change it.
+inline MeshOptimizeStats OptimizeMeshOrder(std::vector<Vector3f>& vertices, std::vector<uint32_t>& indices,
+                                           std::vector<Vector3f>* normals = NULL, bool reorderTriangles = true,
+                                           unsigned cacheSize = VERTEX_CACHE_SIZE) {
+    auto start = std::chrono::high_resolution_clock::now();
+    MeshOptimizeStats stats;
+    size_t triangleCount = indices.size() / 3;
+    stats.trianglesReordered = reorderTriangles;
+    if (reorderTriangles) {
+        stats.acmrBefore = ComputeACMR(indices.data(), triangleCount, vertices.size(), cacheSize);
+        OptimizeVertexCache(indices.data(), triangleCount, vertices.size(), cacheSize);
+        stats.acmrAfter = ComputeACMR(indices.data(), triangleCount, vertices.size(), cacheSize);
+    }
+    std::vector<uint32_t> remap;
+    OptimizeVertexFetch(indices.data(), triangleCount, vertices.size(), remap);
+    ReorderVertices(vertices, remap);
+    if (normals) ReorderVertices(*normals, remap);
+    stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return stats;
+}
+
+#endif // MESH_OPTIMIZE_H
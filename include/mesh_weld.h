@@ -0,0 +1,272 @@
+#ifndef MESH_WELD_H
+#define MESH_WELD_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "math_utils.h"
+#include "mem_stats.h"
+#include "chunked_scatter.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ############################################################################################
+// Result of welding a mesh's vertices
+struct WeldStats {
+    size_t inputVertices = 0;
+    size_t outputVertices = 0;
+    size_t removedTriangles = 0;    // Triangles collapsed to a line or point by the weld
+    double seconds = 0.0;
+
+    // Output vertices per input vertex: 1 means nothing was welded
+    double ratio() const {
+        return inputVertices > 0 ? static_cast<double>(outputVertices) / inputVertices : 1.0;
+    }
+};
+
+namespace mesh_weld_detail {
+
+// A vertex tagged with its bucket, the top bits of its grid cell's hash
+struct CellEntry {
+    uint32_t bucket;
+    uint32_t index;
+};
+
+// Cells are this many tolerances wide, so most vertices are far enough from every cell
+// face that their own cell is the only one that can hold a vertex within the tolerance
+const float CELL_TOLERANCES = 16.0f;
+
+inline uint64_t HashCell(long long x, long long y, long long z) {
+    uint64_t h = static_cast<uint64_t>(x) * 0x9E3779B185EBCA87ULL;
+    h ^= static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+    h ^= static_cast<uint64_t>(z) * 0x165667B19E3779F9ULL + (h << 6) + (h >> 2);
+    return h ^ (h >> 29);
+}
+
+// The grid is offset by half a cell, so round coordinates (flat meshes at z = 0, grid-aligned
+// models) sit in the middle of cells rather than on the faces
+inline long long CellCoordinate(float value, float inverseCell) {
+    double cell = std::floor(static_cast<double>(value) * inverseCell + 0.5);
+    return static_cast<long long>(std::max(-9.0e18, std::min(9.0e18, cell)));
+}
+
+// Exact welding hashes the coordinates' bits (with -0 equal to +0)
+inline uint32_t FloatBits(float value) {
+    if (value == 0.0f) value = 0.0f;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline bool WithinTolerance(const Vector3f& a, const Vector3f& b, float tolerance) {
+    if (tolerance <= 0.0f) return a.x == b.x && a.y == b.y && a.z == b.z;
+    Vector3f d = a - b;
+    return d.x * d.x + d.y * d.y + d.z * d.z <= tolerance * tolerance;
+}
+
+const unsigned RADIX_BITS = 8;      // 256 output streams per pass stay cheap for the cache and TLB
+
+// ############################################################################################
+// One stable counting-sort pass of 'from' into 'to' by bits [low, low + width) of the bucket
+// numbers (ChunkedScatter with one key per digit)
+inline void RadixPass(const CellEntry* from, CellEntry* to, size_t count, unsigned low, unsigned width, int chunks) {
+    const uint32_t mask = (uint32_t(1) << width) - 1;
+    ChunkedScatter(count, size_t(mask) + 1, chunks, 1,
+        [=](size_t first, size_t last, size_t* counts) {
+            for (size_t i = first; i < last; i++) counts[(from[i].bucket >> low) & mask]++;
+        },
+        [=](size_t first, size_t last, size_t* next) {
+            for (size_t i = first; i < last; i++) to[next[(from[i].bucket >> low) & mask]++] = from[i];
+        });
+}
+
+// ############################################################################################
+// Buckets are numbered by the top 'bits' of a cell hash, about one bucket per vertex
+inline unsigned BucketBits(size_t count) {
+    unsigned bits = 1;
+    while (bits < 32 && (size_t(1) << bits) < count) bits++;
+    return bits;
+}
+
+// ############################################################################################
+// Sort the entries (given in index order) by bucket. The radix sort is stable, so every
+// bucket stays in index order and the result does not depend on the thread count. Bucket
+// b is entries[bucketStart[b]] up to entries[bucketStart[b + 1]]; a bucket can hold
+// several cells (and one cell's vertices are all in one bucket).
+inline void SortByBucket(std::vector<CellEntry>& entries, unsigned bits, std::vector<uint32_t>& bucketStart) {
+    size_t count = entries.size();
+    int chunks = 1;
+#ifdef _OPENMP
+    chunks = omp_get_max_threads();
+#endif
+    std::vector<CellEntry> buffer(count);
+    for (unsigned low = 0; low < bits; low += RADIX_BITS) {
+        RadixPass(entries.data(), buffer.data(), count, low, std::min(RADIX_BITS, bits - low), chunks);
+        entries.swap(buffer);
+    }
+    std::vector<CellEntry>().swap(buffer);
+
+    size_t bucketCount = size_t(1) << bits;
+    bucketStart.resize(bucketCount + 1);
+    size_t k = 0;
+    for (size_t b = 0; b < bucketCount; b++) {
+        bucketStart[b] = static_cast<uint32_t>(k);
+        while (k < count && entries[k].bucket == b) k++;
+    }
+    bucketStart[bucketCount] = static_cast<uint32_t>(count);
+}
+
+// ############################################################################################
+// Lowest index below 'best' among the vertices of 'bucket' that lie within the tolerance of
+// 'position'. Vertices of other cells sharing the bucket may match too, which is just as valid.
+inline uint32_t FindInBucket(const CellEntry* entries, const uint32_t* bucketStart, uint32_t bucket,
+                             const Vector3f* vertices, const Vector3f& position, float tolerance, uint32_t best) {
+    for (const CellEntry* entry = entries + bucketStart[bucket]; entry < entries + bucketStart[bucket + 1]; entry++) {
+        if (entry->index >= best) break;
+        if (WithinTolerance(vertices[entry->index], position, tolerance)) return entry->index;
+    }
+    return best;
+}
+
+} // namespace mesh_weld_detail
+
+// ############################################################################################
+// Merge vertices that lie within 'tolerance' of each other (0 merges exact duplicates only)
+// and remap the triangle indices to the merged vertices. Each vertex joins the lowest-
+// numbered vertex within the tolerance, following chains, and the kept vertices stay in
+// their original order, so the result is deterministic. Triangles the weld collapses (two
+// corners on the same vertex) are removed.
+//
+// Vertices are radix sorted into buckets by the hash of a grid cell a few tolerances wide;
+// every vertex then searches the lower vertices of its own bucket, and the buckets of the
+// neighbouring cells only when it lies within the tolerance of a cell face, all vertices in
+// parallel. Exact welding hashes the positions themselves.
+//
+// 'remap', if given, receives the new index of every input vertex, so per-vertex
+// attributes can follow with WeldAttribute.
+inline WeldStats WeldVertices(std::vector<Vector3f>& vertices, std::vector<uint32_t>& indices, float tolerance,
+                              std::vector<uint32_t>* remap = NULL) {
+    using namespace mesh_weld_detail;
+    auto start = std::chrono::high_resolution_clock::now();
+    WeldStats stats;
+    size_t count = vertices.size();
+    stats.inputVertices = count;
+    const Vector3f* position = vertices.data();
+    float inverseCell = tolerance > 0.0f ? 1.0f / (tolerance * CELL_TOLERANCES) : 0.0f;
+
+    unsigned bits = BucketBits(count), shift = 64 - bits;
+
+    std::vector<CellEntry> entries(count);
+    #pragma omp parallel for
+    for (long long i = 0; i < static_cast<long long>(count); i++) {
+        const Vector3f& p = position[i];
+        uint64_t hash = tolerance > 0.0f
+            ? HashCell(CellCoordinate(p.x, inverseCell), CellCoordinate(p.y, inverseCell), CellCoordinate(p.z, inverseCell))
+            : HashCell(FloatBits(p.x), FloatBits(p.y), FloatBits(p.z));
+        entries[i].bucket = static_cast<uint32_t>(hash >> shift);
+        entries[i].index = static_cast<uint32_t>(i);
+    }
+    std::vector<uint32_t> bucketStart;
+    SortByBucket(entries, bits, bucketStart);
+    MemAccount scratchMem(MEM_TEMPORARY);
+    scratchMem.Set(VectorBytes(entries) + VectorBytes(bucketStart));
+
+    // Every vertex's lowest match, walking the buckets in order: the lower vertices of its
+    // own cell come before it in its bucket, then the neighbouring cells it is close enough to
+    std::vector<uint32_t> target(count);
+    const CellEntry* sorted = entries.data();
+    const uint32_t* bucket = bucketStart.data();
+    #pragma omp parallel for schedule(dynamic, 16384)
+    for (long long k = 0; k < static_cast<long long>(count); k++) {
+        uint32_t i = sorted[k].index;
+        const Vector3f& p = position[i];
+        uint32_t best = i;
+        for (const CellEntry* entry = sorted + bucket[sorted[k].bucket]; entry < sorted + k; entry++) {
+            if (WithinTolerance(position[entry->index], p, tolerance)) {
+                best = entry->index;
+                break;
+            }
+        }
+        if (tolerance > 0.0f) {
+            long long cell[3];
+            int low[3], high[3];
+            const float coordinate[3] = { p.x, p.y, p.z };
+            for (int c = 0; c < 3; c++) {
+                cell[c] = CellCoordinate(coordinate[c], inverseCell);
+                low[c] = CellCoordinate(coordinate[c] - tolerance, inverseCell) < cell[c] ? -1 : 0;
+                high[c] = CellCoordinate(coordinate[c] + tolerance, inverseCell) > cell[c] ? 1 : 0;
+            }
+            for (int dx = low[0]; dx <= high[0]; dx++) {
+                for (int dy = low[1]; dy <= high[1]; dy++) {
+                    for (int dz = low[2]; dz <= high[2]; dz++) {
+                        if (dx == 0 && dy == 0 && dz == 0) continue;
+                        uint64_t hash = HashCell(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+                        best = FindInBucket(sorted, bucket, static_cast<uint32_t>(hash >> shift), position, p,
+                                            tolerance, best);
+                    }
+                }
+            }
+        }
+        target[i] = best;
+    }
+    std::vector<CellEntry>().swap(entries);
+    std::vector<uint32_t>().swap(bucketStart);
+
+    // Follow chains (i -> j -> k, each lower than the last) to their root; the root of i is
+    // final once the root of every lower vertex is, so one ascending pass resolves them all
+    for (size_t i = 0; i < count; i++) target[i] = target[target[i]];
+
+    // Number the kept vertices in order and move them to the front
+    std::vector<uint32_t> newIndex(count);
+    uint32_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (target[i] == i) {
+            newIndex[i] = kept;
+            vertices[kept++] = vertices[i];
+        }
+    }
+    #pragma omp parallel for
+    for (long long i = 0; i < static_cast<long long>(count); i++) newIndex[i] = newIndex[target[i]];
+    vertices.resize(kept);
+    stats.outputVertices = kept;
+
+    // Remap the triangles, then drop the collapsed ones
+    size_t cornerCount = indices.size() / 3 * 3;
+    #pragma omp parallel for
+    for (long long c = 0; c < static_cast<long long>(cornerCount); c++) indices[c] = newIndex[indices[c]];
+    size_t written = 0;
+    for (size_t t = 0; t < cornerCount; t += 3) {
+        uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+        if (a == b || b == c || a == c) continue;
+        indices[written++] = a;
+        indices[written++] = b;
+        indices[written++] = c;
+    }
+    stats.removedTriangles = (cornerCount - written) / 3;
+    indices.resize(written);
+
+    if (remap) remap->swap(newIndex);
+    stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return stats;
+}
+
+// ############################################################################################
+// Apply a weld's remap to a per-vertex attribute (e.g. normals): every kept vertex keeps
+// the value of the input vertex it was first numbered from
+template <typename T>
+inline void WeldAttribute(std::vector<T>& values, const std::vector<uint32_t>& remap, size_t keptVertices) {
+    std::vector<bool> done(keptVertices, false);
+    for (size_t i = 0; i < remap.size() && i < values.size(); i++) {
+        if (!done[remap[i]]) {
+            values[remap[i]] = values[i];
+            done[remap[i]] = true;
+        }
+    }
+    values.resize(keptVertices);
+}
+
+#endif // MESH_WELD_H
@@ -0,0 +1,386 @@
+#ifndef OFF_MESH_H
+#define OFF_MESH_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "math_utils.h"
+#include "mem_stats.h"
+#include "mapped_file.h"
+#include "fast_parse.h"
+
+// ############################################################################################
+// Append the fan triangulation of 'faceCount' flat faces, face f using indices[offsets[f]]
+// up to indices[offsets[f + 1]], as triangles (0, j - 1, j). Faces with fewer than three
+// corners add none.
+inline void AppendFanTriangles(const int* indices, const int* offsets, size_t faceCount,
+                               std::vector<uint32_t>& triangles) {
+    for (size_t f = 0; f < faceCount; f++) {
+        const int* face = indices + offsets[f];
+        int size = offsets[f + 1] - offsets[f];
+        for (int j = 2; j < size; j++) {
+            triangles.push_back(face[0]);
+            triangles.push_back(face[j - 1]);
+            triangles.push_back(face[j]);
+        }
+    }
+}
+
+// ############################################################################################
+// A polygon mesh loaded from an OFF file. Faces are stored back to back in one flat index
+// array; face f uses indices[faceOffsets[f]] up to indices[faceOffsets[f + 1]].
+// The memory is owned by the vectors and reported to MemStats as geometry.
+class OffMesh {
+public:
+    std::vector<Vector3f> vertices;
+    std::vector<int> indices;
+    std::vector<int> faceOffsets;   // faceCount() + 1 entries
+    Vector3f boundsMin;
+    Vector3f boundsMax;
+    float extent;                   // Largest side of the bounding box
+
+    OffMesh() : boundsMin(0, 0, 0), boundsMax(0, 0, 0), extent(0.0f) {}
+
+    int vertexCount() const { return static_cast<int>(vertices.size()); }
+    int faceCount() const { return faceOffsets.empty() ? 0 : static_cast<int>(faceOffsets.size()) - 1; }
+    int faceSize(int f) const { return faceOffsets[f + 1] - faceOffsets[f]; }
+    const int* face(int f) const { return &indices[faceOffsets[f]]; }
+
+    // ############################################################################################
+    // Triangles after fan triangulation of every face with at least 3 corners
+    size_t triangleCount() const {
+        size_t count = 0;
+        for (int f = 0; f < faceCount(); f++) count += std::max(faceSize(f) - 2, 0);
+        return count;
+    }
+
+    // Append the fan triangulation of every face to 'triangles' (3 indices each)
+    void triangulate(std::vector<uint32_t>& triangles) const {
+        triangles.reserve(triangles.size() + triangleCount() * 3);
+        if (faceCount() > 0) AppendFanTriangles(indices.data(), faceOffsets.data(), faceCount(), triangles);
+    }
+
+    size_t byteSize() const {
+        return VectorBytes(vertices) + VectorBytes(indices) + VectorBytes(faceOffsets);
+    }
+
+    void clear() {
+        vertices = std::vector<Vector3f>();
+        indices = std::vector<int>();
+        faceOffsets = std::vector<int>();
+        boundsMin = boundsMax = Vector3f(0, 0, 0);
+        extent = 0.0f;
+        geometryMem.Set(0);
+    }
+
+    // Update the memory accounting after the arrays changed
+    void updateMem() {
+        geometryMem.Set(byteSize());
+    }
+
+private:
+    MemAccount geometryMem{MEM_GEOMETRY};
+
+    OffMesh(const OffMesh&) = delete;
+    OffMesh& operator=(const OffMesh&) = delete;
+};
+
+// ############################################################################################
+// Size and timing of a LoadOFF call
+struct OffLoadStats {
+    size_t fileBytes = 0;
+    size_t faces = 0;
+    int chunks = 0;
+    double seconds = 0.0;
+
+    double megabytesPerSecond() const {
+        return seconds > 0.0 ? fileBytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+
+    double millionFacesPerSecond() const {
+        return seconds > 0.0 ? faces / 1e6 / seconds : 0.0;
+    }
+};
+
+namespace off_mesh_detail {
+
+// ############################################################################################
+// Parse the "OFF" keyword (optional, also e.g. "COFF" or "NOFF") and the three counts
+inline const char* ParseHeader(const char* p, const char* end, int& vertexCount, int& faceCount) {
+    p = SkipSpace(p, end);
+    const char* word = p;
+    while (p < end && ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))) p++;
+    if (p - word < 3 && p != word) return NULL;
+    if (p != word && std::string(p - 3, p) != "OFF") return NULL;
+
+    int edgeCount;
+    p = SkipSpace(p, end);
+    if (!(p = ParseInt(p, end, vertexCount))) return NULL;
+    p = SkipSpace(p, end);
+    if (!(p = ParseInt(p, end, faceCount))) return NULL;
+    p = SkipSpace(p, end);
+    if (!(p = ParseInt(p, end, edgeCount))) return NULL;
+    return vertexCount >= 0 && faceCount >= 0 ? SkipLine(p, end) : NULL;
+}
+
+// ############################################################################################
+// A newline-aligned piece of the vertex and face sections. Every record (vertex or face
+// line) lies entirely inside one chunk, so chunks can be parsed independently once the
+// global index of their first record is known.
+struct Chunk {
+    const char* begin;
+    const char* end;
+    size_t firstRecord;     // Index of the first record among all vertices and faces
+    size_t records;
+    size_t firstIndex;      // Position of the chunk's first face corner in the index array
+    size_t indexCount;
+    Vector3f lo, hi;        // Bounds of the chunk's vertices
+    bool hasVertices;
+    size_t errorRecord;     // First invalid record, or SIZE_MAX
+    const char* errorAt;    // Start of the invalid record, for the line number
+    bool rangeError;        // The error is an out-of-range vertex index
+};
+
+// ############################################################################################
+// Count the records (non-empty, non-comment lines) of a chunk
+inline size_t CountRecords(const char* p, const char* end) {
+    size_t count = 0;
+    for (p = SkipSpace(p, end); p < end; p = SkipSpace(SkipLine(p, end), end)) count++;
+    return count;
+}
+
+// ############################################################################################
+// First pass over a chunk: parse its vertices and the corner count of its faces, which is
+// stored in faceOffsets[f + 1] until the second pass replaces it with the end offset
+inline void ParseVerticesAndSides(Chunk& chunk, OffMesh& mesh, size_t vertexCount, size_t recordCount) {
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    size_t last = std::min(chunk.firstRecord + chunk.records, recordCount);
+    for (size_t r = chunk.firstRecord; r < last; r++) {
+        p = SkipSpace(p, end);
+        if (r < vertexCount) {
+            Vector3f& v = mesh.vertices[r];
+            const char* record = p;
+            if (!(p = ParseFloat(p, end, v.x)) || !(p = ParseFloat(SkipBlank(p, end), end, v.y)) ||
+                !(p = ParseFloat(SkipBlank(p, end), end, v.z))) {
+                chunk.errorRecord = r;
+                chunk.errorAt = record;
+                return;
+            }
+            if (!chunk.hasVertices) {
+                chunk.lo = chunk.hi = v;
+                chunk.hasVertices = true;
+            } else {
+                chunk.lo.x = std::min(chunk.lo.x, v.x); chunk.hi.x = std::max(chunk.hi.x, v.x);
+                chunk.lo.y = std::min(chunk.lo.y, v.y); chunk.hi.y = std::max(chunk.hi.y, v.y);
+                chunk.lo.z = std::min(chunk.lo.z, v.z); chunk.hi.z = std::max(chunk.hi.z, v.z);
+            }
+        } else {
+            int sides;
+            const char* record = p;
+            if (!(p = ParseInt(p, end, sides)) || sides < 0) {
+                chunk.errorRecord = r;
+                chunk.errorAt = record;
+                return;
+            }
+            mesh.faceOffsets[r - vertexCount + 1] = sides;
+            chunk.indexCount += sides;
+        }
+        p = SkipLine(p, end);
+    }
+}
+
+// ############################################################################################
+// Second pass over a chunk: parse and range check the face corners into their final slots
+inline void ParseFaceIndices(Chunk& chunk, OffMesh& mesh, size_t vertexCount, size_t recordCount) {
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    size_t last = std::min(chunk.firstRecord + chunk.records, recordCount);
+    size_t position = chunk.firstIndex;
+    int* indices = mesh.indices.data();
+    for (size_t r = chunk.firstRecord; r < last; r++) {
+        p = SkipSpace(p, end);
+        if (r >= vertexCount) {
+            size_t f = r - vertexCount;
+            const char* record = p;
+            int sides = 0;
+            p = ParseInt(p, end, sides);    // Validated by the first pass
+            for (int k = 0; k < sides; k++) {
+                int index;
+                if (!(p = ParseInt(SkipBlank(p, end), end, index))) {
+                    chunk.errorRecord = r;
+                    chunk.errorAt = record;
+                    return;
+                }
+                if (static_cast<unsigned>(index) >= vertexCount) {
+                    chunk.errorRecord = r;
+                    chunk.errorAt = record;
+                    chunk.rangeError = true;
+                    return;
+                }
+                indices[position++] = index;
+            }
+            mesh.faceOffsets[f + 1] = static_cast<int>(position);
+        }
+        p = SkipLine(p, end);
+    }
+}
+
+// ############################################################################################
+// Report the first error over all chunks with its line number; false if there was one
+inline bool CheckChunks(const std::vector<Chunk>& chunks, size_t vertexCount, const std::string& filename,
+                        const char* fileBegin) {
+    size_t first = SIZE_MAX;
+    const Chunk* chunk = NULL;
+    for (size_t c = 0; c < chunks.size(); c++) {
+        if (chunks[c].errorRecord < first) {
+            first = chunks[c].errorRecord;
+            chunk = &chunks[c];
+        }
+    }
+    if (!chunk) return true;
+    size_t line = 1 + std::count(fileBegin, chunk->errorAt, '\n');
+    std::cerr << "Error: " << filename << ":" << line << ": ";
+    if (first < vertexCount) {
+        std::cerr << "Vertex " << first << " needs three coordinates" << std::endl;
+    } else if (chunk->rangeError) {
+        std::cerr << "Face " << first - vertexCount << " uses a vertex index outside [0, " << vertexCount << ")" << std::endl;
+    } else {
+        std::cerr << "Face " << first - vertexCount << " has a missing or invalid corner" << std::endl;
+    }
+    return false;
+}
+
+} // namespace off_mesh_detail
+
+// ############################################################################################
+// Load an OFF file into 'mesh'. The file is memory mapped and parsed in place on all
+// threads: the vertex and face sections are split into newline-aligned chunks, records
+// are counted per chunk, and a prefix sum gives each chunk the index of its first vertex
+// or face so it can parse straight into the arrays preallocated from the header counts.
+// A second prefix sum over the corner counts places the face indices, which are range
+// checked in the same parallel pass. Loading does not allocate per vertex or face.
+// Each vertex and face is on its own line; anything after its values (e.g. colors) is
+// ignored. Fails on short lines, malformed numbers and out-of-range indices, reporting the
+// line of the first invalid record.
+inline bool LoadOFF(const std::string& filename, OffMesh& mesh, OffLoadStats* stats = NULL) {
+    using namespace off_mesh_detail;
+    auto start = std::chrono::high_resolution_clock::now();
+    mesh.clear();
+
+    MappedFile file;
+    if (!file.openRead(filename)) return false;
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
+
+    int vertexCount, faceCount;
+    if (!p || !(p = ParseHeader(p, end, vertexCount, faceCount))) {
+        std::cerr << "Error: Invalid OFF header in " << filename << std::endl;
+        return false;
+    }
+    size_t recordCount = static_cast<size_t>(vertexCount) + faceCount;
+
+    // Split the body into chunks ending at newlines, several per thread for load balance
+    const size_t MIN_CHUNK_BYTES = 256 * 1024;
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    size_t bodyBytes = end - p;
+    size_t chunkBytes = std::max(MIN_CHUNK_BYTES, bodyBytes / (static_cast<size_t>(threads) * 8) + 1);
+    std::vector<Chunk> chunks;
+    while (p < end) {
+        Chunk chunk = Chunk();
+        chunk.begin = p;
+        chunk.end = static_cast<size_t>(end - p) > chunkBytes ? SkipLine(p + chunkBytes, end) : end;
+        chunk.errorRecord = SIZE_MAX;
+        chunks.push_back(chunk);
+        p = chunk.end;
+    }
+    int chunkCount = static_cast<int>(chunks.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < chunkCount; c++) {
+        chunks[c].records = CountRecords(chunks[c].begin, chunks[c].end);
+    }
+    size_t records = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        chunks[c].firstRecord = records;
+        records += chunks[c].records;
+    }
+    if (records < recordCount) {
+        std::cerr << "Error: " << filename << " ends after " << records << " of " << recordCount
+                  << " vertices and faces" << std::endl;
+        return false;
+    }
+
+    // Vertices and face sizes
+    mesh.vertices.resize(vertexCount);
+    mesh.faceOffsets.resize(static_cast<size_t>(faceCount) + 1);
+    mesh.faceOffsets[0] = 0;
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < chunkCount; c++) {
+        ParseVerticesAndSides(chunks[c], mesh, vertexCount, recordCount);
+    }
+    if (!CheckChunks(chunks, vertexCount, filename, reinterpret_cast<const char*>(file.data()))) {
+        mesh.clear();
+        return false;
+    }
+
+    // Face corners
+    size_t indexCount = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        chunks[c].firstIndex = indexCount;
+        indexCount += chunks[c].indexCount;
+    }
+    if (indexCount > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        std::cerr << "Error: Too many face indices in " << filename << std::endl;
+        mesh.clear();
+        return false;
+    }
+    mesh.indices.resize(indexCount);
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < chunkCount; c++) {
+        ParseFaceIndices(chunks[c], mesh, vertexCount, recordCount);
+    }
+    if (!CheckChunks(chunks, vertexCount, filename, reinterpret_cast<const char*>(file.data()))) {
+        mesh.clear();
+        return false;
+    }
+
+    // Bounds
+    bool first = true;
+    for (int c = 0; c < chunkCount; c++) {
+        if (!chunks[c].hasVertices) continue;
+        if (first) {
+            mesh.boundsMin = chunks[c].lo;
+            mesh.boundsMax = chunks[c].hi;
+            first = false;
+        } else {
+            mesh.boundsMin = Vector3f(std::min(mesh.boundsMin.x, chunks[c].lo.x), std::min(mesh.boundsMin.y, chunks[c].lo.y),
+                                      std::min(mesh.boundsMin.z, chunks[c].lo.z));
+            mesh.boundsMax = Vector3f(std::max(mesh.boundsMax.x, chunks[c].hi.x), std::max(mesh.boundsMax.y, chunks[c].hi.y),
+                                      std::max(mesh.boundsMax.z, chunks[c].hi.z));
+        }
+    }
+    Vector3f size = mesh.boundsMax - mesh.boundsMin;
+    mesh.extent = std::max(size.x, std::max(size.y, size.z));
+    mesh.updateMem();
+
+    if (stats) {
+        stats->fileBytes = file.size();
+        stats->faces = faceCount;
+        stats->chunks = chunkCount;
+        stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    return true;
+}
+
+#endif // OFF_MESH_H
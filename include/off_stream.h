@@ -0,0 +1,320 @@
+#ifndef OFF_STREAM_H
+#define OFF_STREAM_H
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include "math_utils.h"
+#include "mem_stats.h"
+#include "fast_parse.h"
+#include "off_mesh.h"
+
+// ############################################################################################
+// A batch of consecutive vertices from an OFF file
+struct OffVertexBatch {
+    size_t first = 0;               // Index of vertices[0] in the file
+    size_t total = 0;               // Vertex count from the header
+    std::vector<Vector3f> vertices;
+};
+
+// ############################################################################################
+// A batch of consecutive faces from an OFF file, with the corners stored back to back:
+// face i uses indices[offsets[i]] up to indices[offsets[i + 1]]
+struct OffFaceBatch {
+    size_t first = 0;               // Index of the batch's first face in the file
+    size_t total = 0;               // Face count from the header
+    std::vector<int> indices;
+    std::vector<int> offsets;       // size() + 1 entries
+
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    int faceSize(size_t i) const { return offsets[i + 1] - offsets[i]; }
+    const int* face(size_t i) const { return &indices[offsets[i]]; }
+
+    // Append the fan triangulation of the batch's faces to 'triangles' (3 indices each)
+    void triangulate(std::vector<uint32_t>& triangles) const {
+        if (size() > 0) AppendFanTriangles(indices.data(), offsets.data(), size(), triangles);
+    }
+};
+
+// ############################################################################################
+// Reads an OFF file front to back through a fixed-size buffer and hands out its vertices
+// and faces in batches, so meshes larger than memory can be processed without holding the
+// whole model. Every record is validated as it is read: coordinates must be three finite
+// numbers, faces need their full corner list, and corners must reference vertices from the
+// header's range. The first error stops the reader and is reported as file:line: message.
+//
+// Usage:
+//   OffStreamReader reader;
+//   if (!reader.open(filename)) ...
+//   OffVertexBatch vertices;
+//   while (reader.readVertices(vertices, 65536)) ...
+//   OffFaceBatch faces;
+//   while (reader.readFaces(faces, 65536)) ...
+//   if (reader.failed()) ...
+class OffStreamReader {
+public:
+    explicit OffStreamReader(size_t bufferBytes = 1 << 20)
+        : file(NULL), buffer(std::max<size_t>(bufferBytes, 64)), position(0), fill(0), atEnd(false),
+          lineNumber(0), bytesRead(0), vertices(0), faces(0), verticesDone(0), facesDone(0),
+          hasFailed(false), bufferMem(MEM_TEMPORARY) {
+        bufferMem.Set(VectorBytes(buffer));
+    }
+
+    ~OffStreamReader() {
+        close();
+    }
+
+    // ############################################################################################
+    // Open the file and read its header
+    bool open(const std::string& filename) {
+        close();
+        name = filename;
+        hasFailed = false;
+        errorMessage.clear();
+        position = fill = 0;
+        atEnd = false;
+        lineNumber = bytesRead = 0;
+        verticesDone = facesDone = 0;
+        vertices = faces = 0;
+
+        file = fopen(filename.c_str(), "rb");
+        if (!file) {
+            return fail("Could not open file");
+        }
+
+        const char* p;
+        const char* end;
+        if (!nextRecord(p, end)) {
+            return hasFailed ? false : fail("Empty file, expected an OFF header");
+        }
+        // Optional keyword ("OFF", or a variant such as "COFF" or "NOFF")
+        const char* word = p;
+        while (p < end && ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))) p++;
+        if (p != word && (p - word < 3 || std::string(p - 3, p) != "OFF")) {
+            return fail("Expected the OFF keyword, found '" + std::string(word, p) + "'");
+        }
+        // The three counts, which may continue on the following lines
+        int counts[3];
+        const char* names[3] = { "vertex count", "face count", "edge count" };
+        for (int k = 0; k < 3; k++) {
+            p = SkipBlank(p, end);
+            if ((p == end || *p == '#') && !nextRecord(p, end)) {
+                return hasFailed ? false : fail(std::string("Missing ") + names[k] + " in the header");
+            }
+            if (!(p = ParseInt(p, end, counts[k])) || counts[k] < 0) {
+                return fail(std::string("Invalid ") + names[k] + " in the header");
+            }
+        }
+        vertices = counts[0];
+        faces = counts[1];
+        return true;
+    }
+
+    void close() {
+        if (file) fclose(file);
+        file = NULL;
+    }
+
+    // ############################################################################################
+    // Read up to 'maxVertices' vertices into 'batch'. Returns false once all vertices have
+    // been read or on an error.
+    bool readVertices(OffVertexBatch& batch, size_t maxVertices) {
+        batch.vertices.clear();
+        batch.first = verticesDone;
+        batch.total = vertices;
+        if (!file || hasFailed || verticesDone >= vertices) return false;
+
+        size_t count = std::min(std::max<size_t>(maxVertices, 1), vertices - verticesDone);
+        batch.vertices.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            const char* p;
+            const char* end;
+            if (!nextRecord(p, end)) {
+                return hasFailed ? false : fail(endMessage());
+            }
+            Vector3f& v = batch.vertices[i];
+            if (!(p = ParseFloat(p, end, v.x)) || !(p = ParseFloat(SkipBlank(p, end), end, v.y)) ||
+                !(p = ParseFloat(SkipBlank(p, end), end, v.z))) {
+                return fail("Vertex " + number(verticesDone) + " needs three coordinates");
+            }
+            if (!std::isfinite(v.x) || !std::isfinite(v.y) || !std::isfinite(v.z)) {
+                return fail("Vertex " + number(verticesDone) + " has a coordinate out of the float range");
+            }
+            verticesDone++;
+        }
+        return true;
+    }
+
+    // ############################################################################################
+    // Read up to 'maxFaces' faces into 'batch'. Vertices that were not read yet are validated
+    // and skipped. Returns false once all faces have been read or on an error.
+    bool readFaces(OffFaceBatch& batch, size_t maxFaces) {
+        batch.indices.clear();
+        batch.offsets.assign(1, 0);
+        batch.first = facesDone;
+        batch.total = faces;
+        if (verticesDone < vertices) {
+            OffVertexBatch skipped;
+            while (readVertices(skipped, 65536)) {}
+        }
+        if (!file || hasFailed || facesDone >= faces) return false;
+
+        size_t count = std::min(std::max<size_t>(maxFaces, 1), faces - facesDone);
+        for (size_t i = 0; i < count; i++) {
+            const char* p;
+            const char* end;
+            if (!nextRecord(p, end)) {
+                return hasFailed ? false : fail(endMessage());
+            }
+            int sides;
+            if (!(p = ParseInt(p, end, sides)) || sides < 0) {
+                return fail("Face " + number(facesDone) + " needs a non-negative corner count");
+            }
+            for (int k = 0; k < sides; k++) {
+                int index;
+                if (!(p = ParseInt(SkipBlank(p, end), end, index))) {
+                    return fail("Face " + number(facesDone) + " has " + number(k) + " of its " + number(sides) +
+                                " vertex indices");
+                }
+                if (static_cast<unsigned>(index) >= vertices) {
+                    return fail("Face " + number(facesDone) + " uses vertex " + number(index) +
+                                ", the file has " + number(vertices) + " vertices");
+                }
+                batch.indices.push_back(index);
+            }
+            batch.offsets.push_back(static_cast<int>(batch.indices.size()));
+            facesDone++;
+        }
+        return true;
+    }
+
+    size_t vertexCount() const { return vertices; }
+    size_t faceCount() const { return faces; }
+    size_t line() const { return lineNumber; }
+    size_t fileBytesRead() const { return bytesRead; }
+    bool failed() const { return hasFailed; }
+    const std::string& error() const { return errorMessage; }
+
+private:
+    FILE* file;
+    std::string name;
+    std::vector<char> buffer;
+    size_t position;            // Start of the unread part of the buffer
+    size_t fill;                // End of the valid data in the buffer
+    bool atEnd;                 // The file has no more data
+    size_t lineNumber;          // Line of the last record handed out
+    size_t bytesRead;
+    size_t vertices, faces;
+    size_t verticesDone, facesDone;
+    bool hasFailed;
+    std::string errorMessage;
+    MemAccount bufferMem;
+
+    // ############################################################################################
+    // Find the next line holding a record (neither blank nor a comment) as [begin, end),
+    // refilling the buffer as needed. Returns false at the end of the file or on a read error.
+    bool nextRecord(const char*& begin, const char*& end) {
+        for (;;) {
+            const char* p = buffer.data() + position;
+            const char* last = buffer.data() + fill;
+            const char* newline = static_cast<const char*>(p < last ? memchr(p, '\n', last - p) : NULL);
+            if (!newline) {
+                if (!atEnd) {
+                    if (!refill()) return false;
+                    continue;
+                }
+                if (p == last) return false;
+                newline = last;     // Last line without a newline
+            }
+            lineNumber++;
+            position = (newline - buffer.data()) + (newline < last ? 1 : 0);
+            const char* q = SkipBlank(p, newline);
+            if (q == newline || *q == '#') continue;
+            begin = q;
+            end = newline;
+            return true;
+        }
+    }
+
+    // ############################################################################################
+    // Move the unread bytes to the front of the buffer and read more, growing the buffer
+    // only if a single line does not fit
+    bool refill() {
+        if (position > 0) {
+            memmove(buffer.data(), buffer.data() + position, fill - position);
+            fill -= position;
+            position = 0;
+        }
+        if (fill == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+            bufferMem.Set(VectorBytes(buffer));
+        }
+        size_t n = fread(buffer.data() + fill, 1, buffer.size() - fill, file);
+        fill += n;
+        bytesRead += n;
+        if (n == 0) {
+            if (ferror(file)) return fail("Read error");
+            atEnd = true;
+        }
+        return true;
+    }
+
+    std::string endMessage() const {
+        return "File ends after " + number(verticesDone) + " of " + number(vertices) + " vertices and " +
+               number(facesDone) + " of " + number(faces) + " faces";
+    }
+
+    static std::string number(size_t value) {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    }
+
+    static std::string number(int value) {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    }
+
+    bool fail(const std::string& message) {
+        std::ostringstream out;
+        out << name << ":";
+        if (lineNumber > 0) out << lineNumber << ":";
+        out << " " << message;
+        errorMessage = out.str();
+        hasFailed = true;
+        close();
+        std::cerr << "Error: " << errorMessage << std::endl;
+        return false;
+    }
+
+    OffStreamReader(const OffStreamReader&) = delete;
+    OffStreamReader& operator=(const OffStreamReader&) = delete;
+};
+
+// ############################################################################################
+// Stream an OFF file through two consumers: onVertices(const OffVertexBatch&) for every
+// batch of vertices, then onFaces(const OffFaceBatch&) for every batch of faces. Either
+// consumer can stop the stream by returning false. Returns true if the whole file was read
+// and accepted.
+template <typename VertexConsumer, typename FaceConsumer>
+bool StreamOFF(const std::string& filename, size_t batchSize, VertexConsumer onVertices, FaceConsumer onFaces) {
+    OffStreamReader reader;
+    if (!reader.open(filename)) return false;
+    OffVertexBatch vertexBatch;
+    while (reader.readVertices(vertexBatch, batchSize)) {
+        if (!onVertices(static_cast<const OffVertexBatch&>(vertexBatch))) return false;
+    }
+    OffFaceBatch faceBatch;
+    while (reader.readFaces(faceBatch, batchSize)) {
+        if (!onFaces(static_cast<const OffFaceBatch&>(faceBatch))) return false;
+    }
+    return !reader.failed();
+}
+
+#endif // OFF_STREAM_H
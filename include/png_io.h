@@ -0,0 +1,933 @@
+#ifndef PNG_IO_H
+#define PNG_IO_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ############################################################################################
+// Native PNG encoder (and a decoder for comparison tools) for 8-bit RGB images.
+// Rows are filtered in parallel (per-row adaptive filter choice), then the filtered data is
+// split into chunks of rows that are deflate-compressed independently on separate threads.
+// Each chunk is byte aligned with an empty stored block, so the compressed chunks can simply
+// be concatenated into one zlib stream; the Adler-32 checksums are combined afterwards.
+
+namespace png_detail {
+
+// ############################################################################################
+// CRC-32 as used by PNG chunks. The table is a function-local static built by
+// MakeCrc32Table, so its initialization is thread-safe (the frame archive's writer thread
+// computes checksums too).
+struct Crc32Table {
+    unsigned int entries[256];
+};
+
+inline Crc32Table MakeCrc32Table() {
+    Crc32Table table;
+    for (unsigned int n = 0; n < 256; n++) {
+        unsigned int c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table.entries[n] = c;
+    }
+    return table;
+}
+
+inline unsigned int Crc32(const unsigned char* data, size_t length, unsigned int crc = 0) {
+    static const Crc32Table table = MakeCrc32Table();
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ############################################################################################
+// Adler-32 of a buffer, and the combination of two checksums of adjacent buffers
+const unsigned int ADLER_BASE = 65521;
+
+inline unsigned int Adler32(const unsigned char* data, size_t length) {
+    unsigned int a = 1, b = 0;
+    while (length > 0) {
+        size_t n = std::min<size_t>(length, 5552); // Largest n that cannot overflow 32 bits
+        for (size_t i = 0; i < n; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+        data += n;
+        length -= n;
+    }
+    return (b << 16) | a;
+}
+
+inline unsigned int Adler32Combine(unsigned int adler1, unsigned int adler2, size_t length2) {
+    unsigned int rem = static_cast<unsigned int>(length2 % ADLER_BASE);
+    unsigned int sum1 = adler1 & 0xFFFF;
+    unsigned int sum2 = static_cast<unsigned int>((static_cast<unsigned long long>(rem) * sum1) % ADLER_BASE);
+    sum1 += (adler2 & 0xFFFF) + ADLER_BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= (ADLER_BASE << 1)) sum2 -= (ADLER_BASE << 1);
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+// ############################################################################################
+// LSB-first bit writer for deflate
+class BitWriter {
+public:
+    std::vector<unsigned char>& out;
+    unsigned long long bitBuffer;
+    int bitCount;
+
+    explicit BitWriter(std::vector<unsigned char>& o) : out(o), bitBuffer(0), bitCount(0) {}
+
+    void write(unsigned int bits, int count) {
+        bitBuffer |= static_cast<unsigned long long>(bits) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            out.push_back(static_cast<unsigned char>(bitBuffer));
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    void alignToByte() {
+        if (bitCount > 0) write(0, 8 - bitCount);
+    }
+};
+
+// ############################################################################################
+// Length and distance symbol tables from RFC 1951
+const unsigned short LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const unsigned char LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const unsigned short DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const unsigned char DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const unsigned char CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+inline int LengthSymbol(int length) {
+    int i = 28;
+    while (LENGTH_BASE[i] > length) i--;
+    return i;
+}
+
+inline int DistSymbol(int dist) {
+    int i = 29;
+    while (DIST_BASE[i] > dist) i--;
+    return i;
+}
+
+// ############################################################################################
+// Length-limited Huffman code lengths using the package-merge algorithm.
+// Symbols with zero frequency get length 0; at least two symbols must be used.
+inline void BuildCodeLengths(const unsigned int* freqs, int count, int maxLength, unsigned char* lengths) {
+    struct Node { unsigned long long weight; int left, right, symbol; };
+    std::vector<Node> pool;
+    std::vector<int> leaves;
+
+    for (int i = 0; i < count; i++) {
+        lengths[i] = 0;
+        if (freqs[i] > 0) {
+            Node leaf = { freqs[i], -1, -1, i };
+            pool.push_back(leaf);
+            leaves.push_back(static_cast<int>(pool.size()) - 1);
+        }
+    }
+    std::stable_sort(leaves.begin(), leaves.end(),
+                     [&pool](int a, int b) { return pool[a].weight < pool[b].weight; });
+
+    size_t n = leaves.size();
+    if (n == 1) {
+        lengths[pool[leaves[0]].symbol] = 1;
+        return;
+    }
+
+    std::vector<int> current = leaves;
+    for (int level = 1; level < maxLength; level++) {
+        // Package adjacent pairs of the previous list, then merge with the leaves
+        std::vector<int> packages;
+        for (size_t i = 0; i + 1 < current.size(); i += 2) {
+            Node package = { pool[current[i]].weight + pool[current[i + 1]].weight, current[i], current[i + 1], -1 };
+            pool.push_back(package);
+            packages.push_back(static_cast<int>(pool.size()) - 1);
+        }
+        std::vector<int> merged;
+        merged.reserve(leaves.size() + packages.size());
+        size_t a = 0, b = 0;
+        while (a < leaves.size() || b < packages.size()) {
+            if (b >= packages.size() || (a < leaves.size() && pool[leaves[a]].weight <= pool[packages[b]].weight)) {
+                merged.push_back(leaves[a++]);
+            } else {
+                merged.push_back(packages[b++]);
+            }
+        }
+        current.swap(merged);
+    }
+
+    // Each appearance of a leaf in the first 2n-2 items adds one to its code length
+    std::vector<int> stack;
+    for (size_t i = 0; i < 2 * n - 2; i++) {
+        stack.push_back(current[i]);
+        while (!stack.empty()) {
+            const Node& node = pool[stack.back()];
+            stack.pop_back();
+            if (node.symbol >= 0) {
+                lengths[node.symbol]++;
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+}
+
+// ############################################################################################
+// Canonical Huffman codes from code lengths. Deflate sends Huffman codes most significant
+// bit first, so the codes are returned bit-reversed, ready for the LSB-first writer.
+inline void BuildCodes(const unsigned char* lengths, int count, unsigned short* codes) {
+    int lengthCount[16] = { 0 };
+    for (int i = 0; i < count; i++) lengthCount[lengths[i]]++;
+    lengthCount[0] = 0;
+
+    int nextCode[16] = { 0 };
+    int code = 0;
+    for (int bits = 1; bits < 16; bits++) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+    for (int i = 0; i < count; i++) {
+        if (lengths[i] == 0) {
+            codes[i] = 0;
+            continue;
+        }
+        int value = nextCode[lengths[i]]++;
+        int reversed = 0;
+        for (int b = 0; b < lengths[i]; b++) reversed |= ((value >> b) & 1) << (lengths[i] - 1 - b);
+        codes[i] = static_cast<unsigned short>(reversed);
+    }
+}
+
+// ############################################################################################
+// One LZ77 symbol: a literal byte (dist == 0) or a (length, distance) match
+struct Lz77Symbol {
+    unsigned short litLen;
+    unsigned short dist;
+};
+
+// ############################################################################################
+// Emit one dynamic-Huffman deflate block (BFINAL = 0)
+inline void WriteDynamicBlock(BitWriter& writer, const std::vector<Lz77Symbol>& symbols) {
+    unsigned int litFreq[286] = { 0 };
+    unsigned int distFreq[30] = { 0 };
+    for (size_t i = 0; i < symbols.size(); i++) {
+        if (symbols[i].dist == 0) {
+            litFreq[symbols[i].litLen]++;
+        } else {
+            litFreq[257 + LengthSymbol(symbols[i].litLen)]++;
+            distFreq[DistSymbol(symbols[i].dist)]++;
+        }
+    }
+    litFreq[256] = 1; // End of block
+
+    // Decoders require complete codes, so make sure each alphabet uses two symbols
+    if (litFreq[0] == 0) litFreq[0] = 1;
+    int usedDist = 0;
+    for (int i = 0; i < 30; i++) usedDist += distFreq[i] > 0;
+    if (usedDist < 2) {
+        if (distFreq[0] == 0) distFreq[0] = 1;
+        else distFreq[1] = 1;
+    }
+
+    unsigned char litLengths[286], distLengths[30];
+    unsigned short litCodes[286], distCodes[30];
+    BuildCodeLengths(litFreq, 286, 15, litLengths);
+    BuildCodeLengths(distFreq, 30, 15, distLengths);
+    BuildCodes(litLengths, 286, litCodes);
+    BuildCodes(distLengths, 30, distCodes);
+
+    int hlit = 286;
+    while (hlit > 257 && litLengths[hlit - 1] == 0) hlit--;
+    int hdist = 30;
+    while (hdist > 1 && distLengths[hdist - 1] == 0) hdist--;
+
+    // Run-length encode the concatenated code lengths with symbols 16, 17 and 18
+    std::vector<unsigned char> all(litLengths, litLengths + hlit);
+    all.insert(all.end(), distLengths, distLengths + hdist);
+    std::vector<unsigned char> rleSymbols, rleExtra;
+    unsigned int clFreq[19] = { 0 };
+    for (size_t i = 0; i < all.size();) {
+        size_t run = 1;
+        while (i + run < all.size() && all[i + run] == all[i]) run++;
+        if (all[i] == 0 && run >= 3) {
+            run = std::min<size_t>(run, 138);
+            rleSymbols.push_back(run >= 11 ? 18 : 17);
+            rleExtra.push_back(static_cast<unsigned char>(run >= 11 ? run - 11 : run - 3));
+        } else if (all[i] != 0 && run >= 4) {
+            run = std::min<size_t>(run, 7);
+            rleSymbols.push_back(all[i]);
+            rleExtra.push_back(0);
+            rleSymbols.push_back(16);
+            rleExtra.push_back(static_cast<unsigned char>(run - 1 - 3));
+        } else {
+            run = 1;
+            rleSymbols.push_back(all[i]);
+            rleExtra.push_back(0);
+        }
+        i += run;
+    }
+    for (size_t i = 0; i < rleSymbols.size(); i++) clFreq[rleSymbols[i]]++;
+    int usedCl = 0;
+    for (int i = 0; i < 19; i++) usedCl += clFreq[i] > 0;
+    if (usedCl < 2) clFreq[clFreq[0] ? 1 : 0] = 1;
+
+    unsigned char clLengths[19];
+    unsigned short clCodes[19];
+    BuildCodeLengths(clFreq, 19, 7, clLengths);
+    BuildCodes(clLengths, 19, clCodes);
+    int hclen = 19;
+    while (hclen > 4 && clLengths[CODE_LENGTH_ORDER[hclen - 1]] == 0) hclen--;
+
+    // Block header
+    writer.write(0, 1);         // BFINAL
+    writer.write(2, 2);         // BTYPE = dynamic Huffman
+    writer.write(hlit - 257, 5);
+    writer.write(hdist - 1, 5);
+    writer.write(hclen - 4, 4);
+    for (int i = 0; i < hclen; i++) writer.write(clLengths[CODE_LENGTH_ORDER[i]], 3);
+    for (size_t i = 0; i < rleSymbols.size(); i++) {
+        int sym = rleSymbols[i];
+        writer.write(clCodes[sym], clLengths[sym]);
+        if (sym == 16) writer.write(rleExtra[i], 2);
+        else if (sym == 17) writer.write(rleExtra[i], 3);
+        else if (sym == 18) writer.write(rleExtra[i], 7);
+    }
+
+    // Compressed data
+    for (size_t i = 0; i < symbols.size(); i++) {
+        const Lz77Symbol& s = symbols[i];
+        if (s.dist == 0) {
+            writer.write(litCodes[s.litLen], litLengths[s.litLen]);
+        } else {
+            int ls = LengthSymbol(s.litLen);
+            writer.write(litCodes[257 + ls], litLengths[257 + ls]);
+            writer.write(s.litLen - LENGTH_BASE[ls], LENGTH_EXTRA[ls]);
+            int ds = DistSymbol(s.dist);
+            writer.write(distCodes[ds], distLengths[ds]);
+            writer.write(s.dist - DIST_BASE[ds], DIST_EXTRA[ds]);
+        }
+    }
+    writer.write(litCodes[256], litLengths[256]);
+}
+
+// ############################################################################################
+// Number of equal leading bytes (at most maxLength), compared eight bytes at a time
+inline int MatchLength(const unsigned char* a, const unsigned char* b, int maxLength) {
+    int len = 0;
+    while (len + 8 <= maxLength) {
+        unsigned long long x, y;
+        memcpy(&x, a + len, 8);
+        memcpy(&y, b + len, 8);
+        if (x != y) return len + (__builtin_ctzll(x ^ y) >> 3);
+        len += 8;
+    }
+    while (len < maxLength && a[len] == b[len]) len++;
+    return len;
+}
+
+// ############################################################################################
+// Compress one independent chunk into non-final deflate blocks, ending byte aligned
+// (an empty stored block, like zlib's Z_SYNC_FLUSH)
+inline void DeflateChunk(const unsigned char* data, size_t length, std::vector<unsigned char>& out) {
+    const int WINDOW = 32768;
+    const int HASH_BITS = 15;
+    const int MAX_CHAIN = 32;
+    const int MIN_MATCH = 3;
+    const int MAX_MATCH = 258;
+    const int NICE_MATCH = 128;         // Stop searching the chain once a match is this long
+    const size_t BLOCK_SYMBOLS = 1 << 16;
+
+    std::vector<int> head(1 << HASH_BITS, -1);
+    std::vector<int> prev(WINDOW, -1);
+    std::vector<Lz77Symbol> symbols;
+    symbols.reserve(std::min(length, BLOCK_SYMBOLS));
+    BitWriter writer(out);
+
+    size_t pos = 0;
+    while (pos < length) {
+        int bestLength = 0, bestDist = 0;
+        unsigned int hash = 0;
+        if (pos + MIN_MATCH <= length) {
+            hash = ((data[pos] << 10) ^ (data[pos + 1] << 5) ^ data[pos + 2]) & ((1 << HASH_BITS) - 1);
+            int candidate = head[hash];
+            int maxLength = static_cast<int>(std::min<size_t>(MAX_MATCH, length - pos));
+            for (int chain = 0; candidate >= 0 && chain < MAX_CHAIN; chain++) {
+                int dist = static_cast<int>(pos) - candidate;
+                if (dist > WINDOW - 1) break;
+                if (data[candidate + bestLength] == data[pos + bestLength]) {
+                    int len = MatchLength(data + candidate, data + pos, maxLength);
+                    if (len > bestLength) {
+                        bestLength = len;
+                        bestDist = dist;
+                        // A match of maxLength cannot be beaten, and testing the next
+                        // candidate at bestLength would read past the chunk
+                        if (len >= NICE_MATCH || len >= maxLength) break;
+                    }
+                }
+                candidate = prev[candidate & (WINDOW - 1)];
+            }
+        }
+
+        size_t advance = 1;
+        Lz77Symbol symbol;
+        if (bestLength >= MIN_MATCH) {
+            symbol.litLen = static_cast<unsigned short>(bestLength);
+            symbol.dist = static_cast<unsigned short>(bestDist);
+            advance = bestLength;
+        } else {
+            symbol.litLen = data[pos];
+            symbol.dist = 0;
+        }
+        symbols.push_back(symbol);
+
+        // Insert every covered position into the hash chains
+        for (size_t k = 0; k < advance; k++, pos++) {
+            if (pos + MIN_MATCH <= length) {
+                unsigned int h = ((data[pos] << 10) ^ (data[pos + 1] << 5) ^ data[pos + 2]) & ((1 << HASH_BITS) - 1);
+                prev[pos & (WINDOW - 1)] = head[h];
+                head[h] = static_cast<int>(pos);
+            }
+        }
+
+        if (symbols.size() >= BLOCK_SYMBOLS) {
+            WriteDynamicBlock(writer, symbols);
+            symbols.clear();
+        }
+    }
+    if (!symbols.empty()) WriteDynamicBlock(writer, symbols);
+
+    // Empty stored block to reach a byte boundary
+    writer.write(0, 1);
+    writer.write(0, 2);
+    writer.alignToByte();
+    out.push_back(0x00); out.push_back(0x00);
+    out.push_back(0xFF); out.push_back(0xFF);
+}
+
+// ############################################################################################
+// Paeth predictor from the PNG specification
+inline unsigned char Paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<unsigned char>(a);
+    if (pb <= pc) return static_cast<unsigned char>(b);
+    return static_cast<unsigned char>(c);
+}
+
+// ############################################################################################
+// Filter one row with every PNG filter type and keep the one with the smallest sum of
+// absolute (signed) residuals. 'out' receives the filter byte followed by the row;
+// 'scratch' must hold 'stride' bytes. The first row passes NULL for 'above'.
+inline void FilterRow(const unsigned char* row, const unsigned char* above, int stride, int bpp,
+                      unsigned char* out, unsigned char* scratch) {
+    unsigned long bestScore = ~0ul;
+    for (int filter = 0; filter < 5; filter++) {
+        if (!above && (filter == 2 || filter == 4)) continue; // Same as None / Sub on the first row
+        int i = 0;
+        switch (filter) {
+            case 0:
+                memcpy(scratch, row, stride);
+                break;
+            case 1:
+                for (; i < bpp; i++) scratch[i] = row[i];
+                for (; i < stride; i++) scratch[i] = row[i] - row[i - bpp];
+                break;
+            case 2:
+                for (; i < stride; i++) scratch[i] = row[i] - above[i];
+                break;
+            case 3:
+                for (; i < bpp; i++) scratch[i] = row[i] - ((above ? above[i] : 0) >> 1);
+                if (above) for (; i < stride; i++) scratch[i] = row[i] - ((row[i - bpp] + above[i]) >> 1);
+                else for (; i < stride; i++) scratch[i] = row[i] - (row[i - bpp] >> 1);
+                break;
+            case 4:
+                for (; i < bpp; i++) scratch[i] = row[i] - above[i];
+                for (; i < stride; i++) scratch[i] = row[i] - Paeth(row[i - bpp], above[i], above[i - bpp]);
+                break;
+        }
+
+        unsigned long score = 0;
+        for (i = 0; i < stride; i++) score += scratch[i] < 128 ? scratch[i] : 256 - scratch[i];
+        if (score < bestScore) {
+            bestScore = score;
+            out[0] = static_cast<unsigned char>(filter);
+            memcpy(out + 1, scratch, stride);
+        }
+    }
+}
+
+inline void PutU32(std::vector<unsigned char>& out, unsigned int value) {
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+inline void PutChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t length) {
+    PutU32(out, static_cast<unsigned int>(length));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (length) out.insert(out.end(), data, data + length);
+    PutU32(out, Crc32(&out[start], length + 4));
+}
+
+// ############################################################################################
+// Table-driven Huffman decoder: one lookup of 'maxLength' bits gives the symbol and its
+// code length (entries pack symbol | length << 9)
+struct HuffmanTable {
+    std::vector<unsigned short> entries;
+    int maxLength;
+
+    bool build(const unsigned char* lengths, int count) {
+        maxLength = 0;
+        for (int i = 0; i < count; i++) maxLength = std::max<int>(maxLength, lengths[i]);
+        if (maxLength == 0) maxLength = 1;
+
+        unsigned short codes[320];
+        BuildCodes(lengths, count, codes);
+
+        // Reject over-subscribed codes
+        long long kraft = 0;
+        for (int i = 0; i < count; i++) if (lengths[i]) kraft += 1ll << (15 - lengths[i]);
+        if (kraft > (1ll << 15)) return false;
+
+        entries.assign(static_cast<size_t>(1) << maxLength, 0);
+        for (int i = 0; i < count; i++) {
+            if (!lengths[i]) continue;
+            unsigned short entry = static_cast<unsigned short>(i | (lengths[i] << 9));
+            for (size_t k = codes[i]; k < entries.size(); k += static_cast<size_t>(1) << lengths[i]) {
+                entries[k] = entry;
+            }
+        }
+        return true;
+    }
+};
+
+// ############################################################################################
+// LSB-first bit reader for inflate; reads past the end return zero bits and set 'overrun'
+class BitReader {
+public:
+    BitReader(const unsigned char* d, size_t n) : data(d), size(n), pos(0), bitBuffer(0), bitCount(0), overrun(false) {}
+
+    unsigned int peek(int count) {
+        while (bitCount < count) {
+            unsigned long long byte = 0;
+            if (pos < size) byte = data[pos];
+            else overrun = true;
+            pos++;
+            bitBuffer |= byte << bitCount;
+            bitCount += 8;
+        }
+        return static_cast<unsigned int>(bitBuffer & ((1ull << count) - 1));
+    }
+
+    void consume(int count) {
+        bitBuffer >>= count;
+        bitCount -= count;
+    }
+
+    unsigned int read(int count) {
+        if (count == 0) return 0;
+        unsigned int value = peek(count);
+        consume(count);
+        return value;
+    }
+
+    int decode(const HuffmanTable& table) {
+        unsigned short entry = table.entries[peek(table.maxLength)];
+        int length = entry >> 9;
+        if (length == 0) return -1;
+        consume(length);
+        return entry & 0x1FF;
+    }
+
+    // Drop the bits of the current byte and return the position of the next whole byte
+    size_t alignToByte() {
+        consume(bitCount & 7);
+        return pos - bitCount / 8;
+    }
+
+    void seek(size_t bytePos) {
+        pos = bytePos;
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+
+    bool overran() const { return overrun; }
+
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+    unsigned long long bitBuffer;
+    int bitCount;
+    bool overrun;
+};
+
+// ############################################################################################
+// Decompress a raw deflate stream (stored, fixed and dynamic blocks), appending to 'out'
+inline bool Inflate(const unsigned char* data, size_t size, std::vector<unsigned char>& out) {
+    BitReader reader(data, size);
+    HuffmanTable litTable, distTable, clTable;
+
+    bool last = false;
+    while (!last) {
+        last = reader.read(1) != 0;
+        int type = reader.read(2);
+
+        if (type == 0) {
+            size_t start = reader.alignToByte();
+            if (start + 4 > size) return false;
+            unsigned int length = data[start] | (data[start + 1] << 8);
+            unsigned int check = data[start + 2] | (data[start + 3] << 8);
+            if ((length ^ 0xFFFF) != check || start + 4 + length > size) return false;
+            out.insert(out.end(), data + start + 4, data + start + 4 + length);
+            reader.seek(start + 4 + length);
+            continue;
+        }
+
+        unsigned char litLengths[288], distLengths[32];
+        if (type == 1) {
+            for (int i = 0; i < 288; i++) litLengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+            for (int i = 0; i < 32; i++) distLengths[i] = 5;
+            litTable.build(litLengths, 288);
+            distTable.build(distLengths, 32);
+        } else if (type == 2) {
+            int hlit = reader.read(5) + 257;
+            int hdist = reader.read(5) + 1;
+            int hclen = reader.read(4) + 4;
+            unsigned char clLengths[19] = { 0 };
+            for (int i = 0; i < hclen; i++) clLengths[CODE_LENGTH_ORDER[i]] = static_cast<unsigned char>(reader.read(3));
+            if (!clTable.build(clLengths, 19)) return false;
+
+            unsigned char lengths[320];
+            int n = 0;
+            while (n < hlit + hdist) {
+                int sym = reader.decode(clTable);
+                if (sym < 0 || reader.overran()) return false;
+                if (sym < 16) {
+                    lengths[n++] = static_cast<unsigned char>(sym);
+                    continue;
+                }
+                int repeat, value = 0;
+                if (sym == 16) {
+                    if (n == 0) return false;
+                    value = lengths[n - 1];
+                    repeat = 3 + reader.read(2);
+                } else if (sym == 17) {
+                    repeat = 3 + reader.read(3);
+                } else {
+                    repeat = 11 + reader.read(7);
+                }
+                if (n + repeat > hlit + hdist) return false;
+                while (repeat--) lengths[n++] = static_cast<unsigned char>(value);
+            }
+            memset(litLengths, 0, sizeof(litLengths));
+            memset(distLengths, 0, sizeof(distLengths));
+            memcpy(litLengths, lengths, hlit);
+            memcpy(distLengths, lengths + hlit, hdist);
+            if (!litTable.build(litLengths, 288) || !distTable.build(distLengths, 32)) return false;
+        } else {
+            return false;
+        }
+
+        for (;;) {
+            int sym = reader.decode(litTable);
+            if (sym < 0 || reader.overran()) return false;
+            if (sym < 256) {
+                out.push_back(static_cast<unsigned char>(sym));
+            } else if (sym == 256) {
+                break;
+            } else {
+                sym -= 257;
+                if (sym >= 29) return false;
+                int length = LENGTH_BASE[sym] + reader.read(LENGTH_EXTRA[sym]);
+                int ds = reader.decode(distTable);
+                if (ds < 0 || ds >= 30) return false;
+                size_t dist = DIST_BASE[ds] + reader.read(DIST_EXTRA[ds]);
+                if (dist > out.size()) return false;
+                size_t from = out.size() - dist;
+                for (int k = 0; k < length; k++) out.push_back(out[from + k]);
+            }
+        }
+    }
+    return !reader.overran();
+}
+
+// ############################################################################################
+// Undo one row's filter in place ('above' is the previous reconstructed row or NULL)
+inline bool UnfilterRow(int filter, unsigned char* row, const unsigned char* above, size_t stride, int bpp) {
+    switch (filter) {
+        case 0:
+            break;
+        case 1:
+            for (size_t i = bpp; i < stride; i++) row[i] += row[i - bpp];
+            break;
+        case 2:
+            if (above) for (size_t i = 0; i < stride; i++) row[i] += above[i];
+            break;
+        case 3:
+            for (size_t i = 0; i < stride; i++) {
+                int a = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+                int b = above ? above[i] : 0;
+                row[i] += static_cast<unsigned char>((a + b) >> 1);
+            }
+            break;
+        case 4:
+            for (size_t i = 0; i < stride; i++) {
+                int a = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+                int b = above ? above[i] : 0;
+                int c = (above && i >= static_cast<size_t>(bpp)) ? above[i - bpp] : 0;
+                row[i] += Paeth(a, b, c);
+            }
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+inline unsigned int GetU32(const unsigned char* p) {
+    return (static_cast<unsigned int>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+} // namespace png_detail
+
+// ############################################################################################
+// Timing and size information from the last encode
+struct PngEncodeStats {
+    size_t rawBytes;            // Uncompressed RGB bytes
+    size_t fileBytes;           // Size of the encoded PNG
+    double seconds;             // Filtering + compression time
+
+    double megabytesPerSecond() const {
+        return seconds > 0.0 ? rawBytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+// ############################################################################################
+// Encode 8-bit RGB pixels (rows top to bottom) into a PNG file image in memory
+inline void EncodePNG(const unsigned char* rgb, int width, int height,
+                      std::vector<unsigned char>& png, PngEncodeStats* stats = NULL) {
+    using namespace png_detail;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const int bpp = 3;
+    const size_t stride = static_cast<size_t>(width) * bpp;
+    const size_t filteredStride = stride + 1;
+
+    // Parallel adaptive row filtering
+    std::vector<unsigned char> filtered(filteredStride * height);
+    #pragma omp parallel
+    {
+        std::vector<unsigned char> scratch(stride);
+        #pragma omp for
+        for (int y = 0; y < height; y++) {
+            FilterRow(rgb + y * stride, y > 0 ? rgb + (y - 1) * stride : NULL,
+                      static_cast<int>(stride), bpp, &filtered[y * filteredStride], scratch.data());
+        }
+    }
+
+    // Split into row chunks of at least 256KB, several per thread, and compress them in parallel
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    int rowsPerChunk = std::max<int>(1, static_cast<int>((256 * 1024) / filteredStride));
+    rowsPerChunk = std::max(rowsPerChunk, (height + 4 * threads - 1) / (4 * threads));
+    rowsPerChunk = std::min(rowsPerChunk, std::max(height, 1));
+    int chunkCount = (height + rowsPerChunk - 1) / rowsPerChunk;
+
+    std::vector<std::vector<unsigned char> > compressed(chunkCount);
+    std::vector<unsigned int> adlers(chunkCount);
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < chunkCount; c++) {
+        int firstRow = c * rowsPerChunk;
+        int rows = std::min(rowsPerChunk, height - firstRow);
+        const unsigned char* data = &filtered[firstRow * filteredStride];
+        size_t length = rows * filteredStride;
+        compressed[c].reserve(length / 2);
+        DeflateChunk(data, length, compressed[c]);
+        adlers[c] = Adler32(data, length);
+    }
+
+    // zlib stream: header, concatenated chunks, final empty block, Adler-32
+    std::vector<unsigned char> zlib;
+    size_t total = 0;
+    for (int c = 0; c < chunkCount; c++) total += compressed[c].size();
+    zlib.reserve(total + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    unsigned int adler = 1;
+    for (int c = 0; c < chunkCount; c++) {
+        zlib.insert(zlib.end(), compressed[c].begin(), compressed[c].end());
+        int rows = std::min(rowsPerChunk, height - c * rowsPerChunk);
+        adler = Adler32Combine(adler, adlers[c], rows * filteredStride);
+    }
+    zlib.push_back(0x03); // Final fixed-Huffman block holding only the end-of-block code
+    zlib.push_back(0x00);
+    PutU32(zlib, adler);
+
+    // PNG container
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    png.assign(signature, signature + 8);
+    unsigned char ihdr[13];
+    ihdr[0] = width >> 24; ihdr[1] = width >> 16; ihdr[2] = width >> 8; ihdr[3] = width;
+    ihdr[4] = height >> 24; ihdr[5] = height >> 16; ihdr[6] = height >> 8; ihdr[7] = height;
+    ihdr[8] = 8;    // Bit depth
+    ihdr[9] = 2;    // Color type: RGB
+    ihdr[10] = 0;   // Compression: deflate
+    ihdr[11] = 0;   // Filter method: adaptive
+    ihdr[12] = 0;   // No interlace
+    PutChunk(png, "IHDR", ihdr, sizeof(ihdr));
+    PutChunk(png, "IDAT", zlib.data(), zlib.size());
+    PutChunk(png, "IEND", NULL, 0);
+
+    if (stats) {
+        stats->rawBytes = stride * height;
+        stats->fileBytes = png.size();
+        stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+// ############################################################################################
+// Encode and write a PNG file
+inline bool WritePNG(const std::string& filename, const unsigned char* rgb, int width, int height,
+                     PngEncodeStats* stats = NULL) {
+    std::vector<unsigned char> png;
+    EncodePNG(rgb, width, height, png, stats);
+
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+    bool ok = fwrite(png.data(), 1, png.size(), file) == png.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error: Failed to write image data" << std::endl;
+    }
+    return ok;
+}
+
+// ############################################################################################
+// Decode a PNG file image into 8-bit RGB. Supports 8-bit, non-interlaced grayscale, RGB,
+// palette, gray + alpha and RGBA images (alpha is dropped).
+inline bool DecodePNG(const unsigned char* data, size_t size, std::vector<unsigned char>& rgb,
+                      int& width, int& height) {
+    using namespace png_detail;
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (size < 8 || memcmp(data, signature, 8) != 0) {
+        std::cerr << "Error: Not a PNG file" << std::endl;
+        return false;
+    }
+
+    int bitDepth = 0, colorType = 0, interlace = 0;
+    std::vector<unsigned char> zlib, palette;
+    width = height = 0;
+    for (size_t pos = 8; pos + 12 <= size;) {
+        unsigned int length = GetU32(data + pos);
+        const unsigned char* type = data + pos + 4;
+        const unsigned char* body = data + pos + 8;
+        if (pos + 12 + static_cast<size_t>(length) > size) break;
+        if (memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+            width = static_cast<int>(GetU32(body));
+            height = static_cast<int>(GetU32(body + 4));
+            bitDepth = body[8];
+            colorType = body[9];
+            interlace = body[12];
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            palette.assign(body, body + length);
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            zlib.insert(zlib.end(), body, body + length);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        pos += 12 + length;
+    }
+
+    int channels = colorType == 0 ? 1 : colorType == 2 ? 3 : colorType == 3 ? 1 : colorType == 4 ? 2 : colorType == 6 ? 4 : 0;
+    if (width <= 0 || height <= 0 || bitDepth != 8 || channels == 0 || interlace != 0 || zlib.size() < 2) {
+        std::cerr << "Error: Unsupported PNG (only 8-bit, non-interlaced images are supported)" << std::endl;
+        return false;
+    }
+
+    size_t stride = static_cast<size_t>(width) * channels;
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    if (!Inflate(zlib.data() + 2, zlib.size() - 2, raw) || raw.size() < (stride + 1) * height) {
+        std::cerr << "Error: Corrupt PNG image data" << std::endl;
+        return false;
+    }
+
+    // Unfiltering is sequential (each row depends on the previous one); expansion to RGB is not
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = &raw[y * (stride + 1)];
+        if (!UnfilterRow(row[0], row + 1, y > 0 ? row - stride : NULL, stride, channels)) {
+            std::cerr << "Error: Invalid PNG filter type" << std::endl;
+            return false;
+        }
+    }
+
+    rgb.resize(static_cast<size_t>(width) * height * 3);
+    #pragma omp parallel for
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = &raw[y * (stride + 1) + 1];
+        unsigned char* dst = &rgb[static_cast<size_t>(y) * width * 3];
+        for (int x = 0; x < width; x++, dst += 3) {
+            switch (colorType) {
+                case 0: case 4: dst[0] = dst[1] = dst[2] = src[x * channels]; break;
+                case 2: case 6: memcpy(dst, src + x * channels, 3); break;
+                case 3: {
+                    size_t entry = src[x] * 3u;
+                    if (entry + 2 < palette.size()) memcpy(dst, &palette[entry], 3);
+                    else dst[0] = dst[1] = dst[2] = 0;
+                    break;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// ############################################################################################
+// Read a PNG file into 8-bit RGB
+inline bool ReadPNG(const std::string& filename, std::vector<unsigned char>& rgb, int& width, int& height) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Error: Could not open file: " << filename << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> data;
+    unsigned char buffer[1 << 16];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) data.insert(data.end(), buffer, buffer + n);
+    fclose(file);
+    return DecodePNG(data.data(), data.size(), rgb, width, height);
+}
+
+#endif // PNG_IO_H
@@ -0,0 +1,126 @@
+#ifndef PPM_TEXT_H
+#define PPM_TEXT_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+// ############################################################################################
+// Fast ASCII PPM (P3) output. Each byte value is looked up in a table holding its decimal
+// digits, so a pixel is three small copies instead of three formatted stream insertions.
+// Rows are formatted in parallel into a large batch buffer at offsets from a prefix sum,
+// and each batch goes to the file in one unbuffered write.
+// The output is byte-identical to "r g b\n" per pixel as written with iostreams.
+
+namespace ppm_text_detail {
+
+struct DecimalTable {
+    char digits[256][4];        // Decimal digits, left aligned
+    unsigned char length[256];  // Number of digits (1 - 3)
+
+    DecimalTable() {
+        for (int v = 0; v < 256; v++) {
+            length[v] = static_cast<unsigned char>(snprintf(digits[v], sizeof(digits[v]), "%d", v));
+        }
+    }
+};
+
+inline const DecimalTable& Decimals() {
+    static const DecimalTable table;
+    return table;
+}
+
+} // namespace ppm_text_detail
+
+// ############################################################################################
+// Exact number of text bytes for 'pixelCount' pixels
+inline size_t P3TextLength(const unsigned char* rgb, size_t pixelCount) {
+    const ppm_text_detail::DecimalTable& table = ppm_text_detail::Decimals();
+    size_t length = pixelCount * 3; // Two spaces and a newline per pixel
+    for (size_t i = 0; i < pixelCount * 3; i++) length += table.length[rgb[i]];
+    return length;
+}
+
+// ############################################################################################
+// Format pixels as "r g b\n" lines into 'out', returns the number of bytes written.
+// Digits are copied four bytes at a time; the bytes past a number are always overwritten
+// by what follows, except after the last pixel, which is copied exactly so that rows
+// formatted concurrently into one buffer never touch each other.
+inline size_t FormatP3Pixels(const unsigned char* rgb, size_t pixelCount, char* out) {
+    const ppm_text_detail::DecimalTable& table = ppm_text_detail::Decimals();
+    char* p = out;
+    for (size_t i = 0; i + 1 < pixelCount; i++, rgb += 3) {
+        memcpy(p, table.digits[rgb[0]], 4);
+        p += table.length[rgb[0]];
+        *p++ = ' ';
+        memcpy(p, table.digits[rgb[1]], 4);
+        p += table.length[rgb[1]];
+        *p++ = ' ';
+        memcpy(p, table.digits[rgb[2]], 4);
+        p += table.length[rgb[2]];
+        *p++ = '\n';
+    }
+    if (pixelCount > 0) {
+        for (int c = 0; c < 3; c++) {
+            memcpy(p, table.digits[rgb[c]], table.length[rgb[c]]);
+            p += table.length[rgb[c]];
+            *p++ = c < 2 ? ' ' : '\n';
+        }
+    }
+    return static_cast<size_t>(p - out);
+}
+
+// ############################################################################################
+// Write 8-bit RGB pixels as an ASCII PPM. Rows are formatted in batches of about
+// 'batchBytes' of text, so memory stays bounded for large images.
+inline bool WritePPMText(const std::string& filename, const unsigned char* rgb, int width, int height,
+                         size_t batchBytes = 16u << 20) {
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Error: Could not open file for writing: " << filename << std::endl;
+        return false;
+    }
+    setvbuf(file, NULL, _IONBF, 0); // Batches are large, skip the stdio copy
+
+    char header[64];
+    int headerLength = snprintf(header, sizeof(header), "P3\n%d %d\n255\n", width, height);
+    bool ok = fwrite(header, 1, headerLength, file) == static_cast<size_t>(headerLength);
+
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    const size_t maxRowText = static_cast<size_t>(width) * 12; // "255 255 255\n"
+    const int batchRows = std::max<int>(1, static_cast<int>(batchBytes / std::max<size_t>(maxRowText, 1)));
+
+    std::vector<char> text;
+    std::vector<size_t> offsets;
+    for (int y0 = 0; ok && y0 < height; y0 += batchRows) {
+        int rows = std::min(batchRows, height - y0);
+        const unsigned char* batch = rgb + y0 * rowBytes;
+
+        // Exact length of each row, then a prefix sum gives every row its output offset
+        offsets.resize(rows + 1);
+        offsets[0] = 0;
+        #pragma omp parallel for
+        for (int r = 0; r < rows; r++) {
+            offsets[r + 1] = P3TextLength(batch + r * rowBytes, width);
+        }
+        for (int r = 0; r < rows; r++) offsets[r + 1] += offsets[r];
+
+        text.resize(offsets[rows]);
+        #pragma omp parallel for
+        for (int r = 0; r < rows; r++) {
+            FormatP3Pixels(batch + r * rowBytes, width, &text[offsets[r]]);
+        }
+        ok = fwrite(text.data(), 1, offsets[rows], file) == offsets[rows];
+    }
+
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error: Failed to write image data" << std::endl;
+    }
+    return ok;
+}
+
+#endif // PPM_TEXT_H
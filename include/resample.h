@@ -0,0 +1,143 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ############################################################################################
+// Separable Lanczos-3 resampling of interleaved linear RGB float images.
+// Weights are precomputed once per output column and row. The horizontal pass handles one
+// pixel (3 channels, padded to 4 lanes) per SSE step; the vertical pass blends whole rows,
+// 4 floats per step. Results are clamped at zero, since the negative lobes of the filter
+// can push dark pixels below it.
+
+namespace resample_detail {
+
+inline float Lanczos3(float x) {
+    const float pi = 3.14159265f;
+    x = std::fabs(x);
+    if (x < 1e-6f) return 1.0f;
+    if (x >= 3.0f) return 0.0f;
+    float px = pi * x;
+    return 3.0f * std::sin(px) * std::sin(px / 3.0f) / (px * px);
+}
+
+// ############################################################################################
+// Filter taps for every output sample: 'first' input index plus 'count' normalized weights
+struct FilterTaps {
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<float> weights;     // 'maxTaps' entries per output sample
+    int maxTaps;
+
+    void build(int inputSize, int outputSize) {
+        float scale = static_cast<float>(inputSize) / outputSize;
+        float filterScale = std::max(scale, 1.0f);      // Widen the filter when downsampling
+        float support = 3.0f * filterScale;
+        maxTaps = static_cast<int>(std::ceil(support * 2.0f)) + 1;
+
+        first.resize(outputSize);
+        count.resize(outputSize);
+        weights.assign(static_cast<size_t>(outputSize) * maxTaps, 0.0f);
+        for (int i = 0; i < outputSize; i++) {
+            float center = (i + 0.5f) * scale - 0.5f;
+            int lo = std::max(static_cast<int>(std::floor(center - support)) + 1, 0);
+            int hi = std::min(static_cast<int>(std::floor(center + support)), inputSize - 1);
+            int n = std::min(hi - lo + 1, maxTaps);
+            float* w = &weights[static_cast<size_t>(i) * maxTaps];
+            float total = 0.0f;
+            for (int k = 0; k < n; k++) {
+                w[k] = Lanczos3((lo + k - center) / filterScale);
+                total += w[k];
+            }
+            for (int k = 0; k < n; k++) w[k] /= total;
+            first[i] = lo;
+            count[i] = n;
+        }
+    }
+};
+
+} // namespace resample_detail
+
+// ############################################################################################
+// Resample 'src' (srcWidth x srcHeight RGB floats) into 'dst' (dstWidth x dstHeight RGB)
+inline void ResampleRGB(const float* src, int srcWidth, int srcHeight,
+                        float* dst, int dstWidth, int dstHeight) {
+    using namespace resample_detail;
+    FilterTaps columns, rows;
+    columns.build(srcWidth, dstWidth);
+    rows.build(srcHeight, dstHeight);
+
+    // Horizontal pass into srcHeight x dstWidth, one padding float so 4-lane loads stay in bounds
+    size_t srcRow = static_cast<size_t>(srcWidth) * 3;
+    size_t dstRow = static_cast<size_t>(dstWidth) * 3;
+    std::vector<float> horizontal(static_cast<size_t>(srcHeight) * dstRow + 1);
+
+    #pragma omp parallel
+    {
+        std::vector<float> padded(srcRow + 1, 0.0f);
+
+        #pragma omp for
+        for (int y = 0; y < srcHeight; y++) {
+            std::copy(src + y * srcRow, src + (y + 1) * srcRow, padded.begin());
+            float* out = &horizontal[y * dstRow];
+            for (int x = 0; x < dstWidth; x++) {
+                const float* w = &columns.weights[static_cast<size_t>(x) * columns.maxTaps];
+                const float* in = &padded[columns.first[x] * 3];
+                int n = columns.count[x];
+#if defined(__SSE2__)
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < n; k++) {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in + k * 3), _mm_set1_ps(w[k])));
+                }
+                float lanes[4];
+                _mm_storeu_ps(lanes, sum);
+                out[x * 3] = lanes[0];
+                out[x * 3 + 1] = lanes[1];
+                out[x * 3 + 2] = lanes[2];
+#else
+                float r = 0.0f, g = 0.0f, b = 0.0f;
+                for (int k = 0; k < n; k++) {
+                    r += in[k * 3] * w[k];
+                    g += in[k * 3 + 1] * w[k];
+                    b += in[k * 3 + 2] * w[k];
+                }
+                out[x * 3] = r;
+                out[x * 3 + 1] = g;
+                out[x * 3 + 2] = b;
+#endif
+            }
+        }
+    }
+
+    // Vertical pass: each output row is a weighted sum of whole intermediate rows
+    #pragma omp parallel for
+    for (int y = 0; y < dstHeight; y++) {
+        const float* w = &rows.weights[static_cast<size_t>(y) * rows.maxTaps];
+        const float* in = &horizontal[rows.first[y] * dstRow];
+        int n = rows.count[y];
+        float* out = dst + y * dstRow;
+        size_t i = 0;
+#if defined(__SSE2__)
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= dstRow; i += 4) {
+            __m128 sum = zero;
+            for (int k = 0; k < n; k++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in + k * dstRow + i), _mm_set1_ps(w[k])));
+            }
+            _mm_storeu_ps(out + i, _mm_max_ps(sum, zero));
+        }
+#endif
+        for (; i < dstRow; i++) {
+            float sum = 0.0f;
+            for (int k = 0; k < n; k++) sum += in[k * dstRow + i] * w[k];
+            out[i] = std::max(sum, 0.0f);
+        }
+    }
+}
+
+#endif // RESAMPLE_H
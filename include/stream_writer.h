@@ -0,0 +1,140 @@
+#ifndef STREAM_WRITER_H
+#define STREAM_WRITER_H
+
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iostream>
+#include "mem_stats.h"
+
+// ############################################################################################
+// Summary of a streamed write
+struct StreamStats {
+    size_t bytesWritten;
+    double writeSeconds;        // Time the writer thread spent writing
+    double stallSeconds;        // Time the producer waited for a free block
+    int bandRows;               // Rows per block
+};
+
+// ############################################################################################
+// Writes blocks of bytes to a file on a dedicated thread, in the order they are submitted.
+// A fixed pool of blocks bounds memory: acquire() blocks while all of them are queued or
+// being written, so a producer can never run more than 'blockCount' blocks ahead of the disk.
+class StreamWriter {
+public:
+    struct Block {
+        std::vector<unsigned char> data;
+        size_t used;
+    };
+
+    StreamWriter(FILE* f, size_t blockBytes, int blockCount = 3)
+        : file(f), blocks(blockCount), stopping(false), failed(false),
+          bytesWritten(0), writeSeconds(0.0), stallSeconds(0.0), memory(MEM_FRAMEBUFFER) {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            blocks[i].data.resize(blockBytes);
+            blocks[i].used = 0;
+            freeBlocks.push_back(&blocks[i]);
+            memory.Add(VectorBytes(blocks[i].data));
+        }
+        writer = std::thread(&StreamWriter::writerLoop, this);
+    }
+
+    ~StreamWriter() {
+        finish();
+    }
+
+    // ############################################################################################
+    // Get an empty block to fill, waiting for the writer if none is free
+    Block* acquire() {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        freeCondition.wait(lock, [this] { return !freeBlocks.empty(); });
+        Block* block = freeBlocks.front();
+        freeBlocks.pop_front();
+        stallSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        block->used = 0;
+        return block;
+    }
+
+    // ############################################################################################
+    // Queue a filled block (its first 'used' bytes) for writing
+    void submit(Block* block) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(block);
+        }
+        pendingCondition.notify_one();
+    }
+
+    // ############################################################################################
+    // Write everything still queued and stop the writer thread; false if any write failed
+    bool finish() {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            pendingCondition.notify_one();
+            writer.join();
+        }
+        return !failed;
+    }
+
+    size_t getBytesWritten() const { return bytesWritten; }
+    double getWriteSeconds() const { return writeSeconds; }     // Time the writer spent in fwrite
+    double getStallSeconds() const { return stallSeconds; }     // Time producers waited for blocks
+
+private:
+    FILE* file;
+    std::vector<Block> blocks;
+    std::deque<Block*> freeBlocks;
+    std::deque<Block*> pending;
+    std::mutex mutex;
+    std::condition_variable freeCondition;
+    std::condition_variable pendingCondition;
+    std::thread writer;
+    bool stopping;
+    bool failed;
+    size_t bytesWritten;
+    double writeSeconds;
+    double stallSeconds;
+    MemAccount memory;
+
+    StreamWriter(const StreamWriter&) = delete;
+    StreamWriter& operator=(const StreamWriter&) = delete;
+
+    // ############################################################################################
+    // Writer thread: pop blocks in order, write them, hand them back to the free pool
+    void writerLoop() {
+        for (;;) {
+            Block* block;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                pendingCondition.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (pending.empty()) return;
+                block = pending.front();
+                pending.pop_front();
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            if (!failed && fwrite(block->data.data(), 1, block->used, file) != block->used) {
+                std::cerr << "Error: Failed to write image data" << std::endl;
+                failed = true;
+            }
+            writeSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            bytesWritten += block->used;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeBlocks.push_back(block);
+            }
+            freeCondition.notify_one();
+        }
+    }
+};
+
+#endif // STREAM_WRITER_H
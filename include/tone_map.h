@@ -0,0 +1,79 @@
+#ifndef TONE_MAP_H
+#define TONE_MAP_H
+
+#include <cmath>
+#include <algorithm>
+#include <string>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ############################################################################################
+// Tone mapping operators applied to linear radiance before gamma and quantization
+enum ToneMapOperator {
+    TONEMAP_CLAMP = 0,      // Clamp to [0, 1] (clips highlights like the original renderer)
+    TONEMAP_REINHARD        // x / (1 + x), compresses highlights instead of clipping
+};
+
+struct ToneMapSettings {
+    ToneMapOperator op;
+    float exposure;         // Linear multiplier applied before the operator
+    float gamma;            // Display gamma, 2.0 uses a fast square root
+
+    ToneMapSettings() : op(TONEMAP_CLAMP), exposure(1.0f), gamma(2.0f) {}
+};
+
+// ############################################################################################
+// Parse "clamp" or "reinhard"
+inline bool ParseToneMapOperator(const std::string& name, ToneMapOperator& op) {
+    if (name == "clamp") { op = TONEMAP_CLAMP; return true; }
+    if (name == "reinhard") { op = TONEMAP_REINHARD; return true; }
+    return false;
+}
+
+// ############################################################################################
+// Scalar reference for one channel value
+inline unsigned char ToneMapValue(float value, const ToneMapSettings& settings, float scale) {
+    float x = value * scale * settings.exposure;
+    if (settings.op == TONEMAP_REINHARD) x = x / (1.0f + x);
+    x = std::min(std::max(x, 0.0f), 1.0f);
+    x = settings.gamma == 2.0f ? std::sqrt(x) : std::pow(x, 1.0f / settings.gamma);
+    return static_cast<unsigned char>(255.99f * x);
+}
+
+// ############################################################################################
+// Tone map, gamma correct and quantize 'count' floats (a whole row of interleaved RGB)
+// into bytes. 'scale' normalizes accumulated buffers (1 / number of accumulated frames).
+// The SSE2 path converts 16 values per iteration; other gammas fall back to scalar code.
+inline void ToneMapRow(const float* in, unsigned char* out, int count,
+                       const ToneMapSettings& settings, float scale = 1.0f) {
+    int i = 0;
+#if defined(__SSE2__)
+    if (settings.gamma == 2.0f) {
+        const __m128 mul = _mm_set1_ps(scale * settings.exposure);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 quant = _mm_set1_ps(255.99f);
+        const bool reinhard = settings.op == TONEMAP_REINHARD;
+
+        for (; i + 16 <= count; i += 16) {
+            __m128i q[4];
+            for (int k = 0; k < 4; k++) {
+                __m128 x = _mm_mul_ps(_mm_loadu_ps(in + i + 4 * k), mul);
+                if (reinhard) x = _mm_div_ps(x, _mm_add_ps(one, x));
+                x = _mm_min_ps(_mm_max_ps(x, zero), one);
+                x = _mm_mul_ps(_mm_sqrt_ps(x), quant);
+                q[k] = _mm_cvttps_epi32(x);
+            }
+            __m128i lo = _mm_packs_epi32(q[0], q[1]);
+            __m128i hi = _mm_packs_epi32(q[2], q[3]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = ToneMapValue(in[i], settings, scale);
+    }
+}
+
+#endif // TONE_MAP_H
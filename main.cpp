@@ -18,7 +18,11 @@
 #include "file_utils.h"
 #include "math_utils.h"
 #include "models/OFFReader.h"
+#include "mesh_normals.h"
+#include "mesh_weld.h"
+#include "mesh_optimize.h"
 #include <vector>
+#include <chrono>
 
 // Include our new components
 #include "MeshSlicer.h"
@@ -43,15 +47,22 @@ GLuint ShaderProgram; // Make ShaderProgram a global variable
 // ############################################################################################
 // ############################################################################################
 /*			 Model variables			 */
-OffModel* model = nullptr;
+Vector3f modelBoundsMin(0, 0, 0);           // --> bounds of the loaded model
+Vector3f modelBoundsMax(0, 0, 0);
+float modelExtent = 0.0f;                   // --> largest side of the bounds, 0 without a model
 std::vector<Vector3f> modelVertices;        // --> store the loaded vertices
 std::vector<Vector3f> modelNormals;         // --> store the model normals for each vertex
 std::vector<Vector3f> faceNormals;          // --> calculate the face normals
 std::vector<unsigned int> modelIndices;     // --> store the indices for the triangles
+std::unique_ptr<MeshBinary> modelBinary;    // --> mapped binary mesh, used in place of the empty arrays above
 int vertexCount = 0;                        // --> number of vertices
 int indexCount = 0;                         // --> number of indices
 char modelPath[256] = "models/2oar.off";    // --> path name
 bool modelLoaded = false;                   // --> flag to check if model is loaded || model == nullptr
+NormalWeighting modelNormalWeighting = NORMAL_WEIGHT_UNIFORM;  // --> vertex normal weighting for OFF models
+bool modelWeldVertices = true;              // --> weld duplicate vertices of OFF models on load
+float modelWeldTolerance = 0.0f;            // --> weld distance relative to the model extent (0 = exact)
+bool modelOptimizeOrder = true;             // --> reorder triangles and vertices for the vertex cache on load
 
 // Render mode (0 = solid, 1 = wireframe)
 int renderMode = 0;
@@ -110,7 +121,7 @@ static float planeDistances[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 // Our new components
 MeshSlicer meshSlicer;
 RayTracer* rayTracer = nullptr;
-std::vector<unsigned char> rayTracedImage;
+PixelBuffer rayTracedImage;
 
 // UI state for our new features
 bool showMeshSlicingUI = false;
@@ -163,100 +174,123 @@ void computeFPS()
     }
 }
 
-// Calculate the normal of a face defined by three vertices
-Vector3f CalculateFaceNormal(const Vector3f& v1, const Vector3f& v2, const Vector3f& v3) {
-    Vector3f edge1 = v2 - v1;
-    Vector3f edge2 = v3 - v1;
-    Vector3f normal = edge1.Cross(edge2);
-    normal.Normalize();
-    return normal;
+// Map a binary mesh: its vertices, normals and triangles are stored ready to use (welded,
+// with normals and vertices in order of first use), so they are uploaded from the mapping
+// and only copied if the model gets sliced
+bool LoadBinaryModel(const char* filename)
+{
+    std::unique_ptr<MeshBinary> mesh(new MeshBinary());
+    if (!mesh->open(filename) || !mesh->validate()) {
+        return false;
+    }
+    modelBoundsMin = mesh->boundsMin();
+    modelBoundsMax = mesh->boundsMax();
+    vertexCount = mesh->vertexCount();
+    indexCount = mesh->triangleCount() * 3;
+    modelBinary = std::move(mesh);
+    return true;
+}
+
+// The model's arrays: those of the mapped binary mesh until the vectors are filled
+const Vector3f* ModelVertexData() {
+    return modelVertices.empty() && modelBinary ? modelBinary->vertices() : modelVertices.data();
+}
+
+const Vector3f* ModelNormalData() {
+    return modelNormals.empty() && modelBinary ? modelBinary->normals() : modelNormals.data();
+}
+
+const unsigned int* ModelIndexData() {
+    return modelIndices.empty() && modelBinary ? modelBinary->indices() : modelIndices.data();
 }
 
-// Load the OFF model and process vertices, normals, and faces
+// Load the OFF model (or a binary mesh from off2bin) and process vertices, normals, and faces
 bool LoadOFFModel(const char* filename)
 {
-    // Check if the model is already loaded and free it 
-    if (model) {
-        FreeOffModel(model);
-        model = nullptr;
-    }
-    
-    // Load the model from the OFF file
-    model = readOffFile((char*)filename);
-    if (!model) {
-        std::cerr << "Failed to load model: " << filename << std::endl;
-        return false;
-    }
-    
     // Clear Previous vertices, normals, and indices
     modelVertices.clear();
     modelNormals.clear();
     faceNormals.clear();
     modelIndices.clear();
+    modelBinary.reset();
+    modelExtent = 0.0f;
     
-    // Store original vertex positions without modification
-    for (int i = 0; i < model->numberOfVertices; i++) {
-        Vector3f vertex;
-        vertex.x = model->vertices[i].x;
-        vertex.y = model->vertices[i].y;
-        vertex.z = model->vertices[i].z;
-        modelVertices.push_back(vertex);
+    bool binary = IsMeshBinaryFile(filename);
+    if (binary) {
+        if (!LoadBinaryModel(filename)) {
+            std::cerr << "Failed to load model: " << filename << std::endl;
+            return false;
+        }
+    } else {
+        // Load the model from the OFF file (parsed on all threads)
+        OffMesh mesh;
+        OffLoadStats loadStats;
+        if (!LoadOFF(filename, mesh, &loadStats)) {
+            std::cerr << "Failed to load model: " << filename << std::endl;
+            return false;
+        }
+        std::cout << "Parsed " << filename << " in " << loadStats.seconds * 1000.0 << " ms ("
+                  << loadStats.megabytesPerSecond() << " MB/s, " << loadStats.millionFacesPerSecond()
+                  << " Mfaces/s)" << std::endl;
         
-        // Initialize vertex normals to zero
-        modelNormals.push_back(Vector3f(0.0f, 0.0f, 0.0f));
+        // Store original vertex positions without modification
+        modelVertices = mesh.vertices;
+        modelBoundsMin = mesh.boundsMin;
+        modelBoundsMax = mesh.boundsMax;
+        
+        // Triangulate each polygon as a fan
+        mesh.triangulate(modelIndices);
     }
+    Vector3f size = modelBoundsMax - modelBoundsMin;
+    modelExtent = std::max(size.x, std::max(size.y, size.z));
     
-    // Process faces and calculate face normals for each triangle
-    for (int i = 0; i < model->numberOfPolygons; i++) {
-        // Get the polygon (face) data
-        Polygon& poly = model->polygons[i];
-        
-        if (poly.noSides >= 3) {
-            // Get vertices for this face
-            Vector3f& v0 = modelVertices[poly.v[0]];
-            
-            // For each triangle in the polygon
-            for (int j = 1; j < poly.noSides - 1; j++) {
-                Vector3f& v1 = modelVertices[poly.v[j]];
-                Vector3f& v2 = modelVertices[poly.v[j + 1]];
-                
-                // Calculate face normal for this triangle
-                Vector3f normal = CalculateFaceNormal(v0, v1, v2);
-                faceNormals.push_back(normal);
-                
-                // Add indices for the triangle
-                modelIndices.push_back(poly.v[0]);
-                modelIndices.push_back(poly.v[j]);
-                modelIndices.push_back(poly.v[j + 1]);
-                
-                // Accumulate normal to each vertex of this triangle
-                modelNormals[poly.v[0]] += normal;
-                modelNormals[poly.v[j]] += normal;
-                modelNormals[poly.v[j + 1]] += normal;
-                
-                // Increment face count for vertices
-                model->vertices[poly.v[0]].numIcidentTri++;
-                model->vertices[poly.v[j]].numIcidentTri++;
-                model->vertices[poly.v[j + 1]].numIcidentTri++;
-            }
+    // Binary meshes were welded and ordered by off2bin; only missing normals are computed
+    if (binary) {
+        if (!modelBinary->normals()) {
+            ComputeVertexNormals(modelBinary->vertices(), vertexCount, modelBinary->indices(), indexCount / 3,
+                                 modelNormals, modelNormalWeighting);
         }
+        std::cout << "Model mapped: " << filename << std::endl;
+        std::cout << "Vertices: " << vertexCount << std::endl;
+        std::cout << "Faces: " << indexCount / 3 << std::endl;
+        return true;
     }
     
-    // Normalize all vertex normals
-    for (int i = 0; i < model->numberOfVertices; i++) {
-        if (model->vertices[i].numIcidentTri > 0) {
-            modelNormals[i].Normalize();
-        }
-        // Store normals in the model for reference
-        model->vertices[i].normal = modelNormals[i];
+    // Merge the duplicated vertices of face-by-face exports, so the normals are smooth
+    // across faces and every later stage works on the shared vertices
+    if (modelWeldVertices) {
+        WeldStats weld = WeldVertices(modelVertices, modelIndices, modelWeldTolerance * modelExtent);
+        std::cout << "Welded " << weld.inputVertices << " vertices into " << weld.outputVertices << " (ratio "
+                  << weld.ratio() << ", " << weld.removedTriangles << " degenerate triangles removed) in "
+                  << weld.seconds * 1000.0 << " ms" << std::endl;
     }
     
+    // Triangles in vertex cache order and vertices in order of first use, for the GPU's
+    // post-transform cache and vertex fetch
+    if (modelOptimizeOrder) {
+        MeshOptimizeStats order = OptimizeMeshOrder(modelVertices, modelIndices);
+        std::cout << "Vertex cache ACMR " << order.acmrBefore << " -> " << order.acmrAfter << " (reordered in "
+                  << order.seconds * 1000.0 << " ms)" << std::endl;
+    }
+    
+    // Calculate face normals for each triangle and the vertex normals from them
+    // (both on all threads; vertices without triangles keep a zero normal)
+    auto normalStart = std::chrono::high_resolution_clock::now();
+    ComputeVertexNormals(modelVertices.data(), modelVertices.size(), modelIndices.data(), modelIndices.size() / 3,
+                         modelNormals, modelNormalWeighting, &faceNormals);
+    int normalThreads = 1;
+#ifdef _OPENMP
+    normalThreads = omp_get_max_threads();
+#endif
+    std::cout << "Normals computed on " << normalThreads << " thread(s) in " << std::chrono::duration<double>(
+                 std::chrono::high_resolution_clock::now() - normalStart).count() * 1000.0 << " ms" << std::endl;
+    
     vertexCount = modelVertices.size();
     indexCount = modelIndices.size();
     
     std::cout << "Model loaded: " << filename << std::endl;
     std::cout << "Vertices: " << vertexCount << std::endl;
-    std::cout << "Faces: " << faceNormals.size() << std::endl;
+    std::cout << "Faces: " << indexCount / 3 << std::endl;
     std::cout << "Indices: " << indexCount << std::endl;
     
     return true;
@@ -264,15 +298,15 @@ bool LoadOFFModel(const char* filename)
 
 // Create a normalization matrix to center and scale the model
 Matrix4f CreateNormalizationMatrix() {
-    if (!model) return Matrix4f(); // Identity matrix if no model
+    if (modelExtent <= 0.0f) return Matrix4f(); // Identity matrix if no model
     
     // Calculate center of the model
-    float centerX = (model->minX + model->maxX) / 2.0f;
-    float centerY = (model->minY + model->maxY) / 2.0f;
-    float centerZ = (model->minZ + model->maxZ) / 2.0f;
+    float centerX = (modelBoundsMin.x + modelBoundsMax.x) / 2.0f;
+    float centerY = (modelBoundsMin.y + modelBoundsMax.y) / 2.0f;
+    float centerZ = (modelBoundsMin.z + modelBoundsMax.z) / 2.0f;
     
     // Calculate scale factor
-    float scale = 2.0f / model->extent;
+    float scale = 2.0f / modelExtent;
     
     // Create translation matrix to center the model
     Matrix4f translationMatrix;
@@ -329,17 +363,20 @@ static void CreateVertexBuffer()
     }
 
     // Create interleaved vertex data (position, normal)
+    const Vector3f* positions = ModelVertexData();
+    const Vector3f* normals = ModelNormalData();
     std::vector<float> vertexData;
+    vertexData.reserve(static_cast<size_t>(vertexCount) * 6);
     for (int i = 0; i < vertexCount; i++) {
         // Position
-        vertexData.push_back(modelVertices[i].x);
-        vertexData.push_back(modelVertices[i].y);
-        vertexData.push_back(modelVertices[i].z);
+        vertexData.push_back(positions[i].x);
+        vertexData.push_back(positions[i].y);
+        vertexData.push_back(positions[i].z);
         
         // Normal
-        vertexData.push_back(modelNormals[i].x);
-        vertexData.push_back(modelNormals[i].y);
-        vertexData.push_back(modelNormals[i].z);
+        vertexData.push_back(normals[i].x);
+        vertexData.push_back(normals[i].y);
+        vertexData.push_back(normals[i].z);
     }
 
     glGenVertexArrays(1, &VAO);
@@ -353,7 +390,7 @@ static void CreateVertexBuffer()
     // Create and populate the IBO
     glGenBuffers(1, &IBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), modelIndices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), ModelIndexData(), GL_STATIC_DRAW);
 
     // Position attribute
     glEnableVertexAttribArray(0);
@@ -732,10 +769,23 @@ void RenderImGui()
     ImGui::Begin("3D Model Viewer");
     
     ImGui::Text("Current model: %s", modelPath);
-    ImGui::Text("Vertices: %d, Faces: %d", vertexCount, faceNormals.size());
+    ImGui::Text("Vertices: %d, Faces: %d", vertexCount, indexCount / 3);
     
     ImGui::InputText("Model Path", modelPath, sizeof(modelPath));
     
+    const char* normalWeightings[] = { "Uniform", "Area", "Angle" };
+    int weighting = modelNormalWeighting;
+    if (ImGui::Combo("Normal Weighting", &weighting, normalWeightings, IM_ARRAYSIZE(normalWeightings))) {
+        modelNormalWeighting = static_cast<NormalWeighting>(weighting);
+    }
+    ImGui::Checkbox("Weld Vertices", &modelWeldVertices);
+    ImGui::SameLine();
+    ImGui::Checkbox("Optimize Vertex Order", &modelOptimizeOrder);
+    if (modelWeldVertices) {
+        ImGui::InputFloat("Weld Tolerance", &modelWeldTolerance, 0.0f, 0.0f, "%.6f");
+        modelWeldTolerance = std::max(0.0f, modelWeldTolerance);
+    }
+    
     if (ImGui::Button("Load Model")) {
         bool success = LoadOFFModel(modelPath);
         if (success) {
@@ -775,10 +825,10 @@ void RenderImGui()
         static bool originalModelStored = false;
         
         // Store the original model on first open
-        if (!originalModelStored && !modelVertices.empty()) {
-            originalVertices = modelVertices;
-            originalNormals = modelNormals;
-            originalIndices = modelIndices;
+        if (!originalModelStored && vertexCount > 0) {
+            originalVertices.assign(ModelVertexData(), ModelVertexData() + vertexCount);
+            originalNormals.assign(ModelNormalData(), ModelNormalData() + vertexCount);
+            originalIndices.assign(ModelIndexData(), ModelIndexData() + indexCount);
             originalModelStored = true;
         }
 
@@ -989,6 +1039,7 @@ void RenderImGui()
                 std::vector<Vector3f> slicedNormals;
                 std::vector<unsigned int> slicedIndices;
                 
+                auto sliceStart = std::chrono::high_resolution_clock::now();
                 meshSlicer.SliceMesh(
                     originalVertices, 
                     originalNormals, 
@@ -997,6 +1048,15 @@ void RenderImGui()
                     slicedNormals, 
                     slicedIndices
                 );
+                std::cout << "Sliced " << originalIndices.size() / 3 << " triangles into " << slicedIndices.size() / 3
+                          << " on " << meshSlicer.GetLastSliceThreads() << " thread(s) in "
+                          << std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - sliceStart).count() * 1000.0
+                          << " ms" << std::endl;
+                const WeldStats& weld = meshSlicer.GetLastWeld();
+                if (weld.inputVertices > 0) {
+                    std::cout << "Sliced mesh welded from " << weld.inputVertices << " to " << weld.outputVertices
+                              << " vertices (ratio " << weld.ratio() << ")" << std::endl;
+                }
                 
                 // Update the model with sliced mesh
                 modelVertices = slicedVertices;
@@ -1345,10 +1405,6 @@ int main(int argc, char *argv[])
     ImGui::DestroyContext();
     
     // Free resources
-    if (model) {
-        FreeOffModel(model);
-    }
-    
     if (rayTracer) {
         delete rayTracer;
     }
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 // ########################################################################### [included this ]
 #include "../include/math_utils.h"  
+#include "../include/mem_stats.h"
+#include "../include/off_mesh.h"
 
 typedef struct Vt {
 	float x,y,z;
@@ -22,98 +24,77 @@ typedef struct offmodel {
  	int numberOfPolygons;
 	float minX, minY, minZ, maxX, maxY, maxZ;
 	float extent;
+	int *indexPool;		/* All polygon indices; NULL if each polygon owns its v array */
 }OffModel;
 
+/* Bytes held by a loaded model, reported to MemStats as geometry */
+size_t OffModelBytes(OffModel *model) {
+	size_t bytes = sizeof(OffModel);
+	int i;
+	bytes += model->numberOfVertices * sizeof(Vertex);
+	bytes += model->numberOfPolygons * sizeof(Polygon);
+	for(i = 0;i < model->numberOfPolygons;i ++)
+		bytes += (model->polygons[i]).noSides * sizeof(int);
+	return bytes;
+}
+
+/* Compatibility shim over LoadOFF: the polygons point into one shared index pool */
 OffModel* readOffFile(char * OffFile) {
-	FILE * input;
-	char type[3]; 
-	int noEdges;
-	int i,j;
-	float x,y,z;
-	int n, v;
-	int nv, np;
+	OffMesh mesh;
 	OffModel *model;
+	int i;
 
-	
-	input = fopen(OffFile, "r");
-	fscanf(input, "%s", type);
-	// ###############################################################################
-	// remove the below check to avoid seg fault because buffer overlfow
-	/* First line should be OFF */
-	// if(strcmp(type,"OFF")) {
-	// 	printf("Not a OFF file");
-	// 	exit(1);
-	// }
-	/* Read the no. of vertices, faces and edges */
-	fscanf(input, "%d", &nv);
-	fscanf(input, "%d", &np);
-	fscanf(input, "%d", &noEdges);
+	if (!LoadOFF(OffFile, mesh))
+		return NULL;
 
 	model = (OffModel*)malloc(sizeof(OffModel));
-	model->numberOfVertices = nv;
-	model->numberOfPolygons = np;
-	
-	
-	/* allocate required data */
-	model->vertices = (Vertex *) malloc(nv * sizeof(Vertex));
-	model->polygons = (Polygon *) malloc(np * sizeof(Polygon));
-	
+	model->numberOfVertices = mesh.vertexCount();
+	model->numberOfPolygons = mesh.faceCount();
+	model->vertices = (Vertex *) malloc(mesh.vertices.size() * sizeof(Vertex));
+	model->polygons = (Polygon *) malloc(mesh.faceCount() * sizeof(Polygon));
+	model->indexPool = (int *) malloc(mesh.indices.size() * sizeof(int));
 
-	/* Read the vertices' location*/	
-	for(i = 0;i < nv;i ++) {
-		fscanf(input, "%f %f %f", &x,&y,&z);
-		(model->vertices[i]).x = x;
-		(model->vertices[i]).y = y;
-		(model->vertices[i]).z = z;
+	for(i = 0;i < model->numberOfVertices;i ++) {
+		(model->vertices[i]).x = mesh.vertices[i].x;
+		(model->vertices[i]).y = mesh.vertices[i].y;
+		(model->vertices[i]).z = mesh.vertices[i].z;
 		(model->vertices[i]).numIcidentTri = 0;
-		if (i==0){
-			model->minX = model->maxX = x; 
-			model->minY = model->maxY = y; 
-			model->minZ = model->maxZ = z; 
-		} else {
-			if (x < model->minX) model->minX = x;
-			else if (x > model->maxX) model->maxX = x;
-			if (y < model->minY) model->minY = y;
-			else if (y > model->maxY) model->maxY = y;
-			if (z < model->minZ) model->minZ = z;
-			else if (z > model->maxZ) model->maxZ = z;
-		}
 	}
-
-	/* Read the Polygons */	
-	for(i = 0;i < np;i ++) {
-		/* No. of sides of the polygon (Eg. 3 => a triangle) */
-		fscanf(input, "%d", &n);
-		
-		(model->polygons[i]).noSides = n;
-		(model->polygons[i]).v = (int *) malloc(n * sizeof(int));
-		/* read the vertices that make up the polygon */
-		for(j = 0;j < n;j ++) {
-			fscanf(input, "%d", &v);
-			(model->polygons[i]).v[j] = v;
-		}
+	if (!mesh.indices.empty())
+		memcpy(model->indexPool, mesh.indices.data(), mesh.indices.size() * sizeof(int));
+	for(i = 0;i < model->numberOfPolygons;i ++) {
+		(model->polygons[i]).noSides = mesh.faceSize(i);
+		(model->polygons[i]).v = model->indexPool + mesh.faceOffsets[i];
 	}
-	
-	float extentX = model->maxX - model->minX;
-	float extentY = model->maxY - model->minY;
-	float extentZ = model->maxZ - model->minZ;
-	model->extent = (extentX > extentY) ? ((extentX > extentZ) ? extentX : extentZ) : ((extentY > extentZ) ? extentY : extentZ);
 
-	fclose(input);
+	model->minX = mesh.boundsMin.x; model->maxX = mesh.boundsMax.x;
+	model->minY = mesh.boundsMin.y; model->maxY = mesh.boundsMax.y;
+	model->minZ = mesh.boundsMin.z; model->maxZ = mesh.boundsMax.z;
+	model->extent = mesh.extent;
+
+	MemStats::Instance().Add(MEM_GEOMETRY, OffModelBytes(model));
 	return model;
 }
 
 int FreeOffModel(OffModel *model)
 {
-	int i,j;
+	int i;
 	if( model == NULL )
 		return 0;
+	MemStats::Instance().Release(MEM_GEOMETRY, OffModelBytes(model));
 	free(model->vertices);
-	for( i = 0; i < model->numberOfPolygons; ++i )
+	if( model->indexPool )
+	{
+		free(model->indexPool);
+	}
+	else
 	{
-		if( (model->polygons[i]).v )
+		for( i = 0; i < model->numberOfPolygons; ++i )
 		{
-			free((model->polygons[i]).v);
+			if( (model->polygons[i]).v )
+			{
+				free((model->polygons[i]).v);
+			}
 		}
 	}
 	free(model->polygons);
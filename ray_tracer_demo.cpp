@@ -1,14 +1,34 @@
 #include "RayTracer.h"
 #include "include/math_utils.h"
-#include "models/OFFReader.h"
+#include "include/off_mesh.h"
+#include "include/mesh_cache.h"
+#include "include/image_io.h"
+#include "include/frame_archive.h"
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <cctype>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
 #include <unistd.h> // For _exit function
 
 // ############################################################################################
-// Function to load a mesh from an OFF file and add it to the scene
-void addMeshFromFile(RayTracer& rayTracer, const std::string& filename, const Vector3f& position, 
+// Case-insensitive check of a file name's extension (e.g. ".png")
+bool hasExtension(const std::string& filename, const std::string& extension) {
+    if (filename.size() < extension.size()) return false;
+    for (size_t i = 0; i < extension.size(); i++) {
+        char c = filename[filename.size() - extension.size() + i];
+        if (tolower(static_cast<unsigned char>(c)) != extension[i]) return false;
+    }
+    return true;
+}
+
+// ############################################################################################
+// Function to load a mesh from an OFF file and add it to the scene; false if it could not
+// be loaded
+bool addMeshFromFile(RayTracer& rayTracer, const std::string& filename, const Vector3f& position, 
                      float scale, const Material& material) {
     // Add debug log to confirm function invocation
     std::cout << "addMeshFromFile called with filename: " << filename << ", position: " << position << ", scale: " << scale << std::endl;
@@ -16,60 +36,32 @@ void addMeshFromFile(RayTracer& rayTracer, const std::string& filename, const Ve
     // Add debug logs to verify mesh loading
     std::cout << "Attempting to read OFF file: " << filename << std::endl;
 
-    // Read the OFF file
-    OffModel* model = readOffFile(const_cast<char*>(filename.c_str()));
-    if (!model) {
+    // Every reference to a file shares one cached mesh: binary meshes are mapped and traced
+    // in place, OFF files are parsed and given a BVH on the first reference only
+    MeshCacheLookup lookup;
+    std::shared_ptr<const MeshBinary> mesh = MeshCache::Instance().acquire(filename, &lookup);
+    if (!mesh) {
         std::cerr << "Failed to read mesh file: " << filename << std::endl;
-        return;
+        return false;
     }
-    std::cout << "Successfully read OFF file: " << filename << std::endl;
-    std::cout << "Number of vertices: " << model->numberOfVertices << ", Number of polygons: " << model->numberOfPolygons << std::endl;
-    
-    // ############################################################################################
-    // Convert to vectors for processing
-    std::vector<Vector3f> vertices;
-    std::vector<unsigned int> indices;
-    
-    // ############################################################################################
-    // Extract vertices
-    for (int i = 0; i < model->numberOfVertices; i++) {
-        float x = model->vertices[i].x;
-        float y = model->vertices[i].y;
-        float z = model->vertices[i].z;
-        
-        // Apply scale and translation
-        Vector3f vertex(x * scale + position.x, 
-                        y * scale + position.y, 
-                        z * scale + position.z);
-        vertices.push_back(vertex);
+    rayTracer.addTriangleMesh(mesh, position, scale, material);
+    if (lookup.hit) {
+        std::cout << "Reused cached mesh " << filename << " (" << mesh->triangleCount() << " triangles)" << std::endl;
+    } else if (lookup.mapped) {
+        std::cout << "Mapped binary mesh " << filename << " with " << mesh->vertexCount() << " vertices and "
+                  << mesh->triangleCount() << " triangles" << (mesh->bvh() ? " (with BVH)" : "") << " in "
+                  << lookup.seconds * 1000.0 << " ms" << std::endl;
+    } else {
+        const OffLoadStats& loadStats = lookup.offStats;
+        std::cout << "Successfully read OFF file: " << filename << " in " << loadStats.seconds * 1000.0 << " ms ("
+                  << loadStats.megabytesPerSecond() << " MB/s, " << loadStats.millionFacesPerSecond() << " Mfaces/s)" << std::endl;
+        std::cout << "Welded " << lookup.weld.inputVertices << " vertices into " << lookup.weld.outputVertices
+                  << " (ratio " << lookup.weld.ratio() << ") in " << lookup.weld.seconds * 1000.0 << " ms" << std::endl;
+        std::cout << "Mesh added with " << mesh->vertexCount() << " vertices and " << mesh->triangleCount()
+                  << " triangles, BVH built in " << lookup.bvhSeconds * 1000.0 << " ms, vertices renumbered in "
+                  << lookup.order.seconds * 1000.0 << " ms (" << lookup.seconds * 1000.0 << " ms in all)" << std::endl;
     }
-    
-    // ############################################################################################
-    // Extract polygon indices (assuming triangles)
-    for (int i = 0; i < model->numberOfPolygons; i++) {
-        if (model->polygons[i].noSides >= 3) {
-            // Add the first triangle (for triangles or n-gons)
-            indices.push_back(model->polygons[i].v[0]);
-            indices.push_back(model->polygons[i].v[1]);
-            indices.push_back(model->polygons[i].v[2]);
-            
-            // If more than 3 sides, triangulate the n-gon (simple fan triangulation)
-            for (int j = 3; j < model->polygons[i].noSides; j++) {
-                indices.push_back(model->polygons[i].v[0]);
-                indices.push_back(model->polygons[i].v[j-1]);
-                indices.push_back(model->polygons[i].v[j]);
-            }
-        }
-    }
-    
-    std::cout << "Mesh vertices and indices prepared. Adding to ray tracer..." << std::endl;
-    // Add mesh to the ray tracer
-    rayTracer.addMesh(vertices, indices, material);
-    std::cout << "Mesh added successfully with " << vertices.size() << " vertices and " 
-              << indices.size()/3 << " triangles." << std::endl;
-    
-    // Free the model
-    FreeOffModel(model);
+    return true;
 }
 
 // ############################################################################################
@@ -183,11 +175,84 @@ void setupMeshScene(RayTracer& rayTracer, const std::string& modelName) {
 // ############################################################################################
 // Function to load a scene from a file
 void loadSceneFromFile(RayTracer& rayTracer, const std::string& filename) {
-    if (!rayTracer.loadSceneFromFile(filename)) {
+    SceneParseStats stats;
+    if (!rayTracer.loadSceneFromFile(filename, &stats)) {
         std::cerr << "Failed to load scene from file: " << filename << std::endl;
         return;
     }
-    std::cout << "Scene loaded from " << filename << std::endl;
+    std::cout << "Scene loaded from " << filename << ": " << stats.objects << " objects, " << stats.lights
+              << " lights in " << stats.seconds * 1000.0 << " ms (" << stats.megabytesPerSecond() << " MB/s)" << std::endl;
+    if (MeshCache::Instance().hitCount() > 0) {
+        std::cout << "Mesh cache: " << MeshCache::Instance().size() << " files loaded, "
+                  << MeshCache::Instance().hitCount() << " references shared" << std::endl;
+    }
+}
+
+// ############################################################################################
+// One requested output resolution
+struct OutputSize {
+    int width;
+    int height;
+};
+
+// ############################################################################################
+// Parse a comma separated list of sizes such as "1920x1080,1280x720". A size listed again
+// is dropped, since it would write the same file twice.
+bool parseOutputSizes(const std::string& list, std::vector<OutputSize>& sizes) {
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        OutputSize size;
+        char separator;
+        std::istringstream parser(item);
+        if (!(parser >> size.width >> separator >> size.height) || separator != 'x' ||
+            size.width <= 0 || size.height <= 0) {
+            return false;
+        }
+        bool listed = false;
+        for (size_t i = 0; i < sizes.size(); i++) {
+            listed = listed || (sizes[i].width == size.width && sizes[i].height == size.height);
+        }
+        if (!listed) sizes.push_back(size);
+    }
+    return !sizes.empty();
+}
+
+// ############################################################################################
+// Replace {w} and {h} in an output file name
+std::string expandOutputName(const std::string& pattern, int width, int height) {
+    std::string name = pattern;
+    size_t pos;
+    while ((pos = name.find("{w}")) != std::string::npos) name.replace(pos, 3, std::to_string(width));
+    while ((pos = name.find("{h}")) != std::string::npos) name.replace(pos, 3, std::to_string(height));
+    return name;
+}
+
+// ############################################################################################
+// Tone map a resampled linear frame to 8-bit RGB
+void toneMapResampled(const std::vector<float>& hdr, int width, int height, const ToneMapSettings& toneMapping,
+                      std::vector<unsigned char>& pixels) {
+    pixels.resize(hdr.size());
+    int rowFloats = width * 3;
+    #pragma omp parallel for
+    for (int y = 0; y < height; y++) {
+        ToneMapRow(&hdr[y * rowFloats], &pixels[y * rowFloats], rowFloats, toneMapping);
+    }
+}
+
+// ############################################################################################
+// Resample the traced frame to the given size and save it in the format of the extension
+bool saveResampled(const RayTracer& rayTracer, const std::string& filename, int width, int height,
+                   const ToneMapSettings& toneMapping) {
+    std::vector<float> hdr;
+    rayTracer.resampleHdr(width, height, hdr);
+    if (hasExtension(filename, ".pfm")) return WritePFM(filename, hdr.data(), width, height);
+    if (hasExtension(filename, ".exr")) return WriteEXR(filename, hdr.data(), width, height);
+
+    std::vector<unsigned char> pixels;
+    toneMapResampled(hdr, width, height, toneMapping, pixels);
+    if (hasExtension(filename, ".png")) return WritePNG(filename, pixels.data(), width, height);
+    return SavePPM(filename, pixels.data(), width, height);
 }
 
 // ############################################################################################
@@ -199,10 +264,21 @@ int main(int argc, char** argv) {
     
     // Process command line arguments
     std::string outputFile = "render.ppm";
+    std::string textOutputFile = "";   // Optional P3 copy of the same frame
     std::string sceneType = "simple";
     std::string modelName = "1grm";
     std::string sceneFile = "";
     bool exitImmediately = false;  // New flag to bypass normal cleanup
+    bool printMemStats = false;    // Print memory accounting after rendering
+    bool streamOutput = false;     // Write PPM bands while rendering instead of after
+    bool mappedOutput = false;     // Render straight into a memory-mapped PPM
+    std::vector<OutputSize> outputSizes;   // Several resolutions from one trace
+    int supersample = 1;
+    std::string archiveFile = "";  // Append frames to this archive instead of writing image files
+    std::string frameName = "";    // Name of the frame in the archive
+    std::string compileInput = ""; // Scene file to compile instead of rendering
+    std::string compileOutput = "";
+    ToneMapSettings toneMapping;
 
     // ############################################################################################
     // Parse command line arguments
@@ -212,6 +288,9 @@ int main(int argc, char** argv) {
         if (arg == "--output" && i + 1 < argc) {
             outputFile = argv[++i];
         } 
+        else if (arg == "--text-output" && i + 1 < argc) {
+            textOutputFile = argv[++i];
+        }
         else if (arg == "--scene" && i + 1 < argc) {
             sceneType = argv[++i];
         }
@@ -228,23 +307,128 @@ int main(int argc, char** argv) {
         else if (arg == "--skip-cleanup") {
             exitImmediately = true;  // Set the flag if this option is provided
         }
+        else if (arg == "--mem-stats") {
+            printMemStats = true;
+        }
+        else if (arg == "--stream") {
+            streamOutput = true;
+        }
+        else if (arg == "--mmap-output") {
+            mappedOutput = true;
+        }
+        else if (arg == "--output-sizes" && i + 1 < argc) {
+            if (!parseOutputSizes(argv[++i], outputSizes)) {
+                std::cerr << "Invalid output sizes: " << argv[i] << " (use e.g. 1920x1080,1280x720)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--supersample" && i + 1 < argc) {
+            supersample = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--archive" && i + 1 < argc) {
+            archiveFile = argv[++i];
+        }
+        else if (arg == "--frame-name" && i + 1 < argc) {
+            frameName = argv[++i];
+        }
+        else if (arg == "--compile-scene" && i + 2 < argc) {
+            compileInput = argv[++i];
+            compileOutput = argv[++i];
+        }
+        else if (arg == "--alloc-policy" && i + 1 < argc) {
+            if (!ParseAllocPolicy(argv[++i], GlobalAllocConfig().policy)) {
+                std::cerr << "Unknown allocation policy: " << argv[i] << " (use default or interleave)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--huge-pages") {
+            GlobalAllocConfig().hugePages = true;
+        }
+        else if (arg == "--tonemap" && i + 1 < argc) {
+            if (!ParseToneMapOperator(argv[++i], toneMapping.op)) {
+                std::cerr << "Unknown tone mapping operator: " << argv[i] << " (use clamp or reinhard)" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--exposure" && i + 1 < argc) {
+            char* end;
+            float exposure = strtof(argv[++i], &end);
+            if (end == argv[i] || *end != '\0' || !std::isfinite(exposure) || exposure <= 0.0f) {
+                std::cerr << "Invalid exposure: " << argv[i] << " (use a positive number)" << std::endl;
+                return 1;
+            }
+            toneMapping.exposure = exposure;
+        }
         else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
             std::cout << "Options:" << std::endl;
             std::cout << "  --output FILE       Output file name (default: render.ppm)" << std::endl;
+            std::cout << "                      .png writes PNG, .pfm / .exr write linear HDR data" << std::endl;
+            std::cout << "  --text-output FILE  Also write the frame as ASCII PPM (P3) without re-rendering" << std::endl;
+            std::cout << "  --stream            Write the PPM band by band while rendering (bounded memory)" << std::endl;
+            std::cout << "  --mmap-output       Render directly into the memory-mapped PPM file" << std::endl;
+            std::cout << "  --output-sizes LIST Trace once and write each size, e.g. 1920x1080,1280x720" << std::endl;
+            std::cout << "                      ({w} and {h} in the output name are replaced per size)" << std::endl;
+            std::cout << "  --supersample N     With --output-sizes, trace at N times the largest size" << std::endl;
+            std::cout << "  --archive FILE      Append the frame(s) to a compressed frame archive instead" << std::endl;
+            std::cout << "                      of writing image files (see tools/archive_extract)" << std::endl;
+            std::cout << "  --frame-name NAME   Frame name in the archive (default: scene name)" << std::endl;
             std::cout << "  --scene TYPE        Scene type: simple, mesh, file (default: simple)" << std::endl;
             std::cout << "  --model NAME        Model to use for mesh scene (default: 1grm)" << std::endl;
-            std::cout << "  --file FILENAME     Scene description file for 'file' scene type" << std::endl;
+            std::cout << "  --file FILENAME     Scene description file for 'file' scene type (text or compiled)" << std::endl;
+            std::cout << "  --compile-scene IN OUT  Compile a text scene file into the binary scene format" << std::endl;
             std::cout << "  --resolution W H    Image resolution (default: 800x600)" << std::endl;
             std::cout << "  --skip-cleanup      Skip memory cleanup to avoid potential issues" << std::endl;
+            std::cout << "  --mem-stats         Print memory usage by category with peak values" << std::endl;
+            std::cout << "  --alloc-policy P    Page placement for scene and framebuffer: default, interleave" << std::endl;
+            std::cout << "  --huge-pages        Request transparent huge pages for scene and framebuffer" << std::endl;
+            std::cout << "  --tonemap OP        Tone mapping operator: clamp, reinhard (default: clamp)" << std::endl;
+            std::cout << "  --exposure E        Exposure multiplier applied before tone mapping (default: 1)" << std::endl;
             return 0;
         }
     }
 
+    // ############################################################################################
+    // Compile a scene file and exit
+    if (!compileInput.empty()) {
+        RayTracer rayTracer(imageWidth, imageHeight);
+        SceneParseStats stats;
+        if (!rayTracer.loadSceneFromFile(compileInput, &stats)) return 1;
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!WriteCompiledScene(rayTracer, compileOutput)) return 1;
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "Compiled " << compileInput << " (" << stats.objects << " objects, parsed in "
+                  << stats.seconds * 1000.0 << " ms) into " << compileOutput << " in " << seconds * 1000.0 << " ms" << std::endl;
+        return 0;
+    }
+
+    // ############################################################################################
+    // With several output sizes, trace once at the largest one (times the supersampling factor)
+    if (!outputSizes.empty()) {
+        OutputSize largest = outputSizes[0];
+        for (size_t i = 1; i < outputSizes.size(); i++) {
+            if (outputSizes[i].width * outputSizes[i].height > largest.width * largest.height) largest = outputSizes[i];
+        }
+        for (size_t i = 0; i < outputSizes.size(); i++) {
+            float aspect = static_cast<float>(outputSizes[i].width) / outputSizes[i].height;
+            if (std::fabs(aspect / (static_cast<float>(largest.width) / largest.height) - 1.0f) > 0.01f) {
+                std::cerr << "Warning: " << outputSizes[i].width << "x" << outputSizes[i].height
+                          << " has a different aspect ratio and will be stretched" << std::endl;
+            }
+        }
+        if (outputSizes.size() > 1 && archiveFile.empty() && outputFile.find("{w}") == std::string::npos) {
+            std::cerr << "Use {w} and {h} in the output name to write several sizes" << std::endl;
+            return 1;
+        }
+        imageWidth = largest.width * supersample;
+        imageHeight = largest.height * supersample;
+    }
+
     {
         // ############################################################################################
         // Create ray tracer in its own scope
         RayTracer rayTracer(imageWidth, imageHeight);
+        rayTracer.setToneMapping(toneMapping);
 
         // Setup the requested scene
         if (sceneType == "mesh") {
@@ -257,14 +441,136 @@ int main(int argc, char** argv) {
             setupSimpleScene(rayTracer);
         }
 
+        // ############################################################################################
+        // Archive output: frames are compressed and appended by a background thread
+        FrameArchiveWriter archive;
+        if (!archiveFile.empty()) {
+            if (!archive.open(archiveFile)) {
+                return 1;
+            }
+            if (frameName.empty()) {
+                frameName = sceneType == "file" ? sceneFile : sceneType == "mesh" ? "mesh_" + modelName : sceneType;
+                size_t slash = frameName.find_last_of('/');
+                if (slash != std::string::npos) frameName = frameName.substr(slash + 1);
+                size_t dot = frameName.find_last_of('.');
+                if (dot != std::string::npos && dot > 0) frameName = frameName.substr(0, dot);
+            }
+            outputFile = archiveFile;
+            streamOutput = mappedOutput = false;
+        }
+        FrameInfo frameInfo;
+        frameInfo.name = frameName;
+        frameInfo.timestamp = static_cast<uint64_t>(time(NULL));
+
         std::cout << "Rendering scene to " << outputFile << " at " 
                 << imageWidth << "x" << imageHeight << " resolution..." << std::endl;
         
         // Start timing
         auto startTime = std::chrono::high_resolution_clock::now();
         
-        // Render the image and save to file
-        bool success = rayTracer.saveToFile(outputFile);
+        if (!outputSizes.empty()) {
+            // Trace once, then resample to every requested size
+            rayTracer.renderLinear();
+            auto traceTime = std::chrono::high_resolution_clock::now();
+            std::cout << "Traced " << imageWidth << "x" << imageHeight << " in "
+                      << std::chrono::duration<double>(traceTime - startTime).count() << " seconds" << std::endl;
+            frameInfo.renderSeconds = std::chrono::duration<double>(traceTime - startTime).count();
+            frameInfo.rayCount = rayTracer.getRayCount();
+            
+            for (size_t i = 0; i < outputSizes.size(); i++) {
+                if (archive.isOpen()) {
+                    std::vector<float> hdr;
+                    std::vector<unsigned char> pixels;
+                    rayTracer.resampleHdr(outputSizes[i].width, outputSizes[i].height, hdr);
+                    toneMapResampled(hdr, outputSizes[i].width, outputSizes[i].height, toneMapping, pixels);
+                    frameInfo.name = frameName;
+                    if (outputSizes.size() > 1) {
+                        frameInfo.name += "_" + std::to_string(outputSizes[i].width) + "x" + std::to_string(outputSizes[i].height);
+                    }
+                    frameInfo.width = outputSizes[i].width;
+                    frameInfo.height = outputSizes[i].height;
+                    archive.addFrame(frameInfo, pixels.data());
+                    continue;
+                }
+                auto sizeStart = std::chrono::high_resolution_clock::now();
+                std::string name = expandOutputName(outputFile, outputSizes[i].width, outputSizes[i].height);
+                if (!saveResampled(rayTracer, name, outputSizes[i].width, outputSizes[i].height, toneMapping)) {
+                    std::cerr << "Failed to save image to " << name << std::endl;
+                    return 1;
+                }
+                std::cout << "Image saved to " << name << " (" << outputSizes[i].width << "x" << outputSizes[i].height
+                          << ", " << std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - sizeStart).count()
+                          << " seconds)" << std::endl;
+            }
+            
+            if (archive.isOpen()) {
+                if (!archive.close()) {
+                    return 1;
+                }
+                std::cout << "Added " << outputSizes.size() << " frame(s) to " << archiveFile
+                          << " (" << archive.getFrames().size() << " frames in total)" << std::endl;
+            }
+            if (printMemStats) {
+                MemStats::Instance().Print(std::cout);
+            }
+            if (exitImmediately) {
+                _exit(0);
+            }
+            return 0;
+        }
+        
+        // Render the image once, then save it in the requested formats
+        // (streamed output traces while writing and never holds the full frame)
+        bool binaryPPM = !hasExtension(outputFile, ".png") && !hasExtension(outputFile, ".pfm")
+                         && !hasExtension(outputFile, ".exr") && !archive.isOpen();
+        if ((streamOutput || mappedOutput) && !binaryPPM) {
+            std::cerr << "Streamed and mapped output are only supported for PPM, rendering the full frame" << std::endl;
+            streamOutput = mappedOutput = false;
+        }
+        if ((streamOutput || mappedOutput) && !textOutputFile.empty()) {
+            // The text copy needs the whole frame; tracing it once serves both files
+            std::cerr << "--text-output needs the full frame, rendering it instead of streaming" << std::endl;
+            streamOutput = mappedOutput = false;
+        }
+        if (!streamOutput && !mappedOutput) {
+            rayTracer.renderFrame();
+        }
+        bool success;
+        if (archive.isOpen()) {
+            frameInfo.width = imageWidth;
+            frameInfo.height = imageHeight;
+            frameInfo.renderSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+            frameInfo.rayCount = rayTracer.getRayCount();
+            archive.addFrame(frameInfo, rayTracer.getFramebuffer().data());
+            success = archive.close();
+        } else if (hasExtension(outputFile, ".png")) {
+            PngEncodeStats pngStats;
+            success = rayTracer.saveToPNG(outputFile, &pngStats);
+            if (success) {
+                std::cout << "PNG encoded " << pngStats.rawBytes / (1024.0 * 1024.0) << " MB -> "
+                          << pngStats.fileBytes / (1024.0 * 1024.0) << " MB in " << pngStats.seconds * 1000.0
+                          << " ms (" << pngStats.megabytesPerSecond() << " MB/s)" << std::endl;
+            }
+        } else if (hasExtension(outputFile, ".pfm")) {
+            success = rayTracer.saveToPFM(outputFile);
+        } else if (hasExtension(outputFile, ".exr")) {
+            success = rayTracer.saveToEXR(outputFile);
+        } else if (mappedOutput) {
+            success = rayTracer.saveMapped(outputFile);
+        } else if (streamOutput) {
+            StreamStats streamStats;
+            success = rayTracer.saveStreaming(outputFile, 0, &streamStats);
+            if (success) {
+                std::cout << "Streamed " << streamStats.bytesWritten / (1024.0 * 1024.0) << " MB in bands of "
+                          << streamStats.bandRows << " rows (writer busy " << streamStats.writeSeconds * 1000.0
+                          << " ms, renderer stalled " << streamStats.stallSeconds * 1000.0 << " ms)" << std::endl;
+            }
+        } else {
+            success = rayTracer.saveToFile(outputFile);
+        }
+        if (success && !textOutputFile.empty()) {
+            success = rayTracer.saveToTextFile(textOutputFile);
+        }
         
         // Calculate rendering time
         auto endTime = std::chrono::high_resolution_clock::now();
@@ -278,6 +584,10 @@ int main(int argc, char** argv) {
             return 1;
         }
         
+        if (printMemStats) {
+            MemStats::Instance().Print(std::cout);
+        }
+        
         // If we're skipping cleanup, exit immediately before destructors run
         if (exitImmediately) {
             _exit(0);  // Force immediate exit without invoking destructors
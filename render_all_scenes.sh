@@ -13,25 +13,44 @@ make ray_tracer_demo
 # Resolution setting (can be changed via command line arguments)
 WIDTH=${1:-1920}
 HEIGHT=${2:-1080}
+# Additional, smaller resolutions produced from the same trace (comma separated)
+EXTRA_SIZES=${3-1280x720}
+# Trace at this multiple of the largest resolution before downsampling (1 = off)
+SUPERSAMPLE=${SUPERSAMPLE:-1}
+# Set ARCHIVE to collect all frames in one archive file instead of separate images
+ARCHIVE=${ARCHIVE:-}
 
-# Function to render a single scene
+# Function to render a single scene at every requested resolution with one trace
 render_scene() {
     SCENE_NAME=$1
     RESOLUTION_WIDTH=$2
     RESOLUTION_HEIGHT=$3
+    SIZES="${RESOLUTION_WIDTH}x${RESOLUTION_HEIGHT}${EXTRA_SIZES:+,$EXTRA_SIZES}"
+    # Drop repeated sizes (e.g. the main resolution given again as an extra one)
+    SIZES=$(echo "$SIZES" | tr ',' '\n' | awk '!seen[$0]++' | paste -sd, -)
     
-    echo "Rendering $SCENE_NAME scene at ${RESOLUTION_WIDTH}x${RESOLUTION_HEIGHT}..."
+    echo "Rendering $SCENE_NAME scene at ${SIZES}..."
     
     # Create output directory if it doesn't exist
     mkdir -p "outputs/$SCENE_NAME"
     
-    # Render the scene
+    # Render the scene once; {w} and {h} are filled in for each output size
+    if [ -n "$ARCHIVE" ]; then
+        ./ray_tracer_demo --scene file --file "scenes/${SCENE_NAME}.txt" \
+                         --archive "$ARCHIVE" \
+                         --output-sizes "$SIZES" \
+                         --supersample $SUPERSAMPLE \
+                         --skip-cleanup
+        echo "Rendered $SCENE_NAME scene into $ARCHIVE (${SIZES})"
+        return
+    fi
     ./ray_tracer_demo --scene file --file "scenes/${SCENE_NAME}.txt" \
-                     --output "outputs/$SCENE_NAME/${SCENE_NAME}_${RESOLUTION_WIDTH}x${RESOLUTION_HEIGHT}.ppm" \
-                     --resolution $RESOLUTION_WIDTH $RESOLUTION_HEIGHT \
+                     --output "outputs/$SCENE_NAME/${SCENE_NAME}_{w}x{h}.ppm" \
+                     --output-sizes "$SIZES" \
+                     --supersample $SUPERSAMPLE \
                      --skip-cleanup
     
-    echo "Rendered $SCENE_NAME scene to outputs/$SCENE_NAME/${SCENE_NAME}_${RESOLUTION_WIDTH}x${RESOLUTION_HEIGHT}.ppm"
+    echo "Rendered $SCENE_NAME scene to outputs/$SCENE_NAME/ (${SIZES})"
 }
 
 # Get all scene files
@@ -0,0 +1,119 @@
+// ############################################################################################
+// Frame archive extraction tool
+// Lists the frames of an archive written with ray_tracer_demo --archive, with their
+// metadata, and extracts them as PPM or PNG images.
+//
+// Usage: archive_extract [options] <archive>
+//   --list             List frames only (the default when no output directory is given)
+//   --output-dir DIR   Extract frames into DIR as <name>.ppm
+//   --frame NAME       Only extract frames with this name (or index, e.g. #3)
+//   --png              Write PNG instead of PPM
+#include "include/frame_archive.h"
+#include "include/image_io.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <sys/stat.h>
+
+// ############################################################################################
+// Format a Unix timestamp as local date and time
+std::string formatTime(uint64_t timestamp) {
+    time_t t = static_cast<time_t>(timestamp);
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    return text;
+}
+
+// ############################################################################################
+// Print one line per frame with its metadata and compression ratio
+void listFrames(const std::vector<FrameInfo>& frames) {
+    uint64_t raw = 0, stored = 0;
+    std::cout << std::left << std::setw(5) << "#" << std::setw(28) << "name" << std::setw(12) << "size"
+              << std::setw(11) << "render s" << std::setw(14) << "rays" << std::setw(9) << "ratio"
+              << "added" << std::endl;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const FrameInfo& f = frames[i];
+        std::cout << std::left << std::setw(5) << i << std::setw(28) << f.name
+                  << std::setw(12) << (std::to_string(f.width) + "x" + std::to_string(f.height))
+                  << std::setw(11) << std::fixed << std::setprecision(3) << f.renderSeconds
+                  << std::setw(14) << f.rayCount
+                  << std::setw(9) << std::setprecision(2) << static_cast<double>(f.rawSize) / std::max<uint64_t>(f.storedSize, 1)
+                  << formatTime(f.timestamp) << std::endl;
+        raw += f.rawSize;
+        stored += f.storedSize;
+    }
+    std::cout << frames.size() << " frames, " << raw / (1024.0 * 1024.0) << " MB of pixels stored in "
+              << stored / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+// ############################################################################################
+// Main function
+int main(int argc, char** argv) {
+    std::string archivePath, outputDir, selected;
+    bool png = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--list") outputDir.clear();
+        else if (arg == "--output-dir" && i + 1 < argc) outputDir = argv[++i];
+        else if (arg == "--frame" && i + 1 < argc) selected = argv[++i];
+        else if (arg == "--png") png = true;
+        else if (arg == "--help" || arg == "-h") archivePath.clear(), i = argc;
+        else archivePath = arg;
+    }
+    if (archivePath.empty()) {
+        std::cout << "Usage: archive_extract [options] <archive>" << std::endl;
+        std::cout << "Lists or extracts the frames of a ray_tracer_demo --archive file" << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  --list            List frames only (default without --output-dir)" << std::endl;
+        std::cout << "  --output-dir DIR  Extract frames into DIR as <name>.ppm" << std::endl;
+        std::cout << "  --frame NAME      Only extract frames with this name (or #index)" << std::endl;
+        std::cout << "  --png             Write PNG instead of PPM" << std::endl;
+        return 2;
+    }
+
+    FrameArchiveReader reader;
+    if (!reader.open(archivePath)) return 1;
+    const std::vector<FrameInfo>& frames = reader.getFrames();
+    if (outputDir.empty()) {
+        listFrames(frames);
+        return 0;
+    }
+
+    mkdir(outputDir.c_str(), 0755);
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<unsigned char> pixels;
+    int extracted = 0, failures = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const FrameInfo& f = frames[i];
+        if (!selected.empty() && selected != f.name && selected != "#" + std::to_string(i)) continue;
+        if (!reader.readFrame(i, pixels)) {
+            failures++;
+            continue;
+        }
+        // Frames appended under the same name keep their index so none is overwritten
+        std::string name = f.name.empty() ? "frame" : f.name;
+        for (size_t j = 0; j < i; j++) {
+            if (frames[j].name == f.name) {
+                name += "_" + std::to_string(i);
+                break;
+            }
+        }
+        std::string path = outputDir + "/" + name + (png ? ".png" : ".ppm");
+        bool ok = png ? WritePNG(path, pixels.data(), f.width, f.height)
+                      : SavePPM(path, pixels.data(), f.width, f.height);
+        if (!ok) {
+            failures++;
+            continue;
+        }
+        std::cout << "Extracted " << path << std::endl;
+        extracted++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << extracted << " frames extracted in " << seconds << " seconds";
+    if (failures > 0) std::cout << ", " << failures << " failed";
+    std::cout << std::endl;
+    return failures > 0 || extracted == 0 ? 1 : 0;
+}
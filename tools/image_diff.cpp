@@ -0,0 +1,467 @@
+// ############################################################################################
+// Image comparison tool for render regression checks
+// Compares a test image against a reference (PPM P6/P3, PNG or PFM) and reports per-channel
+// max/mean error, PSNR, SSIM over 8x8 tiles, and the number of differing pixels.
+// Directories are compared file by file (recursively, matched by relative path) on all
+// threads, and the exit code is non-zero when any image fails the thresholds.
+//
+// Usage: image_diff [options] <reference> <test>
+//   --max-error E      Fail if any channel differs by more than E (8-bit units, linear for HDR)
+//   --min-psnr P       Fail if PSNR is below P dB
+//   --min-ssim S       Fail if SSIM is below S
+//   --heatmap PATH     Write an error heatmap PPM (a directory when comparing directories)
+//   --quiet            Only print failures and the summary
+#include "include/image_io.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <dirent.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// ############################################################################################
+// Result of comparing one image pair
+struct DiffResult {
+    bool loaded;                // Both images loaded and have the same size
+    std::string error;
+    bool hdr;
+    double maxError[3];         // Per channel, in 8-bit units for LDR images
+    double meanError[3];
+    double psnr;                // dB, infinity when identical
+    double ssim;                // Mean SSIM of the luminance over 8x8 tiles
+    size_t differingPixels;
+    size_t bytes;               // Pixel data compared (both images, as loaded)
+};
+
+struct DiffOptions {
+    double maxError;
+    double minPsnr;
+    double minSsim;
+    std::string heatmap;
+    bool quiet;
+
+    DiffOptions() : maxError(-1.0), minPsnr(-1.0), minSsim(-1.0), quiet(false) {}
+};
+
+// ############################################################################################
+// Rec. 709 luminance of an 8x8 tile (row-major, 64 values)
+void tileLuminance(const Image& image, int x0, int y0, float* luma) {
+    for (int r = 0; r < 8; r++) {
+        size_t base = (static_cast<size_t>(y0 + r) * image.width + x0) * 3;
+        for (int c = 0; c < 8; c++) {
+            size_t i = base + c * 3;
+            luma[r * 8 + c] = 0.2126f * image.value(i) + 0.7152f * image.value(i + 1) + 0.0722f * image.value(i + 2);
+        }
+    }
+}
+
+// ############################################################################################
+// Sums over one 8x8 tile: x, y, x^2, y^2, xy (SSE2: four values per step)
+void tileSums(const float* a, const float* b, double sums[5]) {
+#if defined(__SSE2__)
+    __m128 sx = _mm_setzero_ps(), sy = _mm_setzero_ps();
+    __m128 sxx = _mm_setzero_ps(), syy = _mm_setzero_ps(), sxy = _mm_setzero_ps();
+    for (int i = 0; i < 64; i += 4) {
+        __m128 x = _mm_loadu_ps(a + i);
+        __m128 y = _mm_loadu_ps(b + i);
+        sx = _mm_add_ps(sx, x);
+        sy = _mm_add_ps(sy, y);
+        sxx = _mm_add_ps(sxx, _mm_mul_ps(x, x));
+        syy = _mm_add_ps(syy, _mm_mul_ps(y, y));
+        sxy = _mm_add_ps(sxy, _mm_mul_ps(x, y));
+    }
+    __m128 lanes[5] = { sx, sy, sxx, syy, sxy };
+    for (int k = 0; k < 5; k++) {
+        float v[4];
+        _mm_storeu_ps(v, lanes[k]);
+        sums[k] = static_cast<double>(v[0]) + v[1] + v[2] + v[3];
+    }
+#else
+    for (int k = 0; k < 5; k++) sums[k] = 0.0;
+    for (int i = 0; i < 64; i++) {
+        double x = a[i], y = b[i];
+        sums[0] += x; sums[1] += y;
+        sums[2] += x * x; sums[3] += y * y; sums[4] += x * y;
+    }
+#endif
+}
+
+// ############################################################################################
+// Mean SSIM over non-overlapping 8x8 luminance tiles (partial edge tiles are skipped).
+// Tiles whose pixels are identical score exactly 1 and skip the arithmetic.
+double tiledSsim(const Image& reference, const Image& test, double dynamicRange) {
+    const double c1 = (0.01 * dynamicRange) * (0.01 * dynamicRange);
+    const double c2 = (0.03 * dynamicRange) * (0.03 * dynamicRange);
+    const double n = 64.0;
+    int tilesX = reference.width / 8, tilesY = reference.height / 8;
+    if (tilesX == 0 || tilesY == 0) return 1.0;
+    bool sameFormat = reference.hdr == test.hdr;
+
+    double total = 0.0;
+    float lumaA[64], lumaB[64];
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            if (sameFormat && !reference.hdr) {
+                bool identical = true;
+                for (int r = 0; r < 8 && identical; r++) {
+                    size_t offset = (static_cast<size_t>(ty * 8 + r) * reference.width + tx * 8) * 3;
+                    identical = memcmp(&reference.bytes[offset], &test.bytes[offset], 24) == 0;
+                }
+                if (identical) {
+                    total += 1.0;
+                    continue;
+                }
+            }
+            tileLuminance(reference, tx * 8, ty * 8, lumaA);
+            tileLuminance(test, tx * 8, ty * 8, lumaB);
+            double s[5];
+            tileSums(lumaA, lumaB, s);
+            double muX = s[0] / n, muY = s[1] / n;
+            double varX = s[2] / n - muX * muX;
+            double varY = s[3] / n - muY * muY;
+            double cov = s[4] / n - muX * muY;
+            total += ((2 * muX * muY + c1) * (2 * cov + c2)) /
+                     ((muX * muX + muY * muY + c1) * (varX + varY + c2));
+        }
+    }
+    return total / (static_cast<double>(tilesX) * tilesY);
+}
+
+// ############################################################################################
+// Heatmap color for an error in [0, 1]: black, blue, red, yellow, white
+void heatColor(float t, unsigned char* rgb) {
+    static const float stops[5][3] = { { 0, 0, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 } };
+    t = std::min(std::max(t, 0.0f), 1.0f) * 4.0f;
+    int i = std::min(static_cast<int>(t), 3);
+    float f = t - i;
+    for (int c = 0; c < 3; c++) {
+        rgb[c] = static_cast<unsigned char>(255.0f * (stops[i][c] + (stops[i + 1][c] - stops[i][c]) * f) + 0.5f);
+    }
+}
+
+// ############################################################################################
+// Error statistics accumulated over a range of pixels
+struct ErrorSums {
+    double maxError[3];
+    double sum[3];
+    double squared;
+    size_t differing;
+};
+
+// ############################################################################################
+// 8-bit error statistics. The SSE2 loop takes 16 pixels (48 bytes) per step, so each of the
+// three 16-byte vectors has a fixed channel for every lane; absolute differences are
+// summed in 16-bit lanes and flushed before they can overflow. Blocks without any
+// difference skip the per-pixel count.
+void byteErrors(const unsigned char* a, const unsigned char* b, size_t pixelCount,
+                ErrorSums& e, float* pixelError) {
+    size_t i = 0;
+    unsigned long long laneSum[48] = { 0 };
+    unsigned char laneMax[48] = { 0 };
+    unsigned long long squared = 0;
+    size_t differing = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i maxV[3] = { zero, zero, zero };
+    __m128i sum16[6] = { zero, zero, zero, zero, zero, zero };
+    __m128i sq32 = zero;
+    int pending = 0;
+    for (; i + 16 <= pixelCount; i += 16) {
+        const unsigned char* pa = a + i * 3;
+        const unsigned char* pb = b + i * 3;
+        int changed = 0;
+        for (int k = 0; k < 3; k++) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + 16 * k));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + 16 * k));
+            __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            changed |= _mm_movemask_epi8(_mm_cmpeq_epi8(d, zero)) ^ 0xFFFF;
+            maxV[k] = _mm_max_epu8(maxV[k], d);
+            __m128i lo = _mm_unpacklo_epi8(d, zero), hi = _mm_unpackhi_epi8(d, zero);
+            sum16[2 * k] = _mm_add_epi16(sum16[2 * k], lo);
+            sum16[2 * k + 1] = _mm_add_epi16(sum16[2 * k + 1], hi);
+            sq32 = _mm_add_epi32(sq32, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        }
+        if (changed) {
+            for (int p = 0; p < 16; p++) {
+                if (pa[p * 3] != pb[p * 3] || pa[p * 3 + 1] != pb[p * 3 + 1] || pa[p * 3 + 2] != pb[p * 3 + 2]) differing++;
+            }
+        }
+        if (pixelError) {
+            for (int p = 0; p < 16; p++) {
+                int worst = 0;
+                for (int c = 0; c < 3; c++) worst = std::max(worst, std::abs(pa[p * 3 + c] - pb[p * 3 + c]));
+                pixelError[i + p] = worst / 255.0f;
+            }
+        }
+
+        // 16-bit lanes hold at most 257 steps of 255; 32-bit squares at most 2^15 steps
+        if (++pending == 256) {
+            for (int k = 0; k < 6; k++) {
+                unsigned short v[8];
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(v), sum16[k]);
+                for (int l = 0; l < 8; l++) laneSum[k * 8 + l] += v[l];
+                sum16[k] = zero;
+            }
+            unsigned int v[4];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(v), sq32);
+            squared += static_cast<unsigned long long>(v[0]) + v[1] + v[2] + v[3];
+            sq32 = zero;
+            pending = 0;
+        }
+    }
+    for (int k = 0; k < 6; k++) {
+        unsigned short v[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v), sum16[k]);
+        for (int l = 0; l < 8; l++) laneSum[k * 8 + l] += v[l];
+    }
+    {
+        unsigned int v[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v), sq32);
+        squared += static_cast<unsigned long long>(v[0]) + v[1] + v[2] + v[3];
+    }
+    for (int k = 0; k < 3; k++) _mm_storeu_si128(reinterpret_cast<__m128i*>(laneMax + 16 * k), maxV[k]);
+#endif
+
+    // Remaining pixels (all of them without SSE2)
+    for (; i < pixelCount; i++) {
+        int worst = 0;
+        for (int c = 0; c < 3; c++) {
+            int d = std::abs(a[i * 3 + c] - b[i * 3 + c]);
+            laneSum[c] += d;
+            laneMax[c] = std::max<int>(laneMax[c], d);
+            squared += d * d;
+            worst = std::max(worst, d);
+        }
+        if (worst) differing++;
+        if (pixelError) pixelError[i] = worst / 255.0f;
+    }
+
+    // Lane l of the 48-byte block belongs to channel l % 3
+    for (int c = 0; c < 3; c++) {
+        e.maxError[c] = 0.0;
+        e.sum[c] = 0.0;
+    }
+    for (int l = 0; l < 48; l++) {
+        e.maxError[l % 3] = std::max<double>(e.maxError[l % 3], laneMax[l] / 255.0);
+        e.sum[l % 3] += laneSum[l] / 255.0;
+    }
+    e.squared = squared / (255.0 * 255.0);
+    e.differing = differing;
+}
+
+// ############################################################################################
+// Float error statistics (HDR, or an 8-bit image against an HDR one)
+void floatErrors(const Image& reference, const Image& test, size_t pixelCount, ErrorSums& e, float* pixelError) {
+    for (int c = 0; c < 3; c++) {
+        e.maxError[c] = 0.0;
+        e.sum[c] = 0.0;
+    }
+    e.squared = 0.0;
+    e.differing = 0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        float worst = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            double d = std::fabs(reference.value(i * 3 + c) - test.value(i * 3 + c));
+            e.maxError[c] = std::max(e.maxError[c], d);
+            e.sum[c] += d;
+            e.squared += d * d;
+            worst = std::max(worst, static_cast<float>(d));
+        }
+        if (worst > 0.0f) e.differing++;
+        if (pixelError) pixelError[i] = worst;
+    }
+}
+
+// ############################################################################################
+// Compare two images; optionally write a heatmap of the largest channel error per pixel
+DiffResult compareImages(const std::string& referencePath, const std::string& testPath,
+                         const std::string& heatmapPath) {
+    DiffResult result = DiffResult();
+    Image reference, test;
+    if (!LoadImage(referencePath, reference)) {
+        result.error = "cannot load reference";
+        return result;
+    }
+    if (!LoadImage(testPath, test)) {
+        result.error = "cannot load test image";
+        return result;
+    }
+    if (reference.width != test.width || reference.height != test.height) {
+        std::ostringstream message;
+        message << "size mismatch " << reference.width << "x" << reference.height
+                << " vs " << test.width << "x" << test.height;
+        result.error = message.str();
+        return result;
+    }
+
+    result.loaded = true;
+    result.hdr = reference.hdr || test.hdr;
+    result.bytes = reference.bytes.size() + test.bytes.size()
+                 + (reference.pixels.size() + test.pixels.size()) * sizeof(float);
+    size_t pixelCount = static_cast<size_t>(reference.width) * reference.height;
+
+    std::vector<float> pixelError(heatmapPath.empty() ? 0 : pixelCount);
+    float* errorOut = pixelError.empty() ? NULL : pixelError.data();
+    ErrorSums e;
+    if (!result.hdr) byteErrors(reference.bytes.data(), test.bytes.data(), pixelCount, e, errorOut);
+    else floatErrors(reference, test, pixelCount, e, errorOut);
+
+    // Errors are reported in 8-bit units for LDR images, linear units for HDR
+    double unit = result.hdr ? 1.0 : 255.0;
+    for (int c = 0; c < 3; c++) {
+        result.maxError[c] = e.maxError[c] * unit;
+        result.meanError[c] = e.sum[c] / pixelCount * unit;
+    }
+    result.differingPixels = e.differing;
+
+    double dynamicRange = 1.0;
+    if (reference.hdr) {
+        dynamicRange = 1e-6;
+        for (size_t i = 0; i < reference.pixels.size(); i++) dynamicRange = std::max<double>(dynamicRange, reference.pixels[i]);
+    }
+    double mse = e.squared / (pixelCount * 3.0);
+    result.psnr = mse > 0.0 ? 10.0 * std::log10(dynamicRange * dynamicRange / mse)
+                            : std::numeric_limits<double>::infinity();
+    result.ssim = tiledSsim(reference, test, dynamicRange);
+
+    if (!heatmapPath.empty()) {
+        // Scale to the largest error so small differences stay visible
+        float scale = static_cast<float>(std::max(e.maxError[0], std::max(e.maxError[1], e.maxError[2])));
+        if (scale <= 0.0f) scale = 1.0f;
+        std::vector<unsigned char> heat(pixelCount * 3);
+        for (size_t i = 0; i < pixelCount; i++) heatColor(pixelError[i] / scale, &heat[i * 3]);
+        SavePPM(heatmapPath, heat.data(), reference.width, reference.height);
+    }
+    return result;
+}
+
+bool passes(const DiffResult& result, const DiffOptions& options) {
+    if (!result.loaded) return false;
+    double worst = std::max(result.maxError[0], std::max(result.maxError[1], result.maxError[2]));
+    if (options.maxError >= 0.0 && worst > options.maxError) return false;
+    if (options.minPsnr >= 0.0 && result.psnr < options.minPsnr) return false;
+    if (options.minSsim >= 0.0 && result.ssim < options.minSsim) return false;
+    return true;
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// ############################################################################################
+// Image files below 'root', as paths relative to it, sorted
+void listImages(const std::string& root, const std::string& relative, std::vector<std::string>& files) {
+    std::string path = relative.empty() ? root : root + "/" + relative;
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return;
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string child = relative.empty() ? name : relative + "/" + name;
+        if (isDirectory(root + "/" + child)) {
+            listImages(root, child, files);
+            continue;
+        }
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        size_t dot = lower.rfind('.');
+        std::string extension = dot == std::string::npos ? "" : lower.substr(dot);
+        if (extension == ".ppm" || extension == ".png" || extension == ".pfm") files.push_back(child);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+}
+
+int main(int argc, char** argv) {
+    DiffOptions options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--max-error" && i + 1 < argc) options.maxError = atof(argv[++i]);
+        else if (arg == "--min-psnr" && i + 1 < argc) options.minPsnr = atof(argv[++i]);
+        else if (arg == "--min-ssim" && i + 1 < argc) options.minSsim = atof(argv[++i]);
+        else if (arg == "--heatmap" && i + 1 < argc) options.heatmap = argv[++i];
+        else if (arg == "--quiet") options.quiet = true;
+        else if (arg == "--help" || arg == "-h") paths.clear(), i = argc;
+        else paths.push_back(arg);
+    }
+    if (paths.size() != 2) {
+        std::cout << "Usage: image_diff [options] <reference> <test>" << std::endl;
+        std::cout << "Compares two images (PPM, PNG, PFM) or two directories of images" << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  --max-error E   Fail if a channel differs by more than E (8-bit units)" << std::endl;
+        std::cout << "  --min-psnr P    Fail if PSNR is below P dB" << std::endl;
+        std::cout << "  --min-ssim S    Fail if SSIM is below S" << std::endl;
+        std::cout << "  --heatmap PATH  Write an error heatmap PPM (a directory for directory input)" << std::endl;
+        std::cout << "  --quiet         Only print failures and the summary" << std::endl;
+        return 2;
+    }
+
+    // Build the list of pairs
+    std::vector<std::string> names, references, tests, heatmaps;
+    bool directories = isDirectory(paths[0]);
+    if (directories) {
+        listImages(paths[0], "", names);
+        if (!options.heatmap.empty()) mkdir(options.heatmap.c_str(), 0755);
+        for (size_t i = 0; i < names.size(); i++) {
+            references.push_back(paths[0] + "/" + names[i]);
+            tests.push_back(paths[1] + "/" + names[i]);
+            std::string flat = names[i];
+            std::replace(flat.begin(), flat.end(), '/', '_');
+            heatmaps.push_back(options.heatmap.empty() ? "" : options.heatmap + "/" + flat + ".heat.ppm");
+        }
+    } else {
+        names.push_back(paths[1]);
+        references.push_back(paths[0]);
+        tests.push_back(paths[1]);
+        heatmaps.push_back(options.heatmap);
+    }
+
+    // Compare all pairs in parallel, one pair per thread
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<DiffResult> results(names.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < static_cast<int>(names.size()); i++) {
+        results[i] = compareImages(references[i], tests[i], heatmaps[i]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    int failures = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const DiffResult& r = results[i];
+        bool ok = passes(r, options);
+        failures += !ok;
+        bytes += r.bytes;
+        if (options.quiet && ok) continue;
+
+        std::cout << names[i] << ": ";
+        if (!r.loaded) {
+            std::cout << r.error << "  FAIL" << std::endl;
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(r.hdr ? 4 : 1)
+                  << "max " << r.maxError[0] << " " << r.maxError[1] << " " << r.maxError[2]
+                  << std::setprecision(r.hdr ? 5 : 3)
+                  << "  mean " << r.meanError[0] << " " << r.meanError[1] << " " << r.meanError[2]
+                  << std::setprecision(2) << "  PSNR " << r.psnr << " dB"
+                  << std::setprecision(5) << "  SSIM " << r.ssim
+                  << "  differing " << r.differingPixels
+                  << (ok ? "  PASS" : "  FAIL") << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(3) << "Compared " << results.size() << " image pair(s), "
+              << bytes / (1024.0 * 1024.0) << " MB in " << seconds << " s ("
+              << std::setprecision(1) << (seconds > 0 ? results.size() / seconds : 0.0) << " pairs/s), "
+              << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
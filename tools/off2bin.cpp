@@ -0,0 +1,119 @@
+// ############################################################################################
+// OFF to binary mesh converter
+// Triangulates an OFF mesh, welds its duplicate vertices, computes vertex normals and a BVH,
+// numbers the vertices in the order the BVH leaves use them, and writes the binary mesh
+// format of include/mesh_binary.h, which the viewer and the ray tracer map and use in place.
+// The OFF file is streamed and its faces triangulated batch by batch, so only the arrays
+// that go into the output are held in memory.
+//
+// Usage: off2bin [options] <input.off> <output.bin>
+//   --no-weld      Keep duplicate vertices (by default exact duplicates are merged)
+//   --no-normals   Leave out the vertex normals (loaders then compute them)
+//   --normals MODE Vertex normal weighting: uniform (default, as the viewer), area or angle
+//   --no-bvh       Leave out the BVH (the tracer then tests every triangle)
+//   --no-reorder   Keep the vertices in file order
+#include "include/off_stream.h"
+#include "include/mesh_binary.h"
+#include "include/mesh_normals.h"
+#include "include/mesh_weld.h"
+#include "include/mesh_optimize.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+// ############################################################################################
+// Stream an OFF file into a vertex array and the fan triangulation of its faces
+bool loadTriangles(const std::string& filename, std::vector<Vector3f>& vertices, std::vector<uint32_t>& indices) {
+    return StreamOFF(filename, 65536,
+        [&](const OffVertexBatch& batch) {
+            if (batch.first == 0) vertices.reserve(batch.total);
+            vertices.insert(vertices.end(), batch.vertices.begin(), batch.vertices.end());
+            return true;
+        },
+        [&](const OffFaceBatch& batch) {
+            if (batch.first == 0) indices.reserve(batch.total * 3);
+            batch.triangulate(indices);
+            return true;
+        });
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// ############################################################################################
+// Main function
+int main(int argc, char** argv) {
+    bool weld = true, writeNormals = true, writeBvh = true, reorder = true;
+    NormalWeighting weighting = NORMAL_WEIGHT_UNIFORM;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--no-weld") weld = false;
+        else if (arg == "--no-normals") writeNormals = false;
+        else if (arg == "--no-bvh") writeBvh = false;
+        else if (arg == "--no-reorder") reorder = false;
+        else if (arg == "--normals" && i + 1 < argc && ParseNormalWeighting(argv[i + 1], weighting)) i++;
+        else if (arg == "--help" || arg == "-h") paths.clear(), i = argc;
+        else paths.push_back(arg);
+    }
+    if (paths.size() != 2) {
+        std::cout << "Usage: off2bin [options] <input.off> <output.bin>" << std::endl;
+        std::cout << "Converts an OFF mesh into the binary mesh format loaded in place by the viewer and tracer" << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  --no-weld     Keep duplicate vertices" << std::endl;
+        std::cout << "  --no-normals  Leave out the vertex normals" << std::endl;
+        std::cout << "  --normals M   Vertex normal weighting: uniform (default), area or angle" << std::endl;
+        std::cout << "  --no-bvh      Leave out the bounding volume hierarchy" << std::endl;
+        std::cout << "  --no-reorder  Keep the vertices in file order" << std::endl;
+        return 2;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Vector3f> vertices;
+    std::vector<uint32_t> indices;
+    if (!loadTriangles(paths[0], vertices, indices)) return 1;
+    std::cout << "Parsed " << paths[0] << ": " << vertices.size() << " vertices, " << indices.size() / 3
+              << " triangles in " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+
+    if (weld) {
+        WeldStats stats = WeldVertices(vertices, indices, 0.0f);
+        std::cout << "Welded " << stats.inputVertices << " vertices into " << stats.outputVertices << " (ratio "
+                  << stats.ratio() << ", " << stats.removedTriangles << " degenerate triangles removed) in "
+                  << stats.seconds * 1000.0 << " ms" << std::endl;
+    }
+    size_t triangles = indices.size() / 3;
+
+    std::vector<Vector3f> normals;
+    if (writeNormals) {
+        auto normalStart = std::chrono::high_resolution_clock::now();
+        ComputeVertexNormals(vertices.data(), vertices.size(), indices.data(), triangles, normals, weighting);
+        std::cout << "Computed vertex normals in " << secondsSince(normalStart) * 1000.0 << " ms" << std::endl;
+    }
+
+    std::vector<BvhNode> bvh;
+    if (writeBvh) {
+        auto bvhStart = std::chrono::high_resolution_clock::now();
+        BuildMeshBvh(vertices.data(), indices.data(), triangles, bvh);
+        std::cout << "Built BVH with " << bvh.size() << " nodes in " << secondsSince(bvhStart) * 1000.0 << " ms" << std::endl;
+    }
+
+    // Vertices in order of first use by the (BVH ordered) triangles; the triangles keep
+    // their order, which the BVH leaves refer to
+    if (reorder) {
+        MeshOptimizeStats order = OptimizeMeshOrder(vertices, indices, writeNormals ? &normals : NULL, !writeBvh);
+        std::cout << "Reordered " << (order.trianglesReordered ? "triangles and vertices" : "vertices") << " in "
+                  << order.seconds * 1000.0 << " ms";
+        if (order.trianglesReordered) std::cout << " (ACMR " << order.acmrBefore << " -> " << order.acmrAfter << ")";
+        std::cout << std::endl;
+    }
+
+    if (!WriteMeshBinary(paths[1], vertices.data(), vertices.size(), writeNormals ? normals.data() : NULL,
+                         indices.data(), triangles, bvh.data(), bvh.size())) {
+        return 1;
+    }
+    std::cout << "Wrote " << paths[1] << ": " << triangles << " triangles in " << secondsSince(start) * 1000.0
+              << " ms" << std::endl;
+    return 0;
+}